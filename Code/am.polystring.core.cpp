@@ -0,0 +1,482 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  am.polystring.core.cpp
+//  am.string~
+//
+//  Coefficient and state management for am.polystring~. The coefficients of
+//  each voice are calculated exactly as for a single am.string~.
+//
+//  The per-voice messages and notes do not touch the voices: they are queued in a
+//  lock-free ring (ampolystring_post), and the perform routine applies them at the start
+//  of its next vector (ampolystring_applyMessages). So a voice's coefficients never change
+//  in the middle of a vector, and only the audio thread allocates voices.
+//
+
+#include <math.h>
+#include <string.h>
+#include "am.polystring.core.h"
+#include "am.polystring.dsp.h"
+
+#define AMPOLY_ALIGN 64 // alignment of each array in the memory block (one cache line)
+
+/*
+ * Set the number of voices and the maximum delay, before the memory is allocated
+ */
+void ampolystring_setVoices(t_ampolystring *x, long numVoices, t_sample maxDelay)
+{
+	if(numVoices < 1) numVoices = 1;
+	if(numVoices > AMPOLY_MAXVOICES) numVoices = AMPOLY_MAXVOICES;
+	x->numVoices = numVoices;
+	x->numGroups = (numVoices + AMPOLY_LANES - 1) / AMPOLY_LANES;
+	x->maxDelay = maxDelay;
+	x->delayLineLength = amstring_delayLineLengthFor(maxDelay);
+
+	// [ round each delay line (with its guard zone) up to a whole number of cache lines ]
+	long lineSamples = AMPOLY_ALIGN / (long)sizeof(t_amsample);
+	x->delayLineStride = (x->delayLineLength + DLGUARD + lineSamples - 1) / lineSamples * lineSamples;
+}
+
+/*
+ * Carve the memory block into its arrays, or (if base is NULL) just measure it.
+ * Returns the number of bytes used.
+ */
+static size_t ampolystring_layout(t_ampolystring *x, char* base)
+{
+	long numVoicesPadded = x->numGroups * AMPOLY_LANES;
+	size_t offset = 0;
+	t_sample** arrays[] = {
+		&x->delayTime, &x->fbgain, &x->highFreqGain, &x->notePitch, &x->pendingExcite, &x->energy
+	};
+	t_amsample** stateArrays[] = {
+		&x->inputGain, &x->lpf_a0, &x->lpf_a1,
+		&x->previousHpfOutput, &x->previousHpfInput, &x->lpf_xnminus1, &x->lpf_xnminus2
+	};
+	long** longArrays[] = {
+		&x->held, &x->pendingClear, &x->active, &x->silentSamples
+	};
+
+	// [ start from an aligned address ]
+	if(base) offset = (AMPOLY_ALIGN - (size_t)base % AMPOLY_ALIGN) % AMPOLY_ALIGN;
+	else offset = AMPOLY_ALIGN;
+
+	for(size_t a=0; a<sizeof(arrays)/sizeof(arrays[0]); a++)
+	{
+		if(base) *arrays[a] = (t_sample*)(base + offset);
+		offset += (numVoicesPadded * sizeof(t_sample) + AMPOLY_ALIGN - 1) / AMPOLY_ALIGN * AMPOLY_ALIGN;
+	}
+
+	for(size_t a=0; a<sizeof(stateArrays)/sizeof(stateArrays[0]); a++)
+	{
+		if(base) *stateArrays[a] = (t_amsample*)(base + offset);
+		offset += (numVoicesPadded * sizeof(t_amsample) + AMPOLY_ALIGN - 1) / AMPOLY_ALIGN * AMPOLY_ALIGN;
+	}
+
+	for(size_t a=0; a<sizeof(longArrays)/sizeof(longArrays[0]); a++)
+	{
+		if(base) *longArrays[a] = (long*)(base + offset);
+		offset += (numVoicesPadded * sizeof(long) + AMPOLY_ALIGN - 1) / AMPOLY_ALIGN * AMPOLY_ALIGN;
+	}
+
+	if(base) x->dt = (t_int*)(base + offset);
+	offset += (numVoicesPadded * sizeof(t_int) + AMPOLY_ALIGN - 1) / AMPOLY_ALIGN * AMPOLY_ALIGN;
+
+	if(base) x->lc = (t_amsample*)(base + offset);
+	offset += numVoicesPadded * VD_FILTER_PADDED * sizeof(t_amsample);
+
+	if(base) x->delayLines = (t_amsample*)(base + offset) + DLGUARD;
+	offset += numVoicesPadded * x->delayLineStride * sizeof(t_amsample);
+
+	return offset;
+}
+
+/*
+ * Size in bytes of the memory block needed for the voices set by ampolystring_setVoices
+ */
+size_t ampolystring_memorySize(t_ampolystring *x)
+{
+	return ampolystring_layout(x, NULL);
+}
+
+/*
+ * Point the object at a memory block of ampolystring_memorySize bytes
+ */
+void ampolystring_setMemory(t_ampolystring *x, void* memory)
+{
+	x->memory = memory;
+	ampolystring_layout(x, (char*)memory);
+}
+
+/*
+ * Calculate the control-rate LPF coefficients of voice index v
+ */
+static void ampolystring_calcLpfCoeffs(t_ampolystring *x, long v)
+{
+	amstring_calcLpfCoeffsFor(x->delayTime[v], x->fbgain[v], x->highFreqGain[v], &x->lpf_a0[v], &x->lpf_a1[v]);
+}
+
+/*
+ * Set the (already limited) delay time of voice index v, and recalculate its coefficients
+ */
+static void ampolystring_setVoiceDelayTime(t_ampolystring *x, long v, double newTime)
+{
+	t_amsample lc[VD_FILTER_PADDED];
+
+	// [ set the delay time to 1.0 less than requested because of LPF ]
+	x->delayTime[v] = (t_sample)newTime - 1.0;
+
+	// [ calculate the lagrange coefficients and store them in the voice's lane ]
+	x->dt[v] = amstring_calcLagrangeCoeffsFor(VD_FILTER_ORDER, x->delayTime[v], lc);
+	for(int i=0; i<VD_FILTER_PADDED; i++)
+	{
+		x->lc[((v / AMPOLY_LANES) * VD_FILTER_PADDED + i) * AMPOLY_LANES + v % AMPOLY_LANES] = lc[i];
+	}
+
+	ampolystring_calcLpfCoeffs(x, v);
+}
+
+/*
+ * Initialise an object whose voices and memory have already been set up by the caller.
+ * Every voice starts with the defaults of am.string~ and full input gain; voices padding
+ * out the last lane group have zero input gain and so stay silent.
+ */
+void ampolystring_init(t_ampolystring *x)
+{
+	long numVoicesPadded = x->numGroups * AMPOLY_LANES;
+
+	// [ choose the lane group kernel ]
+	ampolystring_simdInit();
+
+	for(long i=0; i<AMPOLY_QUEUE; i++) x->queueSequence[i].store(i, std::memory_order_relaxed);
+	x->queueHead.store(0, std::memory_order_relaxed);
+	x->queueTail.store(0, std::memory_order_relaxed);
+	x->queueDropped.store(0, std::memory_order_relaxed);
+
+	ampolystring_clear(x);
+	ampolystring_setSampleRate(x, 44100.0);
+	x->noiseSeed = 1;
+	for(long v=0; v<numVoicesPadded; v++)
+	{
+		x->fbgain[v] = 0.99;
+		x->highFreqGain[v] = 0.9;
+		x->inputGain[v] = v < x->numVoices ? 1.0 : 0.0;
+
+		// [ 50 samples definitely ok, since mininimum allowed maxDelay is 100 ]
+		ampolystring_setVoiceDelayTime(x, v, 50.0);
+	}
+}
+
+/*
+ * Set the sample rate (for note pitches), and calculate the coefficients of the D.C. Blocking HPF for it
+ */
+void ampolystring_setSampleRate(t_ampolystring *x, double samplerate)
+{
+	x->samplerate = (t_sample)samplerate;
+	amstring_calcDcbCoeffsFor(samplerate, &x->dcb_a0, &x->dcb_a1, &x->dcb_b1);
+}
+
+/*
+ * Handle the 'clear' message by zeroing the delay lines and filter state of every voice,
+ * and releasing every note
+ */
+void ampolystring_clear(t_ampolystring *x)
+{
+	long numVoicesPadded = x->numGroups * AMPOLY_LANES;
+
+	x->dlWrite = 0;
+	for(long v=0; v<numVoicesPadded; v++)
+	{
+		ampolystring_clearVoice(x, v);
+		x->held[v] = 0;
+		x->pendingExcite[v] = 0.0;
+		x->pendingClear[v] = 0;
+	}
+}
+
+/*
+ * Zero the delay line and filter state of voice index v, which stops it sounding
+ */
+void ampolystring_clearVoice(t_ampolystring *x, long v)
+{
+	memset(x->delayLines + v * x->delayLineStride - DLGUARD, 0, x->delayLineStride * sizeof(t_amsample));
+	x->previousHpfOutput[v] = 0.0;
+	x->previousHpfInput[v] = 0.0;
+	x->lpf_xnminus1[v] = 0.0;
+	x->lpf_xnminus2[v] = 0.0;
+	x->active[v] = 0;
+	x->energy[v] = 0.0;
+	x->silentSamples[v] = 0;
+}
+
+/*
+ * Convert a voice number from a message (1 to numVoices, or 0 for all voices)
+ * to a range of voice indices. Returns 0 if there is no such voice.
+ */
+static long ampolystring_voiceRange(t_ampolystring *x, long voice, long* first, long* last)
+{
+	if(voice == 0) {
+		*first = 0;
+		*last = x->numVoices - 1;
+		return 1;
+	}
+	if(voice < 1 || voice > x->numVoices) return 0;
+	*first = *last = voice - 1;
+	return 1;
+}
+
+/*
+ * Set the delay time of a voice (0 for all voices)
+ */
+static void ampolystring_applyDelayTime(t_ampolystring *x, long voice, double newTime)
+{
+	long first, last;
+
+	if(!ampolystring_voiceRange(x, voice, &first, &last)) return;
+
+	if(newTime > (double)x->maxDelay)
+	{
+		newTime = (double)x->maxDelay;
+	}
+	if( !(newTime >= MINDELAY) ) // ( also catches NaN )
+	{
+		newTime = MINDELAY ;
+	}
+
+	for(long v=first; v<=last; v++)
+	{
+		ampolystring_setVoiceDelayTime(x, v, newTime);
+	}
+}
+
+/*
+ * Set the feedback gain (sustain) of a voice (0 for all voices)
+ */
+static void ampolystring_applyFbGain(t_ampolystring *x, long voice, double newFbGain)
+{
+	long first, last;
+
+	if(!ampolystring_voiceRange(x, voice, &first, &last)) return;
+
+    if ( newFbGain < -MAXFBGAIN ) {
+        newFbGain = -MAXFBGAIN;
+    }
+    else if ( newFbGain > MAXFBGAIN ) {
+        newFbGain = MAXFBGAIN;
+    }
+
+	for(long v=first; v<=last; v++)
+	{
+		x->fbgain[v] = (t_sample)newFbGain;
+		ampolystring_calcLpfCoeffs(x, v);
+	}
+}
+
+/*
+ * Set the 'brightness' of a voice (0 for all voices)
+ * This must be between 0.0 and MAXFBGAIN, since the two gains must have the same sign.
+ */
+static void ampolystring_applyBrightness(t_ampolystring *x, long voice, double newBrightness)
+{
+	long first, last;
+
+	if(!ampolystring_voiceRange(x, voice, &first, &last)) return;
+
+    if ( newBrightness > MAXFBGAIN ) {
+        newBrightness = MAXFBGAIN;
+    }
+    else if ( newBrightness < 0.0 ) {
+        newBrightness = 0.0;
+    }
+
+	for(long v=first; v<=last; v++)
+	{
+		x->highFreqGain[v] = (t_sample)newBrightness;
+		ampolystring_calcLpfCoeffs(x, v);
+	}
+}
+
+/*
+ * Set the gain applied to the shared input signal for a voice (0 for all voices)
+ */
+static void ampolystring_applyInputGain(t_ampolystring *x, long voice, double newGain)
+{
+	long first, last;
+
+	if(!ampolystring_voiceRange(x, voice, &first, &last)) return;
+
+	for(long v=first; v<=last; v++)
+	{
+		x->inputGain[v] = (t_amsample)newGain;
+	}
+}
+
+/*
+ * Apply a note: velocity 1-127 starts a note of the given (MIDI, possibly fractional)
+ * pitch and velocity 0 releases it.
+ *
+ * A note-on goes to the voice already playing that pitch if there is one, otherwise to a
+ * voice that is not sounding, otherwise it steals the quietest voice by tracked energy. The
+ * voice's period is set here, and it is excited with a burst of noise of amplitude
+ * velocity/127 before the vector is processed (clearing it first if stolen: see
+ * ampolystring_applyNotes). A released voice goes on ringing until it decays to silence.
+ */
+static void ampolystring_applyNote(t_ampolystring *x, double pitch, double velocity)
+{
+	long v, voice = -1;
+
+	if(velocity <= 0.0)
+	{
+		for(v=0; v<x->numVoices; v++)
+		{
+			if(x->held[v] && x->notePitch[v] == (t_sample)pitch) x->held[v] = 0;
+		}
+		return;
+	}
+
+	// [ retrigger the voice playing this pitch ]
+	for(v=0; v<x->numVoices && voice < 0; v++)
+	{
+		if((x->held[v] || x->active[v]) && x->notePitch[v] == (t_sample)pitch) voice = v;
+	}
+
+	// [ or take a voice that is not sounding ]
+	for(v=0; v<x->numVoices && voice < 0; v++)
+	{
+		if(!x->held[v] && !x->active[v] && x->pendingExcite[v] == 0.0) voice = v;
+	}
+
+	// [ or steal the quietest (a note-on still pending has no energy yet, so is never stolen) ]
+	if(voice < 0)
+	{
+		t_sample quietest = 0.0;
+		for(v=0; v<x->numVoices; v++)
+		{
+			if(x->pendingExcite[v] != 0.0) continue;
+			if(voice < 0 || x->energy[v] < quietest) {
+				voice = v;
+				quietest = x->energy[v];
+			}
+		}
+		if(voice < 0) return;
+		x->pendingClear[voice] = 1;
+	}
+
+	x->notePitch[voice] = (t_sample)pitch;
+	x->held[voice] = 1;
+	ampolystring_applyDelayTime(x, voice + 1, x->samplerate / (440.0 * pow(2.0, (pitch - 69.0) / 12.0)));
+	x->pendingExcite[voice] = (t_sample)(velocity > 127.0 ? 1.0 : velocity / 127.0);
+}
+
+/*
+ * Queue a message for the perform routine. Returns 0 (and counts the message as dropped) if the
+ * ring is full, as when DSP has been off for a long time. The last AMPOLY_QUEUE_RESERVE slots
+ * are kept for note releases and 'clear', so that a flood of notes cannot lose a release.
+ *
+ * The message handlers may run on more than one thread (the main thread and the scheduler),
+ * so a handler claims its slot by advancing queueHead with compare-and-swap, writes the message,
+ * and then hands the slot over by its sequence number. Neither side ever waits for the other.
+ */
+static long ampolystring_post(t_ampolystring *x, long type, long voice, double value, double velocity)
+{
+	long limit = (type == AMPOLY_MSG_CLEAR || (type == AMPOLY_MSG_NOTE && velocity == 0.0)) ? AMPOLY_QUEUE : AMPOLY_QUEUE - AMPOLY_QUEUE_RESERVE;
+	long head = x->queueHead.load(std::memory_order_relaxed);
+
+	for(;;)
+	{
+		long sequence = x->queueSequence[head % AMPOLY_QUEUE].load(std::memory_order_acquire);
+		if(sequence != head || head - x->queueTail.load(std::memory_order_acquire) >= limit) {
+			// [ another handler claimed this slot first: try the next ]
+			if(sequence > head) {
+				head = x->queueHead.load(std::memory_order_relaxed);
+				continue;
+			}
+			x->queueDropped.fetch_add(1, std::memory_order_relaxed);
+			return 0;
+		}
+		if(x->queueHead.compare_exchange_weak(head, head + 1, std::memory_order_relaxed)) break;
+	}
+
+	t_ampolystring_message* m = &x->queue[head % AMPOLY_QUEUE];
+	m->type = type;
+	m->voice = voice;
+	m->value = value;
+	m->velocity = velocity;
+	x->queueSequence[head % AMPOLY_QUEUE].store(head + 1, std::memory_order_release);
+	return 1;
+}
+
+/*
+ * Apply the messages queued since the last vector, in the order they were sent, up to the
+ * first that is still being written (called by the perform routine)
+ */
+void ampolystring_applyMessages(t_ampolystring *x)
+{
+	long tail = x->queueTail.load(std::memory_order_relaxed);
+
+	for(;; tail++)
+	{
+		if(x->queueSequence[tail % AMPOLY_QUEUE].load(std::memory_order_acquire) != tail + 1) break;
+		const t_ampolystring_message* m = &x->queue[tail % AMPOLY_QUEUE];
+		switch(m->type)
+		{
+			case AMPOLY_MSG_PERIOD:     ampolystring_applyDelayTime(x, m->voice, m->value); break;
+			case AMPOLY_MSG_GAIN:       ampolystring_applyFbGain(x, m->voice, m->value); break;
+			case AMPOLY_MSG_BRIGHTNESS: ampolystring_applyBrightness(x, m->voice, m->value); break;
+			case AMPOLY_MSG_INPUT:      ampolystring_applyInputGain(x, m->voice, m->value); break;
+			case AMPOLY_MSG_NOTE:       ampolystring_applyNote(x, m->value, m->velocity); break;
+			default:                    ampolystring_clear(x); break;
+		}
+		// [ free the slot for the handlers' next pass round the ring ]
+		x->queueSequence[tail % AMPOLY_QUEUE].store(tail + AMPOLY_QUEUE, std::memory_order_release);
+	}
+	x->queueTail.store(tail, std::memory_order_release);
+}
+
+/*
+ * Message handlers: queue the message for the perform routine. Each returns 0 if the
+ * message had to be dropped (see ampolystring_post).
+ */
+long ampolystring_setDelayTime(t_ampolystring *x, long voice, double newTime)
+{
+	return ampolystring_post(x, AMPOLY_MSG_PERIOD, voice, newTime, 0.0);
+}
+
+long ampolystring_setFbGain(t_ampolystring *x, long voice, double newFbGain)
+{
+	return ampolystring_post(x, AMPOLY_MSG_GAIN, voice, newFbGain, 0.0);
+}
+
+long ampolystring_setBrightness(t_ampolystring *x, long voice, double newBrightness)
+{
+	return ampolystring_post(x, AMPOLY_MSG_BRIGHTNESS, voice, newBrightness, 0.0);
+}
+
+long ampolystring_setInputGain(t_ampolystring *x, long voice, double newGain)
+{
+	return ampolystring_post(x, AMPOLY_MSG_INPUT, voice, newGain, 0.0);
+}
+
+long ampolystring_note(t_ampolystring *x, double pitch, double velocity)
+{
+	return ampolystring_post(x, AMPOLY_MSG_NOTE, 0, pitch, velocity);
+}
+
+long ampolystring_clearMessage(t_ampolystring *x)
+{
+	return ampolystring_post(x, AMPOLY_MSG_CLEAR, 0, 0.0, 0.0);
+}
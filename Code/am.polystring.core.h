@@ -0,0 +1,198 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  am.polystring.core.h
+//  am.string~
+//
+//  The DSP core of am.polystring~: N strings in one object, sharing one signal
+//  input and mixed to one output. The voice state is held as structure-of-arrays,
+//  and the voices are processed AMPOLY_LANES at a time so that the LPF and D.C.
+//  blocker recurrences of a lane group can be vectorised across its voices.
+//
+//  All of the per-voice memory (delay lines, coefficients and filter state) is one
+//  block allocated by the caller (see ampolystring_memorySize), laid out as follows,
+//  with voices padded to a whole number of lane groups:
+//      per-voice parameters (t_sample) and filter state (t_amsample): one array of numVoicesPadded values each
+//      lagrange coefficients: lc[(group*VD_FILTER_PADDED + tap)*AMPOLY_LANES + lane]
+//      delay lines: one per voice, delayLineStride samples apart, each with its own guard zone
+//
+
+#ifndef am_string__am_polystring_core_h
+#define am_string__am_polystring_core_h
+
+#include "am.string.core.h"
+
+#ifndef AMPOLY_LANES
+#define AMPOLY_LANES 4 // voices processed together in one lane group
+#endif
+
+#define AMPOLY_DEFAULTVOICES 8
+#define AMPOLY_MAXVOICES 256
+
+#define AMPOLY_SILENCE 1.0e-10 // mean square output (-100 dB) below which a voice counts as silent
+
+#define AMPOLY_QUEUE 1024 // messages that can wait for the perform routine (see ampolystring_post)
+#define AMPOLY_QUEUE_RESERVE 256 // of which the last are kept for note releases and 'clear'
+
+/*
+ * A message for the perform routine, which applies it at the start of its next vector
+ * (see ampolystring_applyMessages)
+ */
+enum {
+	AMPOLY_MSG_PERIOD = 0,  // value: period of voice (0 for all voices)
+	AMPOLY_MSG_GAIN,        // value: feedback gain of voice
+	AMPOLY_MSG_BRIGHTNESS,  // value: brightness of voice
+	AMPOLY_MSG_INPUT,       // value: input gain of voice
+	AMPOLY_MSG_NOTE,        // value: pitch, velocity: velocity (0 to release)
+	AMPOLY_MSG_CLEAR
+};
+
+typedef struct _ampolystring_message
+{
+	long type;
+	long voice;
+	double value;
+	double velocity;
+} t_ampolystring_message;
+
+/*
+ * Object struct Definition
+ */
+typedef struct _ampolystring
+{
+#ifndef AMSTRING_HEADLESS
+	t_pxobject x_obj;
+#endif
+
+	// [ number of voices, and number of lane groups needed to hold them ]
+	long numVoices;
+	long numGroups;
+
+	// [ maximum delay time allowed, and the resulting length of each delay line (as in t_amstring) ]
+	t_sample maxDelay;
+	long delayLineLength;
+
+	// [ distance between the starts of successive voices' delay lines (guard zone included) ]
+	long delayLineStride;
+
+	// [ the memory block holding everything below, as allocated by the caller ]
+	void* memory;
+
+	// [ delay lines, the first starting after its guard zone ]
+	t_amsample* delayLines;
+
+	// [ delay line write index (the same for every voice) ]
+	long dlWrite;
+
+	// [ sample rate, for converting note pitches to periods ]
+	t_sample samplerate;
+
+	// [ state of the noise generator used for note excitation ]
+	unsigned long noiseSeed;
+
+    // [ coefficients for D.C. Blocking HPF (the same for every voice) ]
+    t_amsample dcb_a0;
+    t_amsample dcb_a1;
+    t_amsample dcb_b1;
+
+    /*
+     * Per-voice control-rate variables
+     */
+
+	// [ delay time (reduced by 1.0 as in t_amstring), its integer part and lagrange coefficients ]
+	t_sample* delayTime;
+	t_int* dt;
+	t_amsample* lc;
+
+	// [ feedback loop gains ]
+	t_sample* fbgain;
+	t_sample* highFreqGain;
+
+	// [ gain applied to the shared input signal ]
+	t_amsample* inputGain;
+
+    // [ coefficients for LPF ]
+    t_amsample* lpf_a0;
+    t_amsample* lpf_a1;
+
+    /*
+     * Per-voice audio-rate variables
+     */
+
+    t_amsample* previousHpfOutput;
+    t_amsample* previousHpfInput;
+    t_amsample* lpf_xnminus1;
+    t_amsample* lpf_xnminus2;
+
+    /*
+     * Per-voice allocation state (see ampolystring_note), written by the perform routine only
+     */
+
+	// [ pitch of the note the voice is playing, and whether that note is still held ]
+	t_sample* notePitch;
+	long* held;
+
+	// [ excitation level of a note-on not yet applied by the perform routine (0.0 if none),
+	//   and whether the voice must be cleared first because it has been stolen ]
+	t_sample* pendingExcite;
+	long* pendingClear;
+
+	// [ whether the voice is sounding (only lane groups with a sounding voice are processed) ]
+	long* active;
+
+	// [ mean square output over the last chunk, and for how many samples it has been below AMPOLY_SILENCE ]
+	t_sample* energy;
+	long* silentSamples;
+
+    /*
+     * Messages waiting for the perform routine (see ampolystring_post)
+     */
+
+	// [ ring of messages: slots claimed at queueHead by the message handlers (from any thread),
+	//   read at queueTail by the perform routine. A slot's sequence number says whose turn it
+	//   is: its position when free to claim, and its position + 1 once its message is written ]
+	t_ampolystring_message queue[AMPOLY_QUEUE];
+	std::atomic<long> queueSequence[AMPOLY_QUEUE];
+	std::atomic<long> queueHead;
+	std::atomic<long> queueTail;
+
+	// [ messages dropped because the ring was full ]
+	std::atomic<long> queueDropped;
+
+} t_ampolystring;
+
+/*
+ * Prototypes
+ */
+
+void ampolystring_setVoices(t_ampolystring *x, long numVoices, t_sample maxDelay);
+size_t ampolystring_memorySize(t_ampolystring *x);
+void ampolystring_setMemory(t_ampolystring *x, void* memory);
+void ampolystring_init(t_ampolystring *x);
+void ampolystring_setSampleRate(t_ampolystring *x, double samplerate);
+void ampolystring_clear(t_ampolystring *x);
+void ampolystring_clearVoice(t_ampolystring *x, long v);
+long ampolystring_setDelayTime(t_ampolystring *x, long voice, double newTime);
+long ampolystring_setFbGain(t_ampolystring *x, long voice, double newFbGain);
+long ampolystring_setBrightness(t_ampolystring *x, long voice, double newBrightness);
+long ampolystring_setInputGain(t_ampolystring *x, long voice, double newGain);
+long ampolystring_note(t_ampolystring *x, double pitch, double velocity);
+long ampolystring_clearMessage(t_ampolystring *x);
+void ampolystring_applyMessages(t_ampolystring *x);
+
+#endif
@@ -0,0 +1,241 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ *  am.polystring.cpp
+ *  am.string~
+ *
+ *  Polyphonic Karplus-Strong string max external: N strings sharing one input,
+ *  mixed to one output, processed together in one perform routine.
+ *
+ *  Usage: am.polystring~ <voices> <maximum delay time>
+ *
+ *  Per-voice messages take the voice number (1 to N, or 0 for every voice) first:
+ *      period <voice> <samples>, gain <voice> <gain>, brightness <voice> <gain>,
+ *      input <voice> <gain> (the gain applied to the shared input signal)
+ *
+ *  Notes: note <pitch> <velocity> plucks a voice (velocity 0 releases it), allocating
+ *  voices as described at ampolystring_applyNote. The messages are queued and take effect at
+ *  the start of the next signal vector.
+ */
+
+#include <math.h>
+#include "ext.h"
+#include "ext_obex.h"
+#include "z_dsp.h"
+#include "am.polystring.h"
+#include "am.polystring.dsp.h"
+
+void* ampolystring_class;
+
+int C74_EXPORT main(void)
+{
+	t_class *c;
+#ifdef LITE
+	c = class_new("am.polystring-lite~", (method)ampolystring_new, (method)ampolystring_free, (long)sizeof(t_ampolystring), 0L, A_GIMME, A_NOTHING);
+#else
+	c = class_new("am.polystring~", (method)ampolystring_new, (method)ampolystring_free, (long)sizeof(t_ampolystring), 0L, A_GIMME, A_NOTHING);
+#endif
+    class_addmethod(c, (method)ampolystring_dsp64,          "dsp64",        A_CANT, A_NOTHING);
+	class_addmethod(c, (method)ampolystring_info,           "info",         A_NOTHING);
+	class_addmethod(c, (method)ampolystring_params,         "params",       A_NOTHING);
+	class_addmethod(c, (method)ampolystring_assist,         "assist",       A_CANT, A_NOTHING);
+	class_addmethod(c, (method)ampolystring_clearMsg,       "clear",        A_NOTHING);
+	class_addmethod(c, (method)ampolystring_period,         "period",       A_LONG, A_FLOAT, A_NOTHING);
+    class_addmethod(c, (method)ampolystring_gain,           "gain",         A_LONG, A_FLOAT, A_NOTHING);
+    class_addmethod(c, (method)ampolystring_brightness,     "brightness",   A_LONG, A_FLOAT, A_NOTHING);
+    class_addmethod(c, (method)ampolystring_input,          "input",        A_LONG, A_FLOAT, A_NOTHING);
+    class_addmethod(c, (method)ampolystring_noteMsg,        "note",         A_FLOAT, A_FLOAT, A_NOTHING);
+
+	class_dspinit(c);
+	class_register(CLASS_BOX, c);
+	ampolystring_class = c;
+	return 0;
+}
+
+/****************************************************************************************************
+ * DSP-related functions
+ */
+
+/*
+ * Handle the 'dsp64' message
+ */
+void ampolystring_dsp64(t_ampolystring *x, t_object *dsp64, short *count, double samplerate, long maxvectorsize, long flags)
+{
+    // [ clear delay lines and previous filter outputs (and apply any messages sent while DSP was off) ]
+    ampolystring_applyMessages(x);
+    ampolystring_clear(x);
+
+    // [ get coefficients of the D.C. Blocking HPF ]
+    ampolystring_setSampleRate(x, samplerate);
+
+	object_method( dsp64, gensym("dsp_add64"), x, ampolystring_dodsp_64, 0, NULL );
+}
+
+/****************************************************************************************************
+ * Create and Destroy functions
+ */
+
+/*
+ * Instance creation function
+ */
+void* ampolystring_new(t_symbol *s, short argc, t_atom* argv)
+{
+	long numVoices = AMPOLY_DEFAULTVOICES;
+	long maxDelay = DEFAULTMAXDELAY;
+	t_ampolystring *x = NULL;
+
+	if( (x=(t_ampolystring *)object_alloc((t_class *)ampolystring_class)) )
+	{
+		// [ one signal input, shared by every voice ]
+		dsp_setup((t_pxobject *)x, 1);
+
+		// [ create signal outlet ]
+		outlet_new(x, "signal");
+	}
+
+	/*
+	 * Parse arguments to object.
+     * (There are two optional arguments: the number of voices and the maximum delay time in samples.)
+	 */
+
+	if(argc>0 && argv[0].a_type == A_LONG) {
+		numVoices = argv[0].a_w.w_long;
+	}
+	if(argc>1 && argv[1].a_type == A_LONG) {
+        maxDelay = argv[1].a_w.w_long;
+        if(maxDelay < DEFAULTMAXDELAY) maxDelay = DEFAULTMAXDELAY;
+	}
+
+    /*
+     * Initialise everything
+     */
+
+	// [ allocate and zero one block of memory for all of the voices ]
+	ampolystring_setVoices(x, numVoices, (t_sample)maxDelay);
+	ampolystring_setMemory(x, sysmem_newptrclear(ampolystring_memorySize(x)));
+
+	// [ initialise coefficients, filter state and default parameters ]
+	ampolystring_init(x);
+
+	return x;
+}
+
+/*
+ * Free memory when object is destroyed
+ */
+void ampolystring_free(t_ampolystring *x)
+{
+	// [ dsp_free - needs to be called before memory is deallocated ]
+	dsp_free(&(x->x_obj));
+
+	sysmem_freeptr(x->memory);
+}
+
+/****************************************************************************************************
+ * Message handler functions
+ */
+
+/*
+ * Provide tooltips for inlets and outlets
+ */
+void ampolystring_assist(t_ampolystring *x, void *box, long msg, long arg, char *dstString)
+{
+	if(msg == ASSIST_INLET)
+	{
+		sprintf(dstString,"signal input (to every voice), note <pitch> <velocity>, messages");
+	}
+	else // ASSIST_OUTLET
+	{
+		sprintf(dstString,"signal output (sum of %ld voices)", x->numVoices);
+	}
+}
+
+/*
+ * The queued messages (see ampolystring_post), which report it when one has to be dropped
+ */
+static void ampolystring_posted(t_ampolystring *x, long posted, const char* message)
+{
+	if(!posted) object_error((t_object *)x, "too many messages waiting for DSP: '%s' dropped (%ld so far)", message,
+							 x->queueDropped.load(std::memory_order_relaxed));
+}
+
+void ampolystring_clearMsg(t_ampolystring *x)
+{
+	ampolystring_posted(x, ampolystring_clearMessage(x), "clear");
+}
+
+void ampolystring_period(t_ampolystring *x, long voice, double newTime)
+{
+	ampolystring_posted(x, ampolystring_setDelayTime(x, voice, newTime), "period");
+}
+
+void ampolystring_gain(t_ampolystring *x, long voice, double newFbGain)
+{
+	ampolystring_posted(x, ampolystring_setFbGain(x, voice, newFbGain), "gain");
+}
+
+void ampolystring_brightness(t_ampolystring *x, long voice, double newBrightness)
+{
+	ampolystring_posted(x, ampolystring_setBrightness(x, voice, newBrightness), "brightness");
+}
+
+void ampolystring_input(t_ampolystring *x, long voice, double newGain)
+{
+	ampolystring_posted(x, ampolystring_setInputGain(x, voice, newGain), "input");
+}
+
+void ampolystring_noteMsg(t_ampolystring *x, double pitch, double velocity)
+{
+	ampolystring_posted(x, ampolystring_note(x, pitch, velocity), "note");
+}
+
+/*
+ * Handle the 'params' message by printing out object parameters
+ */
+void ampolystring_params(t_ampolystring *x)
+{
+	post("---------------------------------------------------");
+	post("am.polystring~ filter order, M = %ld, voices: %ld",VD_FILTER_ORDER, x->numVoices);
+	post("am.polystring~ always ensure that: %.1f <= delay time <= %.1f samples",MINDELAY,(t_sample)(x->maxDelay));
+	for(long v=0; v<x->numVoices; v++)
+	{
+		post("am.polystring~ voice %ld: period %f samples, gain %f, brightness %f, input gain %f%s",
+			 v+1, x->delayTime[v]+1.0, x->fbgain[v], x->highFreqGain[v], x->inputGain[v],
+			 x->held[v] ? " (note held)" : x->active[v] ? " (sounding)" : "");
+	}
+	if(x->queueDropped.load(std::memory_order_relaxed)) post("am.polystring~ messages dropped (too many waiting for DSP): %ld", x->queueDropped.load(std::memory_order_relaxed));
+	post("---------------------------------------------------");
+}
+
+/*
+ * Handle the 'info' message by printing out object details
+ */
+void ampolystring_info(t_ampolystring *x)
+{
+	post("---------------------------------------------------");
+	post("am.polystring~ external ver 3.2");
+	post("Polyphonic Karplus-Strong string model");
+#ifdef LITE
+    post("LITE Version (minor sound differences: less computationally demanding)");
+#endif
+	post("voices processed %d at a time", AMPOLY_LANES);
+	post("aengus martin 2013");
+	post("www.am-process.org");
+	post("this version compiled: %s at %s",__DATE__,__TIME__);
+	post("---------------------------------------------------");
+}
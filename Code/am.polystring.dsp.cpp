@@ -0,0 +1,535 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  am.polystring.dsp.cpp
+//  am.string~
+//
+//  The perform routine of am.polystring~. Each lane group of AMPOLY_LANES voices
+//  is run through the whole vector in turn, with the group's state held in registers
+//  and every step of the string (tap sum, LPF, D.C. blocker) done for all of the
+//  lanes at once. The tap spans of the lanes are transposed so that the tap sum too
+//  is vector arithmetic across the voices.
+//
+//  Each voice does exactly the arithmetic of amstring_dodsp1_64 with the scalar tap
+//  sum, in the same order and without fused multiply-adds, so a voice on its own is
+//  bit-identical to an am.string~ with the same settings, whichever kernel is used.
+//  (With AMSTRING_FLOAT the four lanes of a group fit in one __m128, and the AVX
+//  kernel is replaced by an SSE one.)
+//
+
+#include <math.h>
+#include <string.h>
+#include "am.polystring.core.h"
+#include "am.string.simd.h"
+#include "am.string.fpmode.h"
+#include "am.polystring.dsp.h"
+
+#if defined(AMSTRING_SIMD_X86) && AMPOLY_LANES == 4
+#include <immintrin.h>
+#ifdef AMSTRING_FLOAT
+#define AMPOLY_SIMD_SSE
+#else
+#define AMPOLY_SIMD_AVX
+#endif
+#endif
+
+#define AMPOLY_CHUNK 256 // samples processed by every lane group before moving on to the next chunk
+
+typedef void (*t_ampolystring_groupFn)(t_ampolystring *x, long g, const t_sample* in, t_sample* out, long sampleframes);
+
+/****************************************************************************************************
+ * Scalar lane group kernel
+ */
+
+static void ampolystring_processGroupScalar(t_ampolystring *x, long g, const t_sample* in, t_sample* out, long sampleframes)
+{
+	long j, l;
+	int i;
+	long v0 = g * AMPOLY_LANES;
+	const t_amsample* lcoeff = x->lc + v0 * VD_FILTER_PADDED;
+	long dlWrite = x->dlWrite;
+	long delayLineLength = x->delayLineLength;
+	long mirrorStart = delayLineLength - DLGUARD;
+
+	// [ Delay Line ]
+	t_amsample* delayLine[AMPOLY_LANES];
+	t_int dt[AMPOLY_LANES];
+	const t_amsample* span[AMPOLY_LANES];
+	t_amsample delayLineOutput[AMPOLY_LANES];
+
+	// [ LPF ]
+	t_amsample lpf_a0[AMPOLY_LANES];
+	t_amsample lpf_a1[AMPOLY_LANES];
+	t_amsample lpf_xnminus1[AMPOLY_LANES];
+	t_amsample lpf_xnminus2[AMPOLY_LANES];
+	t_amsample lpf_output[AMPOLY_LANES];
+
+	// [ DCB ]
+	t_amsample inputGain[AMPOLY_LANES];
+	t_amsample previousHpfOutput[AMPOLY_LANES];
+	t_amsample previousHpfInput[AMPOLY_LANES];
+	t_amsample currentHpfInput[AMPOLY_LANES];
+	t_sample energy[AMPOLY_LANES];
+	t_amsample dcb_a0 = x->dcb_a0;
+	t_amsample dcb_a1 = x->dcb_a1;
+	t_amsample dcb_b1 = x->dcb_b1;
+
+	for(l=0; l<AMPOLY_LANES; l++)
+	{
+		delayLine[l] = x->delayLines + (v0 + l) * x->delayLineStride;
+		dt[l] = x->dt[v0 + l];
+		lpf_a0[l] = x->lpf_a0[v0 + l];
+		lpf_a1[l] = x->lpf_a1[v0 + l];
+		lpf_xnminus1[l] = x->lpf_xnminus1[v0 + l];
+		lpf_xnminus2[l] = x->lpf_xnminus2[v0 + l];
+		inputGain[l] = x->inputGain[v0 + l];
+		previousHpfOutput[l] = x->previousHpfOutput[v0 + l];
+		previousHpfInput[l] = x->previousHpfInput[v0 + l];
+		energy[l] = 0.0;
+	}
+
+	for(j=0; j<sampleframes; j++)
+	{
+		// [ calculate the positions of the most recent lagrange taps ]
+		for(l=0; l<AMPOLY_LANES; l++)
+		{
+			long dlRead = dlWrite - dt[l];
+			dlRead += dlRead < 0 ? delayLineLength : 0;
+			span[l] = delayLine[l] + dlRead - (VD_FILTER_PADDED-1);
+		}
+
+		// [ calculate delay line outputs (in the order of the scalar tap sum) ]
+		for(l=0; l<AMPOLY_LANES; l++) delayLineOutput[l] = lcoeff[l] * span[l][VD_FILTER_PADDED-1];
+		for(i=1; i<=VD_FILTER_ORDER; i++)
+		{
+			for(l=0; l<AMPOLY_LANES; l++) delayLineOutput[l] += lcoeff[i*AMPOLY_LANES + l] * span[l][VD_FILTER_PADDED-1-i];
+		}
+
+		// [ LPF ]
+		for(l=0; l<AMPOLY_LANES; l++)
+		{
+			lpf_output[l] = lpf_a0[l] * delayLineOutput[l] + lpf_a1[l] * lpf_xnminus1[l] + lpf_a0[l] * lpf_xnminus2[l];
+			lpf_xnminus2[l] = lpf_xnminus1[l];
+			lpf_xnminus1[l] = delayLineOutput[l];
+		}
+
+		// [ DCB ]
+		for(l=0; l<AMPOLY_LANES; l++)
+		{
+			currentHpfInput[l] = lpf_output[l] + inputGain[l] * (t_amsample)in[j];
+			previousHpfOutput[l] = dcb_a0 * currentHpfInput[l] + dcb_a1 * previousHpfInput[l] + dcb_b1 * previousHpfOutput[l];
+			previousHpfInput[l] = currentHpfInput[l];
+		}
+
+		// [ write to the delay lines (and their guard zones), and mix ]
+		t_sample mix = 0.0;
+		for(l=0; l<AMPOLY_LANES; l++)
+		{
+			delayLine[l][dlWrite] = previousHpfOutput[l];
+			delayLine[l][dlWrite >= mirrorStart ? dlWrite - delayLineLength : dlWrite] = previousHpfOutput[l];
+			mix += previousHpfOutput[l];
+			energy[l] += previousHpfOutput[l] * previousHpfOutput[l];
+		}
+		out[j] += mix;
+
+		// [ increment write position, folding back to zero if necessary ]
+		dlWrite = dlWrite + 1 < delayLineLength ? dlWrite + 1 : 0;
+	}
+
+	// [ store things for next time ]
+	for(l=0; l<AMPOLY_LANES; l++)
+	{
+		x->lpf_xnminus1[v0 + l] = lpf_xnminus1[l];
+		x->lpf_xnminus2[v0 + l] = lpf_xnminus2[l];
+		x->previousHpfOutput[v0 + l] = previousHpfOutput[l];
+		x->previousHpfInput[v0 + l] = previousHpfInput[l];
+		x->energy[v0 + l] = energy[l] / (t_sample)sampleframes;
+	}
+}
+
+#ifdef AMPOLY_SIMD_AVX
+
+/****************************************************************************************************
+ * AVX lane group kernel (four voices in one __m256d)
+ */
+
+// [ transpose the rows a, b, c, d of a 4x4 block, in place ]
+__attribute__((target("avx")))
+static inline void ampolystring_transposeAVX(__m256d &a, __m256d &b, __m256d &c, __m256d &d)
+{
+	__m256d ab02 = _mm256_unpacklo_pd(a, b);
+	__m256d ab13 = _mm256_unpackhi_pd(a, b);
+	__m256d cd02 = _mm256_unpacklo_pd(c, d);
+	__m256d cd13 = _mm256_unpackhi_pd(c, d);
+	a = _mm256_permute2f128_pd(ab02, cd02, 0x20);
+	b = _mm256_permute2f128_pd(ab13, cd13, 0x20);
+	c = _mm256_permute2f128_pd(ab02, cd02, 0x31);
+	d = _mm256_permute2f128_pd(ab13, cd13, 0x31);
+}
+
+__attribute__((target("avx")))
+static void ampolystring_processGroupAVX(t_ampolystring *x, long g, const t_sample* in, t_sample* out, long sampleframes)
+{
+	long j, l;
+	int i;
+	long v0 = g * AMPOLY_LANES;
+	const t_amsample* lcoeff = x->lc + v0 * VD_FILTER_PADDED;
+	long dlWrite = x->dlWrite;
+	long delayLineLength = x->delayLineLength;
+	long mirrorStart = delayLineLength - DLGUARD;
+	t_amsample* delayLine[AMPOLY_LANES];
+	t_int dt[AMPOLY_LANES];
+	t_amsample y[AMPOLY_LANES];
+	__m256d lc[VD_FILTER_PADDED];
+	__m256d taps[VD_FILTER_PADDED];
+
+	for(l=0; l<AMPOLY_LANES; l++)
+	{
+		delayLine[l] = x->delayLines + (v0 + l) * x->delayLineStride;
+		dt[l] = x->dt[v0 + l];
+	}
+	for(i=0; i<VD_FILTER_PADDED; i++) lc[i] = _mm256_loadu_pd(lcoeff + i*AMPOLY_LANES);
+
+	__m256d lpf_a0 = _mm256_loadu_pd(x->lpf_a0 + v0);
+	__m256d lpf_a1 = _mm256_loadu_pd(x->lpf_a1 + v0);
+	__m256d lpf_xnminus1 = _mm256_loadu_pd(x->lpf_xnminus1 + v0);
+	__m256d lpf_xnminus2 = _mm256_loadu_pd(x->lpf_xnminus2 + v0);
+	__m256d inputGain = _mm256_loadu_pd(x->inputGain + v0);
+	__m256d previousHpfOutput = _mm256_loadu_pd(x->previousHpfOutput + v0);
+	__m256d previousHpfInput = _mm256_loadu_pd(x->previousHpfInput + v0);
+	__m256d dcb_a0 = _mm256_set1_pd(x->dcb_a0);
+	__m256d dcb_a1 = _mm256_set1_pd(x->dcb_a1);
+	__m256d dcb_b1 = _mm256_set1_pd(x->dcb_b1);
+	__m256d energy = _mm256_setzero_pd();
+
+	for(j=0; j<sampleframes; j++)
+	{
+		// [ load each lane's tap span and transpose, so that taps[k] holds tap k of every lane ]
+		for(l=0; l<AMPOLY_LANES; l++)
+		{
+			long dlRead = dlWrite - dt[l];
+			dlRead += dlRead < 0 ? delayLineLength : 0;
+			const t_amsample* span = delayLine[l] + dlRead - (VD_FILTER_PADDED-1);
+			taps[l] = _mm256_loadu_pd(span);
+			taps[l+4] = _mm256_loadu_pd(span + 4);
+		}
+		ampolystring_transposeAVX(taps[0], taps[1], taps[2], taps[3]);
+		ampolystring_transposeAVX(taps[4], taps[5], taps[6], taps[7]);
+
+		// [ calculate delay line outputs (in the order of the scalar tap sum) ]
+		__m256d delayLineOutput = _mm256_mul_pd(lc[0], taps[VD_FILTER_PADDED-1]);
+		for(i=1; i<=VD_FILTER_ORDER; i++)
+		{
+			delayLineOutput = _mm256_add_pd(delayLineOutput, _mm256_mul_pd(lc[i], taps[VD_FILTER_PADDED-1-i]));
+		}
+
+		// [ LPF ]
+		__m256d lpf_output = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(lpf_a0, delayLineOutput), _mm256_mul_pd(lpf_a1, lpf_xnminus1)), _mm256_mul_pd(lpf_a0, lpf_xnminus2));
+		lpf_xnminus2 = lpf_xnminus1;
+		lpf_xnminus1 = delayLineOutput;
+
+		// [ DCB ]
+		__m256d currentHpfInput = _mm256_add_pd(lpf_output, _mm256_mul_pd(inputGain, _mm256_set1_pd(in[j])));
+		previousHpfOutput = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dcb_a0, currentHpfInput), _mm256_mul_pd(dcb_a1, previousHpfInput)), _mm256_mul_pd(dcb_b1, previousHpfOutput));
+		previousHpfInput = currentHpfInput;
+		energy = _mm256_add_pd(energy, _mm256_mul_pd(previousHpfOutput, previousHpfOutput));
+
+		// [ write to the delay lines (and their guard zones), and mix ]
+		_mm256_storeu_pd(y, previousHpfOutput);
+		long dlMirror = dlWrite >= mirrorStart ? dlWrite - delayLineLength : dlWrite;
+		t_sample mix = 0.0;
+		for(l=0; l<AMPOLY_LANES; l++)
+		{
+			delayLine[l][dlWrite] = y[l];
+			delayLine[l][dlMirror] = y[l];
+			mix += y[l];
+		}
+		out[j] += mix;
+
+		// [ increment write position, folding back to zero if necessary ]
+		dlWrite = dlWrite + 1 < delayLineLength ? dlWrite + 1 : 0;
+	}
+
+	// [ store things for next time ]
+	_mm256_storeu_pd(x->lpf_xnminus1 + v0, lpf_xnminus1);
+	_mm256_storeu_pd(x->lpf_xnminus2 + v0, lpf_xnminus2);
+	_mm256_storeu_pd(x->previousHpfOutput + v0, previousHpfOutput);
+	_mm256_storeu_pd(x->previousHpfInput + v0, previousHpfInput);
+	_mm256_storeu_pd(x->energy + v0, _mm256_div_pd(energy, _mm256_set1_pd((t_sample)sampleframes)));
+}
+
+#endif // AMPOLY_SIMD_AVX
+
+#ifdef AMPOLY_SIMD_SSE
+
+/****************************************************************************************************
+ * Single precision SSE lane group kernel (four voices in one __m128)
+ */
+
+__attribute__((target("sse2")))
+static void ampolystring_processGroupSSE(t_ampolystring *x, long g, const t_sample* in, t_sample* out, long sampleframes)
+{
+	long j, l;
+	int i;
+	long v0 = g * AMPOLY_LANES;
+	const t_amsample* lcoeff = x->lc + v0 * VD_FILTER_PADDED;
+	long dlWrite = x->dlWrite;
+	long delayLineLength = x->delayLineLength;
+	long mirrorStart = delayLineLength - DLGUARD;
+	t_amsample* delayLine[AMPOLY_LANES];
+	t_int dt[AMPOLY_LANES];
+	t_amsample y[AMPOLY_LANES];
+	__m128 lc[VD_FILTER_PADDED];
+	__m128 taps[VD_FILTER_PADDED];
+
+	for(l=0; l<AMPOLY_LANES; l++)
+	{
+		delayLine[l] = x->delayLines + (v0 + l) * x->delayLineStride;
+		dt[l] = x->dt[v0 + l];
+	}
+	for(i=0; i<VD_FILTER_PADDED; i++) lc[i] = _mm_loadu_ps(lcoeff + i*AMPOLY_LANES);
+
+	__m128 lpf_a0 = _mm_loadu_ps(x->lpf_a0 + v0);
+	__m128 lpf_a1 = _mm_loadu_ps(x->lpf_a1 + v0);
+	__m128 lpf_xnminus1 = _mm_loadu_ps(x->lpf_xnminus1 + v0);
+	__m128 lpf_xnminus2 = _mm_loadu_ps(x->lpf_xnminus2 + v0);
+	__m128 inputGain = _mm_loadu_ps(x->inputGain + v0);
+	__m128 previousHpfOutput = _mm_loadu_ps(x->previousHpfOutput + v0);
+	__m128 previousHpfInput = _mm_loadu_ps(x->previousHpfInput + v0);
+	__m128 dcb_a0 = _mm_set1_ps(x->dcb_a0);
+	__m128 dcb_a1 = _mm_set1_ps(x->dcb_a1);
+	__m128 dcb_b1 = _mm_set1_ps(x->dcb_b1);
+	__m128 energy = _mm_setzero_ps();
+
+	for(j=0; j<sampleframes; j++)
+	{
+		// [ load each lane's tap span and transpose, so that taps[k] holds tap k of every lane ]
+		for(l=0; l<AMPOLY_LANES; l++)
+		{
+			long dlRead = dlWrite - dt[l];
+			dlRead += dlRead < 0 ? delayLineLength : 0;
+			const t_amsample* span = delayLine[l] + dlRead - (VD_FILTER_PADDED-1);
+			taps[l] = _mm_loadu_ps(span);
+			taps[l+4] = _mm_loadu_ps(span + 4);
+		}
+		_MM_TRANSPOSE4_PS(taps[0], taps[1], taps[2], taps[3]);
+		_MM_TRANSPOSE4_PS(taps[4], taps[5], taps[6], taps[7]);
+
+		// [ calculate delay line outputs (in the order of the scalar tap sum) ]
+		__m128 delayLineOutput = _mm_mul_ps(lc[0], taps[VD_FILTER_PADDED-1]);
+		for(i=1; i<=VD_FILTER_ORDER; i++)
+		{
+			delayLineOutput = _mm_add_ps(delayLineOutput, _mm_mul_ps(lc[i], taps[VD_FILTER_PADDED-1-i]));
+		}
+
+		// [ LPF ]
+		__m128 lpf_output = _mm_add_ps(_mm_add_ps(_mm_mul_ps(lpf_a0, delayLineOutput), _mm_mul_ps(lpf_a1, lpf_xnminus1)), _mm_mul_ps(lpf_a0, lpf_xnminus2));
+		lpf_xnminus2 = lpf_xnminus1;
+		lpf_xnminus1 = delayLineOutput;
+
+		// [ DCB ]
+		__m128 currentHpfInput = _mm_add_ps(lpf_output, _mm_mul_ps(inputGain, _mm_set1_ps((t_amsample)in[j])));
+		previousHpfOutput = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dcb_a0, currentHpfInput), _mm_mul_ps(dcb_a1, previousHpfInput)), _mm_mul_ps(dcb_b1, previousHpfOutput));
+		previousHpfInput = currentHpfInput;
+		energy = _mm_add_ps(energy, _mm_mul_ps(previousHpfOutput, previousHpfOutput));
+
+		// [ write to the delay lines (and their guard zones), and mix ]
+		_mm_storeu_ps(y, previousHpfOutput);
+		long dlMirror = dlWrite >= mirrorStart ? dlWrite - delayLineLength : dlWrite;
+		t_sample mix = 0.0;
+		for(l=0; l<AMPOLY_LANES; l++)
+		{
+			delayLine[l][dlWrite] = y[l];
+			delayLine[l][dlMirror] = y[l];
+			mix += y[l];
+		}
+		out[j] += mix;
+
+		// [ increment write position, folding back to zero if necessary ]
+		dlWrite = dlWrite + 1 < delayLineLength ? dlWrite + 1 : 0;
+	}
+
+	// [ store things for next time ]
+	_mm_storeu_ps(x->lpf_xnminus1 + v0, lpf_xnminus1);
+	_mm_storeu_ps(x->lpf_xnminus2 + v0, lpf_xnminus2);
+	_mm_storeu_ps(x->previousHpfOutput + v0, previousHpfOutput);
+	_mm_storeu_ps(x->previousHpfInput + v0, previousHpfInput);
+	_mm_storeu_ps(y, energy);
+	for(l=0; l<AMPOLY_LANES; l++) x->energy[v0 + l] = (t_sample)y[l] / (t_sample)sampleframes;
+}
+
+#endif // AMPOLY_SIMD_SSE
+
+/****************************************************************************************************
+ * Dispatch
+ */
+
+static t_ampolystring_groupFn ampolystring_processGroup = ampolystring_processGroupScalar;
+
+/*
+ * Choose the lane group kernel for the host, following the choice (or the
+ * AMSTRING_SIMD override) of amstring_simdInit: "scalar" and "sse2" use the
+ * scalar kernel, which the compiler vectorises as far as it can. (With
+ * AMSTRING_FLOAT only "scalar" does, and the others use the SSE kernel.)
+ */
+void ampolystring_simdInit(void)
+{
+	amstring_simdInit();
+	ampolystring_processGroup = ampolystring_processGroupScalar;
+#ifdef AMPOLY_SIMD_AVX
+	if(strcmp(amstring_simdName(), "scalar") && strcmp(amstring_simdName(), "sse2")) {
+		ampolystring_processGroup = ampolystring_processGroupAVX;
+	}
+#endif
+#ifdef AMPOLY_SIMD_SSE
+	if(strcmp(amstring_simdName(), "scalar")) {
+		ampolystring_processGroup = ampolystring_processGroupSSE;
+	}
+#endif
+}
+
+/****************************************************************************************************
+ * Note handling
+ */
+
+/*
+ * Apply the note-ons made since the last vector: clear a stolen voice, then fill the
+ * last period of its delay line (behind the write position, so it sounds at once)
+ * with a burst of noise at the note's excitation level.
+ */
+static void ampolystring_applyNotes(t_ampolystring *x)
+{
+	long delayLineLength = x->delayLineLength;
+	long mirrorStart = delayLineLength - DLGUARD;
+
+	for(long v=0; v<x->numVoices; v++)
+	{
+		t_sample level = x->pendingExcite[v];
+		if(level == 0.0) continue;
+
+		if(x->pendingClear[v]) ampolystring_clearVoice(x, v);
+
+		t_amsample* delayLine = x->delayLines + v * x->delayLineStride;
+		long n = x->dt[v] + VD_FILTER_LENGTH;
+		long p = x->dlWrite;
+		if(n > delayLineLength) n = delayLineLength;
+		for(long k=0; k<n; k++)
+		{
+			p = p > 0 ? p - 1 : delayLineLength - 1;
+			x->noiseSeed = x->noiseSeed * 1664525UL + 1013904223UL;
+			delayLine[p] = (t_amsample)(level * ((t_sample)(x->noiseSeed & 0xffffff) / (t_sample)0x800000 - 1.0));
+			if(p >= mirrorStart) delayLine[p - delayLineLength] = delayLine[p];
+		}
+
+		x->active[v] = 1;
+		x->silentSamples[v] = 0;
+		x->pendingClear[v] = 0;
+		x->pendingExcite[v] = 0.0;
+	}
+}
+
+/*
+ * After a lane group has been processed, check and follow its voices:
+ *  - a voice with a non-finite value in its loop is reset (and 1 is returned, so that
+ *    the chunk's output can be silenced);
+ *  - filter state that has decayed below AMSTRING_FLUSH is flushed to zero;
+ *  - a voice that has been silent for longer than its period is cleared and stops
+ *    sounding. (A note that is still held but has decayed away keeps its voice, but
+ *    as the quietest it is stolen first.)
+ */
+static long ampolystring_endOfChunk(t_ampolystring *x, long g, long sampleframes)
+{
+	long reset = 0;
+
+	for(long v=g*AMPOLY_LANES; v<(g+1)*AMPOLY_LANES; v++)
+	{
+		if(!isfinite(x->energy[v]) || !isfinite(x->lpf_xnminus1[v]) || !isfinite(x->lpf_xnminus2[v]) || !isfinite(x->previousHpfInput[v])) {
+			ampolystring_clearVoice(x, v);
+			reset = 1;
+			continue;
+		}
+
+		if(fabs(x->previousHpfOutput[v]) < AMSTRING_FLUSH) x->previousHpfOutput[v] = 0.0;
+		if(fabs(x->previousHpfInput[v]) < AMSTRING_FLUSH) x->previousHpfInput[v] = 0.0;
+		if(fabs(x->lpf_xnminus1[v]) < AMSTRING_FLUSH) x->lpf_xnminus1[v] = 0.0;
+		if(fabs(x->lpf_xnminus2[v]) < AMSTRING_FLUSH) x->lpf_xnminus2[v] = 0.0;
+
+		if(x->energy[v] >= AMPOLY_SILENCE) {
+			x->active[v] = 1;
+			x->silentSamples[v] = 0;
+		}
+		else if(x->active[v]) {
+			x->silentSamples[v] += sampleframes;
+			if(x->silentSamples[v] > x->dt[v] + VD_FILTER_LENGTH) ampolystring_clearVoice(x, v);
+		}
+	}
+	return reset;
+}
+
+/****************************************************************************************************
+ * Perform function: one (shared) signal input, one (mixed) signal output.
+ * ins[0][n]  = input, scaled by each voice's input gain
+ * outs[0][n] = sum of the voices' outputs
+ *
+ * Only lane groups with a voice that is sounding, or that has input, are processed.
+ * (A voice that is not sounding has all-zero state, so processing it would add nothing.)
+ */
+void ampolystring_dodsp_64(t_ampolystring *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam)
+{
+	t_ampolystring_groupFn processGroup = ampolystring_processGroup;
+	t_sample input[AMPOLY_CHUNK];
+	long chunk;
+	t_amstring_fpmode fpmode = amstring_fpModeEnter();
+
+	ampolystring_applyMessages(x);
+	ampolystring_applyNotes(x);
+
+	// [ MSP may pass the same vector for input and output, so work through the vector in
+	//   chunks, keeping a copy of the chunk's input while the voices are mixed into the output ]
+	for(long j0=0; j0<sampleframes; j0+=chunk)
+	{
+		chunk = sampleframes - j0 < AMPOLY_CHUNK ? sampleframes - j0 : AMPOLY_CHUNK;
+		t_sample* out = outs[0] + j0;
+		long hasInput = 0, reset = 0;
+		for(long j=0; j<chunk; j++)
+		{
+			input[j] = ins[0][j0 + j];
+			hasInput |= input[j] != 0.0;
+		}
+		memset(out, 0, chunk * sizeof(t_sample));
+
+		for(long g=0; g<x->numGroups; g++)
+		{
+			long needed = 0;
+			for(long v=g*AMPOLY_LANES; v<(g+1)*AMPOLY_LANES; v++)
+			{
+				needed |= x->active[v] || (hasInput && x->inputGain[v] != 0.0);
+			}
+			if(!needed) continue;
+
+			processGroup(x, g, input, out, chunk);
+			reset |= ampolystring_endOfChunk(x, g, chunk);
+		}
+		if(reset) memset(out, 0, chunk * sizeof(t_sample));
+
+		// [ every group has advanced the write position by the same amount ]
+		x->dlWrite = (x->dlWrite + chunk) % x->delayLineLength;
+	}
+
+	amstring_fpModeLeave(fpmode);
+}
@@ -0,0 +1,29 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  am.polystring.dsp.h
+//  am.string~
+//
+
+#ifndef am_string__am_polystring_dsp_h
+#define am_string__am_polystring_dsp_h
+
+void ampolystring_simdInit(void);
+void ampolystring_dodsp_64(t_ampolystring *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam);
+
+#endif
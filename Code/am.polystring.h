@@ -0,0 +1,45 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  am.polystring.h
+//  am.string~
+//
+
+#ifndef am_string__am_polystring_h
+#define am_string__am_polystring_h
+
+#include "am.polystring.core.h"
+
+/*
+ * Prototypes
+ */
+
+void ampolystring_dsp64(t_ampolystring *x, t_object *dsp64, short *count, double samplerate, long maxvectorsize, long flags);
+void* ampolystring_new(t_symbol *s, short argc, t_atom* argv);
+void ampolystring_free(t_ampolystring *x);
+void ampolystring_info(t_ampolystring *x);
+void ampolystring_params(t_ampolystring *x);
+void ampolystring_clearMsg(t_ampolystring *x);
+void ampolystring_period(t_ampolystring *x, long voice, double newTime);
+void ampolystring_gain(t_ampolystring *x, long voice, double newFbGain);
+void ampolystring_brightness(t_ampolystring *x, long voice, double newBrightness);
+void ampolystring_input(t_ampolystring *x, long voice, double newGain);
+void ampolystring_noteMsg(t_ampolystring *x, double pitch, double velocity);
+void ampolystring_assist(t_ampolystring *x, void *box, long msg, long arg, char *dstString);
+
+#endif
@@ -0,0 +1,215 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  am.string.arena.cpp
+//  am.string~
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <mutex>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#include "am.string.arena.h"
+
+typedef struct _amstring_arenaFreeBlock
+{
+	struct _amstring_arenaFreeBlock* next;
+	size_t size;
+} t_amstring_arenaFreeBlock;
+
+typedef struct _amstring_arenaChunk
+{
+	char* base;
+	size_t size;
+} t_amstring_arenaChunk;
+
+static std::mutex amstring_arenaLock;
+static long amstring_arenaMode = AMSTRING_ARENA_OFF;
+static bool amstring_arenaChosen = false;
+static const char* amstring_arenaPages = NULL;
+
+// [ the chunks mapped so far, and the unused part of the last one ]
+static std::vector<t_amstring_arenaChunk> amstring_arenaChunks;
+static char* amstring_arenaNext = NULL;
+static size_t amstring_arenaLeft = 0;
+
+// [ blocks given back, to be handed out again ]
+static t_amstring_arenaFreeBlock* amstring_arenaFreeList = NULL;
+
+/*
+ * The mode, from the AMSTRING_ARENA environment variable unless amstring_arenaEnable has
+ * already chosen it (call with the lock held)
+ */
+static long amstring_arenaGetMode(void)
+{
+	if(!amstring_arenaChosen)
+	{
+		const char* mode = getenv("AMSTRING_ARENA");
+		if(mode && !strcmp(mode, "on")) amstring_arenaMode = AMSTRING_ARENA_ON;
+		else if(mode && !strcmp(mode, "huge")) amstring_arenaMode = AMSTRING_ARENA_HUGE;
+		amstring_arenaChosen = true;
+	}
+	return amstring_arenaMode;
+}
+
+/*
+ * Turn the arena on or off (AMSTRING_ARENA_...) for blocks allocated from now on. Blocks
+ * already allocated, from either source, are freed correctly whatever the mode.
+ */
+void amstring_arenaEnable(long mode)
+{
+	std::lock_guard<std::mutex> guard(amstring_arenaLock);
+	amstring_arenaMode = (mode >= AMSTRING_ARENA_OFF && mode <= AMSTRING_ARENA_HUGE) ? mode : (long)AMSTRING_ARENA_OFF;
+	amstring_arenaChosen = true;
+}
+
+const char* amstring_arenaName(void)
+{
+	std::lock_guard<std::mutex> guard(amstring_arenaLock);
+	switch(amstring_arenaGetMode())
+	{
+		case AMSTRING_ARENA_ON: return "on";
+		case AMSTRING_ARENA_HUGE: return amstring_arenaPages ? amstring_arenaPages : "huge";
+		default: return "off";
+	}
+}
+
+/*
+ * Map size bytes (a multiple of AMSTRING_ARENA_CHUNK) of zeroed memory, backed by huge
+ * pages if asked for and available. Returns NULL on failure.
+ */
+static char* amstring_arenaMap(size_t size, long mode)
+{
+#ifdef _WIN32
+	// ( large pages on Windows need a privilege that hosts do not normally hold, so they are not tried )
+	(void)mode;
+	return (char*)VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+	void* p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+	if(mode == AMSTRING_ARENA_HUGE) {
+		p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if(p != MAP_FAILED) amstring_arenaPages = "huge (hugetlb)";
+	}
+#endif
+	if(p != MAP_FAILED) return (char*)p;
+
+	if(mode != AMSTRING_ARENA_HUGE) {
+		p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		return p != MAP_FAILED ? (char*)p : NULL;
+	}
+
+	// [ map an extra chunk so the memory can start on a huge page boundary, and trim the rest ]
+	p = mmap(NULL, size + AMSTRING_ARENA_CHUNK, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(p == MAP_FAILED) return NULL;
+	char* start = (char*)p;
+	char* aligned = start + (AMSTRING_ARENA_CHUNK - (size_t)start % AMSTRING_ARENA_CHUNK) % AMSTRING_ARENA_CHUNK;
+	if(aligned > start) munmap(start, aligned - start);
+	if(aligned + size < start + size + AMSTRING_ARENA_CHUNK) munmap(aligned + size, start + size + AMSTRING_ARENA_CHUNK - (aligned + size));
+#ifdef MADV_HUGEPAGE
+	if(!madvise(aligned, size, MADV_HUGEPAGE) && !amstring_arenaPages) amstring_arenaPages = "huge (transparent)";
+#endif
+	if(!amstring_arenaPages) amstring_arenaPages = "huge (unavailable: normal pages)";
+	return aligned;
+#endif
+}
+
+/*
+ * Allocate a zeroed block of at least size bytes, starting on a cache line. Returns NULL
+ * if the arena is off (or memory has run out), in which case the caller should allocate
+ * the block itself.
+ */
+void* amstring_arenaAlloc(size_t size)
+{
+	std::lock_guard<std::mutex> guard(amstring_arenaLock);
+	long mode = amstring_arenaGetMode();
+	if(mode == AMSTRING_ARENA_OFF) return NULL;
+
+	// [ pad to an odd number of cache lines, so consecutive blocks start in different cache sets ]
+	size_t lines = (size + AMSTRING_LINE - 1) / AMSTRING_LINE;
+	if(!(lines & 1)) lines++;
+	size = lines * AMSTRING_LINE;
+
+	// [ reuse a freed block of the same size ]
+	for(t_amstring_arenaFreeBlock** f = &amstring_arenaFreeList; *f; f = &(*f)->next)
+	{
+		if((*f)->size == size) {
+			char* block = (char*)*f;
+			*f = (*f)->next;
+			memset(block, 0, size);
+			return block;
+		}
+	}
+
+	// [ a block bigger than a chunk gets chunks of its own, leaving the current one to be carved further ]
+	if(size > AMSTRING_ARENA_CHUNK)
+	{
+		size_t mapped = (size + AMSTRING_ARENA_CHUNK - 1) / AMSTRING_ARENA_CHUNK * AMSTRING_ARENA_CHUNK;
+		char* block = amstring_arenaMap(mapped, mode);
+		if(!block) return NULL;
+		t_amstring_arenaChunk chunk = { block, mapped };
+		amstring_arenaChunks.push_back(chunk);
+		return block;
+	}
+
+	if(size > amstring_arenaLeft)
+	{
+		char* base = amstring_arenaMap(AMSTRING_ARENA_CHUNK, mode);
+		if(!base) return NULL;
+		t_amstring_arenaChunk chunk = { base, AMSTRING_ARENA_CHUNK };
+		amstring_arenaChunks.push_back(chunk);
+		amstring_arenaNext = base;
+		amstring_arenaLeft = AMSTRING_ARENA_CHUNK;
+	}
+
+	char* block = amstring_arenaNext;
+	amstring_arenaNext += size;
+	amstring_arenaLeft -= size;
+	return block;
+}
+
+/*
+ * Give back a block of size bytes (the size it was allocated with). Returns 1 if it came
+ * from the arena, or 0 if it did not, in which case the caller should free it itself.
+ */
+long amstring_arenaFree(void* block, size_t size)
+{
+	if(!block) return 0;
+
+	std::lock_guard<std::mutex> guard(amstring_arenaLock);
+	bool ours = false;
+	for(size_t c=0; c<amstring_arenaChunks.size() && !ours; c++)
+	{
+		ours = (char*)block >= amstring_arenaChunks[c].base && (char*)block < amstring_arenaChunks[c].base + amstring_arenaChunks[c].size;
+	}
+	if(!ours) return 0;
+
+	size_t lines = (size + AMSTRING_LINE - 1) / AMSTRING_LINE;
+	if(!(lines & 1)) lines++;
+
+	t_amstring_arenaFreeBlock* f = (t_amstring_arenaFreeBlock*)block;
+	f->size = lines * AMSTRING_LINE;
+	f->next = amstring_arenaFreeList;
+	amstring_arenaFreeList = f;
+	return 1;
+}
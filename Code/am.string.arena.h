@@ -0,0 +1,61 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  am.string.arena.h
+//  am.string~
+//
+//  A shared arena for the memory blocks of am.string~ instances (see
+//  amstring_memorySize). It is off unless asked for: each instance then gets its
+//  own block from the host allocator, which for the default maximum delay means a
+//  separate mapping of some 64 KB starting at the same offset in its page as every
+//  other, so that with hundreds of instances the delay lines need hundreds of TLB
+//  entries and their write positions compete for the same few cache sets.
+//
+//  When the arena is enabled (AMSTRING_ARENA=on or huge in the environment, or
+//  amstring_arenaEnable from the headless tools) blocks are carved one after another
+//  from chunks of AMSTRING_ARENA_CHUNK bytes. Each block starts on a cache line and is
+//  padded to an odd number of cache lines, so consecutive blocks start in different
+//  cache sets. With "huge" the chunks are backed by huge pages where the system allows
+//  (MAP_HUGETLB, else transparent huge pages through madvise), so one TLB entry covers
+//  the blocks of some thirty instances; if it does not, they are ordinary pages.
+//
+//  Freed blocks are kept and handed out again to a request of the same size. Chunks are
+//  never returned to the system. All of this happens when objects are created and freed,
+//  never on the audio thread.
+//
+
+#ifndef am_string__am_string_arena_h
+#define am_string__am_string_arena_h
+
+#include <stddef.h>
+
+#define AMSTRING_LINE 64 // cache line size assumed for alignment and padding
+#define AMSTRING_ARENA_CHUNK (2*1024*1024) // bytes mapped at a time (one huge page on x86 and arm64)
+
+enum {
+	AMSTRING_ARENA_OFF = 0,
+	AMSTRING_ARENA_ON,
+	AMSTRING_ARENA_HUGE
+};
+
+void amstring_arenaEnable(long mode);
+const char* amstring_arenaName(void);
+void* amstring_arenaAlloc(size_t size);
+long amstring_arenaFree(void* block, size_t size);
+
+#endif
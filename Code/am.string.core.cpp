@@ -0,0 +1,630 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  am.string.core.cpp
+//  am.string~
+//
+//  Coefficient and state management for the string, shared by the Max
+//  external and the headless tools.
+//
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "am.string.core.h"
+#include "am.string.lagrange.h"
+#include "am.string.lpf.h"
+#include "am.string.simd.h"
+#include "am.string.order.h"
+#include "am.string.exciter.h"
+#include "am.string.arena.h"
+
+/*
+ * Length of delay line required to accommodate a given maximum delay time (at any order)
+ */
+long amstring_delayLineLengthFor(t_sample maxDelay)
+{
+	return (long)maxDelay + (long)ceil(AMSTRING_MAXORDER/2.0);
+}
+
+/*
+ * Bytes taken by the hot state at the start of the memory block: a whole number of cache lines
+ */
+static size_t amstring_hotSize(void)
+{
+	return (sizeof(t_amstring_hot) + AMSTRING_LINE - 1) / AMSTRING_LINE * AMSTRING_LINE;
+}
+
+/*
+ * Size in bytes of the memory block for a maximum delay: the hot state, then the guard
+ * zone and delay line, from the first cache line in the block.
+ */
+static size_t amstring_memorySizeFor(t_sample maxDelay)
+{
+	return AMSTRING_LINE + amstring_hotSize() + (amstring_delayLineLengthFor(maxDelay) + DLGUARD) * sizeof(t_amsample);
+}
+
+/*
+ * The hot state at the first cache line of a memory block
+ */
+static t_amstring_hot* amstring_hotOf(void* memory)
+{
+	char* base = (char*)memory;
+	return (t_amstring_hot*)(base + (AMSTRING_LINE - (size_t)base % AMSTRING_LINE) % AMSTRING_LINE);
+}
+
+/*
+ * Allocate a zeroed memory block for a maximum delay, from the shared arena if it is
+ * enabled (see am.string.arena.h), otherwise using Max SDK cross-platform function (the C
+ * library when headless), and lay out its delay line. Returns NULL if there is not enough memory.
+ */
+void* amstring_newMemory(t_sample maxDelay)
+{
+	size_t size = amstring_memorySizeFor(maxDelay);
+	void* memory = amstring_arenaAlloc(size);
+#ifdef AMSTRING_HEADLESS
+	if(!memory) memory = calloc(1, size);
+#else
+	if(!memory) memory = sysmem_newptrclear(size);
+#endif
+	if(!memory) return NULL;
+
+	t_amstring_hot* hot = amstring_hotOf(memory);
+	hot->delayLineLength = amstring_delayLineLengthFor(maxDelay);
+	hot->maxDelay = maxDelay;
+	hot->delayLine = (t_amsample*)((char*)hot + amstring_hotSize()) + DLGUARD;
+	return memory;
+}
+
+/*
+ * Free a block from amstring_newMemory (NULL is ignored)
+ */
+void amstring_freeMemory(void* memory)
+{
+	if(!memory) return;
+	if(amstring_arenaFree(memory, amstring_memorySizeFor(amstring_hotOf(memory)->maxDelay))) return;
+#ifdef AMSTRING_HEADLESS
+	free(memory);
+#else
+	sysmem_freeptr(memory);
+#endif
+}
+
+/*
+ * Point the string at a memory block from amstring_newMemory
+ */
+void amstring_setMemory(t_amstring *x, void* memory)
+{
+	x->memory = memory;
+	x->hot = amstring_hotOf(memory);
+}
+
+/*
+ * Handle the 'maxdelay' message: change the maximum delay time (at least AMSTRING_MINMAXDELAY).
+ * The new block is allocated here, off the audio thread, and swapped in by the perform
+ * routine at the start of its next vector (see amstring_swapMemory). Until then, the perform
+ * routine keeps to the old delay line's maximum. The old block is freed later, by
+ * amstring_collectMemory. Returns 0 (leaving the maximum delay as it was) if there is not
+ * enough memory.
+ */
+long amstring_setMaxDelay(t_amstring *x, double newMaxDelay)
+{
+	if( !(newMaxDelay >= AMSTRING_MINMAXDELAY) ) newMaxDelay = AMSTRING_MINMAXDELAY; // ( also catches NaN )
+	newMaxDelay = ceil(newMaxDelay);
+
+	void* memory = amstring_newMemory((t_sample)newMaxDelay);
+	if(!memory) return 0;
+
+	// [ replace any block from an earlier message that has not been swapped in yet ]
+	amstring_freeMemory(x->pendingMemory.exchange(memory, std::memory_order_acq_rel));
+
+	// [ keep the delay time within the new maximum ]
+	x->maxDelay = (t_sample)newMaxDelay;
+	amstring_setDelayTime(x, x->params.delayTime + 1.0);
+	return 1;
+}
+
+/*
+ * Called by the perform routine at the start of a vector when a new block is waiting (see
+ * amstring_setMaxDelay). The hot state is carried over, with as much of the delay line's
+ * history as fits in the new one, oldest first from its start, so the string carries on
+ * as it was. (The history copied is at most the smaller of the two maximum delays.)
+ */
+void amstring_swapMemory(t_amstring *x)
+{
+	// [ the block swapped out last time has to be freed first ]
+	if(x->retiredMemory.load(std::memory_order_acquire)) return;
+	void* memory = x->pendingMemory.exchange(NULL, std::memory_order_acq_rel);
+	if(!memory) return;
+
+	t_amstring_hot* old = x->hot;
+	t_amstring_hot* hot = amstring_hotOf(memory);
+	t_amsample* delayLine = hot->delayLine;
+	long delayLineLength = hot->delayLineLength;
+	t_sample maxDelay = hot->maxDelay;
+	*hot = *old;
+	hot->delayLine = delayLine;
+	hot->delayLineLength = delayLineLength;
+	hot->maxDelay = maxDelay;
+
+	// [ the n most recent samples (those written since the last clear, at most) ]
+	long n = old->dirty < old->delayLineLength ? old->dirty : old->delayLineLength;
+	if(n > delayLineLength) n = delayLineLength;
+	long start = old->dlWrite - n;
+	if(start < 0) start += old->delayLineLength;
+	long first = n < old->delayLineLength - start ? n : old->delayLineLength - start;
+	memcpy(delayLine, old->delayLine + start, first * sizeof(t_amsample));
+	memcpy(delayLine + first, old->delayLine, (n - first) * sizeof(t_amsample));
+
+	// [ mirror the end of the delay line into the guard zone ]
+	for(long i = delayLineLength - DLGUARD; i < n; i++) delayLine[i - delayLineLength] = delayLine[i];
+
+	hot->dlWrite = n < delayLineLength ? n : 0;
+	hot->dirty = n;
+
+	void* oldMemory = x->memory;
+	x->memory = memory;
+	x->hot = hot;
+	x->retiredMemory.store(oldMemory, std::memory_order_release);
+}
+
+/*
+ * Free the block swapped out by the last resize, once the perform routine has finished with
+ * it. Returns 1 while a resize is still under way (a block waiting to be swapped in, or one
+ * swapped out since the check).
+ */
+long amstring_collectMemory(t_amstring *x)
+{
+	amstring_freeMemory(x->retiredMemory.exchange(NULL, std::memory_order_acq_rel));
+	return x->pendingMemory.load(std::memory_order_acquire) != NULL || x->retiredMemory.load(std::memory_order_acquire) != NULL;
+}
+
+/*
+ * Free all of the string's memory, once the perform routine can no longer be called
+ */
+void amstring_releaseMemory(t_amstring *x)
+{
+	amstring_freeMemory(x->pendingMemory.exchange(NULL, std::memory_order_acq_rel));
+	amstring_freeMemory(x->retiredMemory.exchange(NULL, std::memory_order_acq_rel));
+	amstring_freeMemory(x->memory);
+	x->memory = NULL;
+	x->hot = NULL;
+}
+
+/*
+ * Initialise a string whose maxDelay and memory block have already been set up by the caller.
+ */
+void amstring_init(t_amstring *x)
+{
+	// [ start at the default order ]
+	x->params.order = VD_FILTER_ORDER;
+	
+	// [ choose the interpolation kernels, and make sure the shared coefficient tables exist before the audio thread needs them ]
+	amstring_simdInit();
+	amstring_lagTable(x->params.order);
+	amstring_farrowTable(x->params.order);
+	x->params.interpMode = x->interpMode = AMSTRING_INTERP_EXACT;
+	x->params.controlBlock = x->controlBlock = 0;
+	x->sig_coeffs.order = 0; // ( no constant signal coefficients yet )
+	x->params.sleepThreshold = AMSTRING_SILENCE;
+
+	// [ likewise the shared excitation tables, and start with no pluck pending ]
+	amstring_exciteTable(AMSTRING_PLUCK_NOISE);
+	x->params.pluckLevel = 0.0;
+	x->params.pluckShape = AMSTRING_PLUCK_NOISE;
+	x->params.pluckCount = x->pluckTaken = 0;
+	x->params.clearCount = x->clearTaken = 0;
+	x->hot->pluckLevel = 0.0;
+	x->pluckShape = AMSTRING_PLUCK_NOISE;
+
+	// [ start the performance counters ]
+	amstring_statsClear(&x->stats);
+
+	// [ initilialise object variables ]
+	amstring_clear(x);
+    x->params.fbgain = 0.99;
+    x->params.highFreqGain = 0.9;
+
+	// [ set default constant delay time ]
+	// ( 50 samples definitely ok, since mininimum allowed maxDelay is 100 )
+	x->coeffBack = 0;
+	x->coeffMiddle.store(1, std::memory_order_relaxed);
+	x->coeffFront = 2;
+	amstring_setDelayTime(x, (double)50.0);
+
+	// [ and start the perform routine with those coefficients ]
+	amstring_takeCoeffs(x);
+}
+
+/*
+ * Set the interpolation order: odd, from 1 to AMSTRING_MAXORDER (an even order is
+ * rounded up). The delay time is clamped to the minimum for the new order, and the
+ * coefficients recalculated.
+ */
+void amstring_setOrder(t_amstring *x, long newOrder)
+{
+    if ( newOrder < 1 ) {
+        newOrder = 1;
+    }
+    else if ( newOrder > AMSTRING_MAXORDER ) {
+        newOrder = AMSTRING_MAXORDER;
+    }
+    else if ( !(newOrder & 1) ) {
+        newOrder++;
+    }
+
+    // [ make sure the shared coefficient tables for the order exist before the audio thread needs them ]
+    amstring_lagTable(newOrder);
+    amstring_farrowTable(newOrder);
+
+    x->params.order = newOrder;
+    amstring_setDelayTime(x, x->params.delayTime + 1.0);
+}
+
+/*
+ * Calculate the coefficients of the D.C. Blocking HPF for the given sample rate, and pass
+ * them to the perform routine
+ */
+void amstring_calcDcbCoeffs(t_amstring *x, double samplerate)
+{
+    amstring_calcDcbCoeffsFor(samplerate, &x->params.dcb_a0, &x->params.dcb_a1, &x->params.dcb_b1);
+    amstring_publishCoeffs(x);
+}
+
+void amstring_calcDcbCoeffsFor(double samplerate, t_amsample* dcb_a0, t_amsample* dcb_a1, t_amsample* dcb_b1)
+{
+    t_sample sr = samplerate;
+    t_sample hpfcutoff = TWOPI * 20.0 / sr; // High-pass cutoff in radians/sample.
+    t_sample a0 = 1.0 / (1.0 + (hpfcutoff/2.0) );
+    *dcb_a0 = (t_amsample)a0;
+    *dcb_a1 = (t_amsample)-a0;
+    *dcb_b1 = (t_amsample)(a0 * (1.0 - (hpfcutoff/2.0)));
+}
+
+/*
+ * Set the delay time.
+ */
+void amstring_setDelayTime(t_amstring *x, double newTime)
+{
+	if(newTime > (double)x->maxDelay)
+	{
+		newTime = (double)x->maxDelay;
+	}
+	if( !(newTime >= AMSTRING_MINDELAY(x->params.order)) ) // ( also catches NaN )
+	{
+		newTime = AMSTRING_MINDELAY(x->params.order) ;
+	}
+
+    // [ set the delay time to 1.0 less than requested because of LPF ]
+	x->params.delayTime = (t_sample)newTime - 1.0;
+
+	// [ calculate Lagrange filter coefficients for constant period, and the allpass coefficients for the Thiran mode ]
+	amstring_calcLagrangeCoeffsFor(x->params.order, x->params.delayTime, x->params.lc);
+	x->params.ap_dt = amstring_calcThiranCoeffsFor(x->params.delayTime, &x->params.ap_a1, &x->params.ap_a2);
+
+    // [ recalculate lowpass filter coefficients, and pass the new set to the perform routine ]
+    amstring_calcLpfCoeffs(x);
+    amstring_publishCoeffs(x);
+}
+
+/*
+ * Calculate the Lagrange filter coefficients (zero-padded to AMSTRING_PADDED(order)) for a
+ * given order and constant (already reduced by 1.0) delay time. Returns the integer part
+ * of the delay, dt.
+ */
+t_int amstring_calcLagrangeCoeffsFor(long order, t_sample delayTime, t_amsample* lc)
+{
+	// [ calculate integer part of the delay time, dt. ]
+	t_int dt = (t_int)floor(delayTime - AMSTRING_DELOFFSET(order));
+
+	// [ calculate fractional part of the delay time ]
+	t_sample D = delayTime - (t_sample)dt;
+
+	// [ calculate coefficients ]
+	for(int i=0; i<=order; i++)
+	{
+		t_sample c = 1.0;
+		for(int k=0; k<=order; k++)
+		{
+			if(k!=i) { c *= (D-(t_sample)k)/((t_sample)(i-k)); }
+		}
+		lc[i] = (t_amsample)c;
+	}
+	for(int i=order+1; i<AMSTRING_PADDED(order); i++) lc[i] = 0.0;
+
+	return dt;
+}
+
+/*
+ * Calculate the coefficients of the second-order Thiran allpass for a constant (already reduced
+ * by 1.0) delay time. The allpass gives the delay between AMSTRING_THIRAN_DELOFF and
+ * AMSTRING_THIRAN_DELOFF + 1.0 samples, where it is stable and its group delay flattest, after
+ * a delay line tap of the rest. Returns the tap's (integer) delay, or 0 if the delay time is
+ * too short for a tap of at least one sample (the constant-period routine then uses the lagrange
+ * filter).
+ *
+ * H(z) = (a2 + a1 z^-1 + z^-2) / (1 + a1 z^-1 + a2 z^-2)
+ * a1 = -2 (d - 2) / (d + 1),  a2 = (d - 1)(d - 2) / ((d + 1)(d + 2))
+ */
+t_int amstring_calcThiranCoeffsFor(t_sample delayTime, t_amsample* ap_a1, t_amsample* ap_a2)
+{
+	t_int dt = (t_int)floor(delayTime - AMSTRING_THIRAN_DELOFF);
+	if( !(dt >= 1) ) {
+		*ap_a1 = 0.0;
+		*ap_a2 = 0.0;
+		return 0;
+	}
+	t_sample d = delayTime - (t_sample)dt;
+	*ap_a1 = (t_amsample)(-2.0 * (d - 2.0) / (d + 1.0));
+	*ap_a2 = (t_amsample)((d - 1.0) * (d - 2.0) / ((d + 1.0) * (d + 2.0)));
+	return dt;
+}
+
+/*
+ * Calculate the control-rate LPF coefficients
+ */
+void amstring_calcLpfCoeffs(t_amstring* x)
+{
+    amstring_calcLpfCoeffsFor(x->params.delayTime, x->params.fbgain, x->params.highFreqGain, &x->params.lpf_a0, &x->params.lpf_a1);
+}
+
+/*
+ * Calculate LPF coefficients for a given (already reduced by 1.0) delay time and gains
+ */
+void amstring_calcLpfCoeffsFor(t_sample delayTime, t_sample fbgain, t_sample highFreqGain, t_amsample* lpf_a0, t_amsample* lpf_a1)
+{
+    t_sample omega0 = TWOPI / ( delayTime + 1.0 ); // delayTime has been reduced by 1.0 to compensate for LPF, so omega0 must be calc'd with delayTime+1.0
+    t_sample a1 = ( fbgain + highFreqGain * fbgain * cos(omega0) ) / ( 1.0 + cos(omega0) );
+    t_sample a0 = ( a1 - highFreqGain * fbgain ) * 0.5;
+
+    if ( a0 < 0.0 ) {
+        a0 = 0.0;
+        a1 = fbgain;
+    }
+    *lpf_a0 = (t_amsample)a0;
+    *lpf_a1 = (t_amsample)a1;
+}
+
+/*
+ * Pass a copy of the current set of coefficients (x->params) to the perform routine,
+ * replacing any it has not taken yet. (Called by the message setters, on one thread at a time.)
+ */
+void amstring_publishCoeffs(t_amstring *x)
+{
+	x->coeffSlots[x->coeffBack] = x->params;
+	x->coeffBack = x->coeffMiddle.exchange(x->coeffBack | AMSTRING_COEFFS_NEW, std::memory_order_acq_rel) & ~AMSTRING_COEFFS_NEW;
+}
+
+/*
+ * Called by the perform routine at the start of a vector when a new set of coefficients has
+ * been published: take the newest, and copy it into the hot state. A clear or pluck that
+ * the set asks for is done here too (the clear first, so that a pluck after it is kept).
+ */
+void amstring_takeCoeffs(t_amstring *x)
+{
+	x->coeffFront = x->coeffMiddle.exchange(x->coeffFront, std::memory_order_acq_rel) & ~AMSTRING_COEFFS_NEW;
+	const t_amstring_coeffs* c = &x->coeffSlots[x->coeffFront];
+	t_amstring_hot* hot = x->hot;
+
+	// [ the control-rate ramps start again after a change of order, and the allpass state after a change of its coefficients ]
+	if(c->order != hot->order) x->ctl_valid = 0;
+	if(c->ap_a1 != hot->ap_a1 || c->ap_a2 != hot->ap_a2 || c->ap_dt != hot->ap_dt) hot->ap_valid = 0;
+
+	hot->order = c->order;
+	hot->delayTime = c->delayTime;
+	hot->fbgain = c->fbgain;
+	hot->highFreqGain = c->highFreqGain;
+	hot->lpf_a0 = c->lpf_a0;
+	hot->lpf_a1 = c->lpf_a1;
+	for(int i=0; i<AMSTRING_MAXPADDED; i++) hot->lc[i] = c->lc[i];
+	hot->ap_a1 = c->ap_a1;
+	hot->ap_a2 = c->ap_a2;
+	hot->ap_dt = c->ap_dt;
+	hot->dcb_a0 = c->dcb_a0;
+	hot->dcb_a1 = c->dcb_a1;
+	hot->dcb_b1 = c->dcb_b1;
+	x->interpMode = c->interpMode;
+	if(c->controlBlock != x->controlBlock) {
+		x->controlBlock = c->controlBlock;
+		x->ctl_valid = 0;
+	}
+	if(c->sleepThreshold != hot->sleepThreshold) {
+		hot->sleepThreshold = c->sleepThreshold;
+		hot->silentSamples = 0;
+	}
+
+	if(c->clearCount != x->clearTaken) {
+		x->clearTaken = c->clearCount;
+		amstring_clear(x);
+	}
+	if(c->pluckCount != x->pluckTaken) {
+		x->pluckTaken = c->pluckCount;
+		x->pluckShape = c->pluckShape;
+		hot->pluckLevel = c->pluckLevel;
+	}
+}
+
+/*
+ * Set the feedback gain (sustain)
+ */
+void amstring_setFbGain(t_amstring *x, double newFbGain)
+{
+    if ( newFbGain < -MAXFBGAIN ) {
+        x->params.fbgain = -MAXFBGAIN;
+    }
+    else if ( newFbGain > MAXFBGAIN ) {
+        x->params.fbgain = MAXFBGAIN;
+    }
+    else {
+        x->params.fbgain = newFbGain;
+    }
+
+    // [ recalculate lowpass filter coefficients, and pass the new set to the perform routine ]
+    amstring_calcLpfCoeffs(x);
+    amstring_publishCoeffs(x);
+}
+
+/*
+ * Set the 'brightness'
+ * This must be between 0.0 and MAXFBGAIN, since the two gains must have the same sign.
+ */
+void amstring_setBrightness(t_amstring *x, double newBrightness)
+{
+    if ( newBrightness > MAXFBGAIN ) {
+        x->params.highFreqGain = MAXFBGAIN;
+    }
+    else if ( newBrightness < 0.0 ) {
+        x->params.highFreqGain = 0.0;
+    }
+    else {
+        x->params.highFreqGain = (t_sample)newBrightness;
+    }
+
+    // [ recalculate lowpass filter coefficients, and pass the new set to the perform routine ]
+    amstring_calcLpfCoeffs(x);
+    amstring_publishCoeffs(x);
+}
+
+/*
+ * Set how the lagrange coefficients are obtained under audio-rate delay time, or the
+ * Thiran allpass for constant delay time (see AMSTRING_INTERP_... in am.string.core.h)
+ */
+void amstring_setInterp(t_amstring *x, long newMode)
+{
+    if ( newMode < 0 ) {
+        newMode = 0;
+    }
+    else if ( newMode >= AMSTRING_INTERP_NUMMODES ) {
+        newMode = AMSTRING_INTERP_NUMMODES - 1;
+    }
+    // [ make sure the shared LPF table exists before the audio thread needs it (see am.string.lpf.h) ]
+    if ( newMode == AMSTRING_INTERP_TABLE || newMode == AMSTRING_INTERP_TABLE_LINEAR ) {
+        amstring_lpfTable();
+    }
+    x->params.interpMode = newMode;
+    amstring_publishCoeffs(x);
+}
+
+/*
+ * Set the sub-block length for control-rate coefficient updates under
+ * audio-rate period/gain (0 to calculate the coefficients every sample)
+ */
+void amstring_setControlBlock(t_amstring *x, long newBlock)
+{
+    x->params.controlBlock = newBlock > 0 ? newBlock : 0;
+    amstring_publishCoeffs(x);
+}
+
+/*
+ * Set the level below which the string goes to sleep: once its output and input have
+ * both been quieter than this (RMS, per vector) for longer than its period, its state
+ * is cleared and it outputs silence without processing until non-zero input arrives.
+ * 0 disables sleeping.
+ */
+void amstring_setSleep(t_amstring *x, double newThreshold)
+{
+    x->params.sleepThreshold = newThreshold > 0.0 ? (t_sample)newThreshold : 0.0;
+    amstring_publishCoeffs(x);
+}
+
+/*
+ * Handle the 'pluck' message: excite the string with a shape from the shared bank (see
+ * am.string.exciter.h) at a level, scaled like the signal input. The excitation starts at
+ * the beginning of the next vector, replacing any still playing, and is played over one
+ * period of the string (as it is at that moment), so it is added to the loop exactly once.
+ */
+void amstring_pluck(t_amstring *x, double level, long shape)
+{
+    if(level == 0.0) return;
+    x->params.pluckShape = (shape >= 0 && shape < AMSTRING_PLUCK_NUMSHAPES) ? shape : (long)AMSTRING_PLUCK_NOISE;
+    x->params.pluckLevel = (t_sample)level;
+    x->params.pluckCount++;
+    amstring_publishCoeffs(x);
+}
+
+/*
+ * Read the performance counters (from any thread: see am.string.stats.h)
+ */
+void amstring_getStats(t_amstring *x, t_amstring_statsReport *report)
+{
+    t_amstring_stats *s = &x->stats;
+    report->calls = s->calls.load(std::memory_order_relaxed);
+    report->asleepCalls = s->asleepCalls.load(std::memory_order_relaxed);
+    report->constantCalls = s->constantCalls.load(std::memory_order_relaxed);
+    report->samples = s->samples.load(std::memory_order_relaxed);
+    report->ticks = s->ticks.load(std::memory_order_relaxed);
+    report->maxTicks = s->maxTicks.load(std::memory_order_relaxed);
+    report->lastTicks = s->lastTicks.load(std::memory_order_relaxed);
+    report->periodClamps = s->periodClamps.load(std::memory_order_relaxed);
+    report->gainClamps = s->gainClamps.load(std::memory_order_relaxed);
+    report->routine = (long)s->routine.load(std::memory_order_relaxed);
+
+    // [ the tick rate, from the time since the last reset ]
+    uint64_t ticks = amstring_statsClock() - s->startTicks.load(std::memory_order_relaxed);
+    uint64_t nanos = amstring_statsNanos() - s->startNanos.load(std::memory_order_relaxed);
+    report->ticksPerSecond = nanos > 0 ? 1.0e9 * (double)ticks / (double)nanos : 0.0;
+}
+
+/*
+ * Ask the audio thread to zero the performance counters at its next perform call
+ */
+void amstring_resetStats(t_amstring *x)
+{
+    x->stats.resetRequested.store(1, std::memory_order_relaxed);
+}
+
+/*
+ * Handle the 'clear' message: the perform routine clears the string at the start of its
+ * next vector (see amstring_takeCoeffs), so that no other thread touches its state
+ */
+void amstring_clearMessage(t_amstring *x)
+{
+    x->params.clearCount++;
+    amstring_publishCoeffs(x);
+}
+
+/*
+ * Zero everything (called before DSP starts, and by the perform routine).
+ * Writing starts again from the beginning of the delay line after a clear, so only the
+ * first x->hot->dirty samples (and the guard zone, once writing has reached the samples
+ * it mirrors) can be non-zero: just those are zeroed, and a string that has not run
+ * since it was last cleared costs nothing to clear again.
+ */
+void amstring_clear(t_amstring *x)
+{
+	long dirty = x->hot->dirty;
+	if(dirty >= x->hot->delayLineLength - DLGUARD) {
+		memset(x->hot->delayLine - DLGUARD, 0, DLGUARD * sizeof(t_amsample));
+	}
+	if(dirty > 0) {
+		memset(x->hot->delayLine, 0, (dirty < x->hot->delayLineLength ? dirty : x->hot->delayLineLength) * sizeof(t_amsample));
+	}
+	x->hot->dirty = 0;
+	x->hot->dlWrite = 0;
+    x->hot->previousHpfOutput = 0.0;
+    x->hot->previousHpfInput = 0.0;
+    x->hot->lpf_xnminus1 = 0.0;
+    x->hot->lpf_xnminus2 = 0.0;
+    x->hot->ap_ynminus1 = 0.0;
+    x->hot->ap_ynminus2 = 0.0;
+    x->hot->ap_valid = 1; // ( all zero, as the delay line is )
+    x->ctl_valid = 0;
+    x->hot->silentSamples = 0;
+    x->hot->asleep = 0;
+    x->hot->exciteTable = NULL;
+}
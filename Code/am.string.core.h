@@ -0,0 +1,374 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  am.string.core.h
+//  am.string~
+//
+//  The DSP core of am.string~: the string state, the filter constants and the
+//  functions that maintain the coefficients. Nothing in here needs the Max SDK
+//  when AMSTRING_HEADLESS is defined, so the core can be built and benchmarked
+//  on machines without Max (see main.cpp).
+//
+
+#ifndef am_string__am_string_core_h
+#define am_string__am_string_core_h
+
+#ifdef AMSTRING_HEADLESS
+/*
+ * Stand-ins for the few Max SDK definitions used by the DSP core.
+ * These match the definitions in the SDK headers for 64-bit MSP.
+ */
+#include <stddef.h>
+typedef double t_sample;
+typedef ptrdiff_t t_int;
+typedef struct object t_object;
+#ifndef TWOPI
+#define TWOPI 6.28318530717958647692
+#endif
+#else
+#include "ext.h"
+#include "ext_obex.h"
+#include "z_dsp.h"
+#endif
+
+#include <atomic>
+#include "am.string.stats.h"
+
+/*
+ * The sample type of the string engine: its delay lines, coefficients and filter state.
+ * With AMSTRING_FLOAT this is single precision, halving the memory (and cache) taken by
+ * the delay lines and doubling the width of the SIMD kernels. Parameters and the signals
+ * passed in and out of the perform routines stay t_sample (double), so the conversion
+ * happens only at that boundary. (See "Single precision" in README.md for the tuning and
+ * decay-rate errors this introduces.)
+ */
+#ifdef AMSTRING_FLOAT
+typedef float t_amsample;
+#else
+typedef t_sample t_amsample;
+#endif
+
+/*
+ * The interpolation order is chosen per instance (see amstring_setOrder): any odd order
+ * from 1 to AMSTRING_MAXORDER. The perform routines are instantiated for each of them
+ * (see am.string.order.h), with
+ * AMSTRING_PADDED(order) the filter length (order+1) rounded up to a multiple of 8 (see am.string.simd.h)
+ * AMSTRING_DELOFFSET(order) the integer part of the smallest delay the filter can give, floor((order-1)/2)
+ * AMSTRING_MINDELAY(order) the minimum delay that can be requested (1 greater than actual minimum delay)
+ */
+#define AMSTRING_MAXORDER 9
+#define AMSTRING_MAXPADDED 16
+#define AMSTRING_PADDED(order) (((order) + 8) / 8 * 8)
+#define AMSTRING_DELOFFSET(order) ((t_sample)(((order) - 1) / 2))
+#define AMSTRING_MINDELAY(order) (AMSTRING_DELOFFSET(order) + 1.0)
+
+/*
+ * The default order, used by am.polystring~ and by am.string~ unless another is asked for.
+ * In the following,
+ * VD_FILTER_ORDER should be odd
+ * VD_FILTER_LENGTH should be VD_FILTER_ORDER+1
+ * VD_FILTER_PADDED should be 8: the width of the interpolation kernels (see am.string.simd.h)
+ * DELOFFSET should be set using: (t_sample)(floor((VD_FILTER_ORDER-1.0)/2.0));
+ */
+
+#ifdef LITE // Version requiring less computation with lower filter order
+#define VD_FILTER_ORDER 5
+#define VD_FILTER_LENGTH 6
+#define VD_FILTER_PADDED 8
+#define DELOFFSET 2.0
+#define MINDELAY 3.0 // the minimum delay that can be requested (1 greater than actual minimum delay)
+#else
+#define VD_FILTER_ORDER 7
+#define VD_FILTER_LENGTH 8
+#define VD_FILTER_PADDED 8
+#define DELOFFSET 3.0
+#define MINDELAY 4.0 // the minimum delay that can be requested (1 greater than actual minimum delay)
+#endif
+
+#define DLGUARD (AMSTRING_MAXPADDED-1) // samples at the end of the delay line mirrored just before its start (enough for any order)
+
+#define MAXFBGAIN 0.99999 // Max gain in feedback loop (also max relative gain at high freq)
+
+#define DEFAULTMAXDELAY 8192 // Default maximum delay time, in samples
+#define AMSTRING_MINMAXDELAY 100 // Smallest maximum delay time the creation argument or 'maxdelay' message can set, in samples
+
+#define AMSTRING_FLUSH 1.0e-20 // Filter state smaller than this is flushed to zero at the end of each vector (see am.string.fpmode.h)
+
+#define AMSTRING_SILENCE 1.0e-5 // Default sleep threshold: RMS level (-100 dB) below which output and input count as silent
+
+#define AMSTRING_BLOCK 64 // Largest sub-block whose delay line outputs the constant-period loop calculates together (see amstring_dodspConstant)
+#define AMSTRING_BLOCKMIN 32 // Smallest integer delay for which it does so
+
+#define AMSTRING_THIRAN_DELOFF 1.5 // Smallest delay of the Thiran allpass (see amstring_calcThiranCoeffsFor), which gives it between 1.5 and 2.5 samples
+#define AMSTRING_THIRAN_PRIME 48 // Samples of history the allpass state is recalculated from when its coefficients change
+
+/*
+ * How the Lagrange coefficients are obtained when the delay time is an audio-rate signal
+ * (in the two table modes, the LPF coefficients also come from a shared table: see am.string.lpf.h).
+ * The Thiran mode changes the constant-period routine instead.
+ */
+enum {
+	AMSTRING_INTERP_EXACT = 0,      // calculated every sample
+	AMSTRING_INTERP_TABLE,          // nearest phase of the shared coefficient table (see am.string.lagrange.h)
+	AMSTRING_INTERP_TABLE_LINEAR,   // linear interpolation between adjacent phases of the table
+	AMSTRING_INTERP_FARROW,         // Farrow structure: fixed sub-filters combined by a polynomial in the fractional delay
+	AMSTRING_INTERP_THIRAN,         // constant period: a second-order Thiran allpass in place of the lagrange filter (audio-rate: as EXACT)
+	AMSTRING_INTERP_NUMMODES
+};
+
+/*
+ * A complete set of the control-rate parameters and the coefficients calculated from them.
+ * The message setters keep the latest set in x->params and publish a copy of it after each
+ * change (see amstring_publishCoeffs) through a triple buffer, from which the perform routine
+ * takes the newest at the start of a vector: it never sees a set half written, and needs no lock.
+ */
+typedef struct _amstring_coeffs
+{
+	// [ interpolation order (1, 3, 5, 7 or 9) ]
+	long order;
+
+	// [ delay time, reduced by 1 ]
+	t_sample delayTime;
+
+	// [ feedback loop gains ]
+	t_sample fbgain;
+	t_sample highFreqGain; // this is relative to fbgain
+
+	// [ coefficients for LPF ]
+	t_amsample lpf_a0;
+	t_amsample lpf_a1;
+
+	// [ Lagrange coefficients (used when period is constant, zero-padded) ]
+	t_amsample lc[AMSTRING_MAXPADDED];
+
+	// [ Thiran allpass coefficients and the delay line tap it reads (0 if the delay is too short for it: see amstring_calcThiranCoeffsFor) ]
+	t_amsample ap_a1;
+	t_amsample ap_a2;
+	t_int ap_dt;
+
+	// [ coefficients for D.C. Blocking HPF ]
+	t_amsample dcb_a0;
+	t_amsample dcb_a1;
+	t_amsample dcb_b1;
+
+	// [ sleep threshold (see amstring_setSleep), lagrange coefficient mode and control-rate sub-block length ]
+	t_sample sleepThreshold;
+	long interpMode;
+	long controlBlock;
+
+	// [ the latest pluck, and the number of plucks and clears requested so far: the perform routine
+	//   starts the pluck, or clears the string, when it takes a set whose count it has not seen ]
+	t_sample pluckLevel;
+	long pluckShape;
+	long pluckCount;
+	long clearCount;
+
+} t_amstring_coeffs;
+
+#define AMSTRING_COEFFS_NEW 4 // flags the triple buffer's middle slot as newer than the perform routine's
+
+/*
+ * The state read and written by every perform call, kept together at the start of the
+ * string's memory block (see amstring_memorySize) rather than spread through the object
+ * struct, so that a call touches a few consecutive cache lines next to its delay line.
+ * The first line holds what the constant-period routine needs besides its filters.
+ */
+typedef struct _amstring_hot
+{
+	// [ delay line (which starts after a guard zone of DLGUARD samples), its length, and the write index ]
+	// ( the guard zone mirrors the last DLGUARD samples, so the taps for any read position are contiguous )
+	t_amsample* delayLine;
+	long delayLineLength;
+	long dlWrite;
+
+	// [ maximum delay time the delay line allows ]
+	t_sample maxDelay;
+
+	// [ samples written since the delay line was last zeroed (up to delayLineLength): see amstring_clear ]
+	long dirty;
+
+	// [ interpolation order and control-rate delay time, from the coefficient set in use ]
+	long order;
+	t_sample delayTime;
+
+	// [ RMS level below which the output and input count as silent (0: never sleep), for how
+	//   many samples they have been silent, and whether the string is asleep (see amstring_setSleep) ]
+	t_sample sleepThreshold;
+	long silentSamples;
+	long asleep;
+
+	// [ storage for previous output from, and input to, from D.C. Blocking HPF ]
+	t_amsample previousHpfOutput;
+	t_amsample previousHpfInput;
+
+	// [ storage for previous two inputs to LPF ]
+	t_amsample lpf_xnminus1;
+	t_amsample lpf_xnminus2;
+
+	// [ storage for previous two outputs of the Thiran allpass, and whether they belong to its current coefficients ]
+	// ( its previous inputs are read from the delay line )
+	t_amsample ap_ynminus1;
+	t_amsample ap_ynminus2;
+	long ap_valid;
+
+	// [ coefficients for D.C. Blocking HPF (from the coefficient set in use) ]
+	t_amsample dcb_a0;
+	t_amsample dcb_a1;
+	t_amsample dcb_b1;
+
+	// [ coefficients for LPF, and the feedback loop gains they were calculated from (from the coefficient set in use) ]
+	t_amsample lpf_a0;
+	t_amsample lpf_a1;
+	t_sample fbgain;
+	t_sample highFreqGain;
+
+	// [ Thiran allpass coefficients and tap (from the coefficient set in use) ]
+	t_amsample ap_a1;
+	t_amsample ap_a2;
+	t_int ap_dt;
+
+	// [ level of a pluck not yet started by the perform routine (0.0 if none), and the
+	//   excitation table being played (NULL when not exciting): see amstring_pluck ]
+	t_sample pluckLevel;
+	const t_amsample* exciteTable;
+
+	// [ Lagrange coefficients (used when period is constant, zero-padded, from the coefficient set in use) ]
+	t_amsample lc[AMSTRING_MAXPADDED];
+
+} t_amstring_hot;
+
+/*
+ * Object struct Definition
+ */
+typedef struct _amstring
+{
+#ifndef AMSTRING_HEADLESS
+	t_pxobject x_obj;
+#endif
+
+	// [ maximum delay time allowed (user-set when object is created, or by the 'maxdelay' message) ]
+	// ( after a 'maxdelay' message, the delay line follows at the start of the next vector: see amstring_setMaxDelay )
+	t_sample maxDelay;
+
+	// [ memory block holding the hot state and the delay line (see amstring_newMemory), and the hot state in it ]
+	void* memory;
+	t_amstring_hot* hot;
+
+	// [ a block for a new maximum delay, waiting to be swapped in by the perform routine, and the
+	//   block it replaced, waiting to be freed (see amstring_setMaxDelay) ]
+	std::atomic<void*> pendingMemory;
+	std::atomic<void*> retiredMemory;
+#ifndef AMSTRING_HEADLESS
+	void* collectClock;
+#endif
+
+    /*
+     * Control-rate parameters and coefficients (see t_amstring_coeffs)
+     */
+
+	// [ the latest set, as the message setters left it ]
+	t_amstring_coeffs params;
+
+	// [ triple buffer: the setters fill slot coeffBack and exchange it for coeffMiddle (flagged AMSTRING_COEFFS_NEW),
+	//   and the perform routine exchanges its slot coeffFront for coeffMiddle when it is flagged ]
+	t_amstring_coeffs coeffSlots[3];
+	long coeffBack;
+	std::atomic<long> coeffMiddle;
+	long coeffFront;
+
+	// [ lagrange coefficient mode for audio-rate delay time, or the Thiran mode for constant delay time (AMSTRING_INTERP_...),
+	//   from the coefficient set in use ]
+	long interpMode;
+	
+    /*
+     * Control-rate mode for the signal inlets: coefficients are calculated once per sub-block
+     */
+    
+	// [ sub-block length in samples (0: coefficients are calculated every sample), from the coefficient set in use ]
+	long controlBlock;
+	
+	// [ coefficients reached at the end of the last sub-block, and whether they are valid ]
+	t_amsample ctl_lc[AMSTRING_MAXPADDED];
+	t_int ctl_dt;
+	t_amsample ctl_lpf_a0;
+	t_amsample ctl_lpf_a1;
+	long ctl_valid;
+
+    /*
+     * Constant signal inlets: a vector in which the period (and gain) signals hold one value
+     * runs with constant coefficients, as in dodsp1 (see amstring_constantSignals)
+     */
+
+	// [ the coefficients for the last such value: order, clamped delay time, gains, and the lagrange coefficient mode they were calculated in ]
+	t_amstring_coeffs sig_coeffs;
+	long sig_interp;
+
+    /*
+     * Built-in exciter (see amstring_pluck)
+     */
+
+	// [ shape of the pending pluck, and the pluck and clear counts of the coefficient set in use ]
+	long pluckShape;
+	long pluckTaken;
+	long clearTaken;
+
+	// [ read position in the excitation table being played, step per sample and level ]
+	t_sample excitePos;
+	t_sample exciteStep;
+	t_sample exciteLevel;
+
+	// [ performance counters (see am.string.stats.h) ]
+	t_amstring_stats stats;
+
+} t_amstring;
+
+/*
+ * Prototypes
+ */
+
+long amstring_delayLineLengthFor(t_sample maxDelay);
+void* amstring_newMemory(t_sample maxDelay);
+void amstring_freeMemory(void* memory);
+void amstring_setMemory(t_amstring *x, void* memory);
+long amstring_setMaxDelay(t_amstring *x, double newMaxDelay);
+void amstring_swapMemory(t_amstring *x);
+long amstring_collectMemory(t_amstring *x);
+void amstring_releaseMemory(t_amstring *x);
+void amstring_init(t_amstring *x);
+void amstring_setOrder(t_amstring *x, long newOrder);
+void amstring_calcDcbCoeffs(t_amstring *x, double samplerate);
+void amstring_calcDcbCoeffsFor(double samplerate, t_amsample* dcb_a0, t_amsample* dcb_a1, t_amsample* dcb_b1);
+void amstring_clear(t_amstring *x);
+void amstring_clearMessage(t_amstring *x);
+void amstring_setDelayTime(t_amstring *x, double newTime);
+t_int amstring_calcLagrangeCoeffsFor(long order, t_sample delayTime, t_amsample* lc);
+t_int amstring_calcThiranCoeffsFor(t_sample delayTime, t_amsample* ap_a1, t_amsample* ap_a2);
+void amstring_calcLpfCoeffs(t_amstring* x);
+void amstring_publishCoeffs(t_amstring *x);
+void amstring_takeCoeffs(t_amstring *x);
+void amstring_calcLpfCoeffsFor(t_sample delayTime, t_sample fbgain, t_sample highFreqGain, t_amsample* lpf_a0, t_amsample* lpf_a1);
+void amstring_setFbGain(t_amstring *x, double newFbGain);
+void amstring_setBrightness(t_amstring *x, double newBrightness);
+void amstring_setInterp(t_amstring *x, long newMode);
+void amstring_setControlBlock(t_amstring *x, long newBlock);
+void amstring_setSleep(t_amstring *x, double newThreshold);
+void amstring_pluck(t_amstring *x, double level, long shape);
+void amstring_getStats(t_amstring *x, t_amstring_statsReport *report);
+void amstring_resetStats(t_amstring *x);
+
+#endif
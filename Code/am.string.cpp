@@ -45,12 +45,19 @@
 #include "ext_obex.h"
 #include "z_dsp.h"
 #include "am.string.h"
+#include "am.string.simd.h"
+#include "am.string.arena.h"
 #include "am.string.dsp.h"
 
 // using namespace std;
 
 void* amstring_class;
 
+static const char* amstring_interpModeNames[AMSTRING_INTERP_NUMMODES] = { "lagrange (exact coefficients at audio rate)", "lagrange (table, nearest, at audio rate)",
+                                                                           "lagrange (table, interpolated, at audio rate)", "lagrange (farrow at audio rate)",
+                                                                           "thiran allpass at constant period (exact lagrange at audio rate)" };
+static const char* amstring_routineNames[] = { "none (DSP not yet run)", "dodsp1 (signal input only)", "dodsp2 (signal input and period)", "dodsp3 (signal input, gain and period)" };
+
 int C74_EXPORT main(void)
 {
 #ifdef _DEBUG_
@@ -65,12 +72,19 @@ int C74_EXPORT main(void)
     class_addmethod(c, (method)amstring_dsp64,           "dsp64",	     A_CANT, A_NOTHING); // New 64-bit MSP dsp chain compilation for Max 6
 	class_addmethod(c, (method)amstring_info,            "info",         A_NOTHING);
 	class_addmethod(c, (method)amstring_params,          "params",       A_NOTHING);
+	class_addmethod(c, (method)amstring_stats,           "stats",        A_DEFSYM, A_NOTHING);
 	class_addmethod(c, (method)amstring_assist,          "assist",       A_CANT, A_NOTHING);
-	class_addmethod(c, (method)amstring_clear,           "clear",        A_NOTHING);
+	class_addmethod(c, (method)amstring_clearMessage,    "clear",        A_NOTHING);
 	class_addmethod(c, (method)amstring_setDelayTime,	 "period",       A_FLOAT, A_NOTHING);
     class_addmethod(c, (method)amstring_setFbGain,       "gain",         A_FLOAT, A_NOTHING);
     class_addmethod(c, (method)amstring_setBrightness,   "brightness",   A_FLOAT, A_NOTHING);
     class_addmethod(c, (method)amstring_setFbGain,       "fbgain",       A_FLOAT, A_NOTHING); // for backwards compatibility: same as 'gain' message
+    class_addmethod(c, (method)amstring_setInterp,       "interp",       A_LONG, A_NOTHING);
+    class_addmethod(c, (method)amstring_setControlBlock, "controlrate",  A_LONG, A_NOTHING);
+    class_addmethod(c, (method)amstring_setSleep,        "sleep",        A_FLOAT, A_NOTHING);
+    class_addmethod(c, (method)amstring_setOrder,        "order",        A_LONG, A_NOTHING);
+    class_addmethod(c, (method)amstring_pluck,           "pluck",        A_FLOAT, A_DEFLONG, A_NOTHING);
+    class_addmethod(c, (method)amstring_maxdelay,        "maxdelay",     A_FLOAT, A_NOTHING);
 	
 	class_dspinit(c);
 	class_register(CLASS_BOX, c);
@@ -90,15 +104,11 @@ void amstring_dsp64(t_amstring *x, t_object *dsp64, short *count, double sampler
 #ifdef _DEBUG_
 	post("am.string~ dsp64 called: sample rate is: %f", samplerate);
 #endif
-    // [ clear delay lines and previous filter outputs ]
-    amstring_clear(x);
+    // [ clear delay lines and previous filter outputs (at the start of the first vector) ]
+    amstring_clearMessage(x);
     
     // [ get coefficients of the D.C. Blocking HPF ]
-    t_sample sr = samplerate;
-    t_sample hpfcutoff = TWOPI * 20.0 / sr; // High-pass cutoff in radians/sample.
-    x->dcb_a0 = 1.0 / (1.0 + (hpfcutoff/2.0) );
-    x->dcb_a1 = -x->dcb_a0;
-    x->dcb_b1 = x->dcb_a0 * (1.0 - (hpfcutoff/2.0));
+    amstring_calcDcbCoeffs(x, samplerate);
     
 	if( !count [1] && !count[2] ) { // [ only leftmost signal input connected, no lowpass filter ]
 #ifdef _DEBUG_
@@ -147,36 +157,40 @@ void* amstring_new(t_symbol *s, short argc, t_atom* argv)
 	
 	/*
 	 * Parse arguments to object.
-     * (There is one optional argument: the maximum delay time in samples.)
+     * (There are two optional arguments: the maximum delay time in samples, and the
+     * interpolation order, 1, 3, 5, 7 or 9.)
 	 */
 
-	x->maxDelay = 8192.0;
+	x->maxDelay = (t_sample)DEFAULTMAXDELAY;
 
 	if(argc>0 && argv[0].a_type == A_LONG) {
         maxDelay = argv[0].a_w.w_long;
-        if(maxDelay < 8192) maxDelay = 8192;
+        if(maxDelay < AMSTRING_MINMAXDELAY) maxDelay = AMSTRING_MINMAXDELAY;
         x->maxDelay = (t_sample)maxDelay;
 	}
     
     /*
      * Initialise everything
      */
-		
-	// [ pre-calculate the constant coefficiencts for lagrange coefficient calculation ]
-	amstring_ccCalc(x);
 	
-	// [ allocate and zero memory for the main delay line using Max SDK cross-platform function ]
-	x->delayLineLength = (long)x->maxDelay + (long)ceil(VD_FILTER_ORDER/2.0);
-	x->delayLine = (t_sample *)sysmem_newptrclear(x->delayLineLength*sizeof(t_sample));
+	// [ allocate and zero memory for the hot state and delay line (see amstring_newMemory) ]
+	void* memory = amstring_newMemory(x->maxDelay);
+	if(!memory) {
+		object_error((t_object *)x, "not enough memory for a maximum delay of %.0f samples", (double)x->maxDelay);
+		object_free(x);
+		return NULL;
+	}
+	amstring_setMemory(x, memory);
+
+	// [ clock to free the old delay line after a 'maxdelay' message ]
+	x->collectClock = clock_new(x, (method)amstring_collect);
 	
-	// [ initilialise object variables ]
-	amstring_clear(x);
-    x->fbgain = 0.99;
-    x->highFreqGain = 0.9;
+	// [ initialise coefficients, filter state and default parameters ]
+	amstring_init(x);
 	
-	// [ set default constant delay time ]
-	// ( 50 samples definitely ok, since mininimum allowed maxDelay is 100 )
-	amstring_setDelayTime(x, (double)50.0);
+	if(argc>1 && argv[1].a_type == A_LONG) {
+        amstring_setOrder(x, argv[1].a_w.w_long);
+	}
 	
 	// [ return pointer to object ]
 	return x;
@@ -190,138 +204,37 @@ void amstring_free(t_amstring *x)
 	// [ dsp_free - needs to be called before memory is deallocated ]
 	dsp_free(&(x->x_obj));
 	
-	// [ free memory allocated dynamically for delay line ]
-	sysmem_freeptr(x->delayLine);
+	// [ free memory allocated dynamically for delay line (and any replacement for it) ]
+	object_free(x->collectClock);
+	amstring_releaseMemory(x);
 }
 
 /*
- * Function to pre-calculate the constant coefficients needed to speed up calculation
- * of the lagrange coefficients.
- */
-void amstring_ccCalc(t_amstring *x)
-{
-	int n,k;
-	for(n=0; n<=VD_FILTER_ORDER; n++)
-	{
-		x->cc[n] = 1.0;
-		for(k=0; k<=VD_FILTER_ORDER; k++)
-		{
-			if(k!=n) {x->cc[n] = x->cc[n] * 1.0/((t_sample)(n-k));}
-		}
-	}
-}
-
-/****************************************************************************************************
- * Message handler functions
- */
-
-/*
- * Set the delay time.
+ * Handle the 'maxdelay' message: the new delay line is swapped in by the perform routine
+ * (see amstring_setMaxDelay), and the clock frees the old one once it has been.
  */
-void amstring_setDelayTime(t_amstring *x, double newTime)
+void amstring_maxdelay(t_amstring *x, double newMaxDelay)
 {
-	if(newTime > (double)x->maxDelay)
-	{
-		newTime = (double)x->maxDelay;
-	}
-	if( newTime < MINDELAY )
-	{
-		newTime = MINDELAY ;
+	amstring_collectMemory(x);
+	if(!amstring_setMaxDelay(x, newMaxDelay)) {
+		object_error((t_object *)x, "not enough memory for a maximum delay of %.0f samples", newMaxDelay);
+		return;
 	}
-    
-    // [ set the delay time to 1.0 less than requested because of LPF ]
-	x->delayTime = (t_sample)newTime - 1.0;
-	
-	/*
-	 * Calculate Lagrange filter coefficients for constant period
-	 */	
-	
-	// [ calculate integer part of the delay time, dt. ]
-	t_int dt = (t_int)floor(x->delayTime - DELOFFSET);
-	
-	// [ calculate fractional part of the delay time ]
-	t_sample D = x->delayTime - (t_sample)dt;
-	
-	// [ calculate coefficients ]
-	for(int i=0; i<=VD_FILTER_ORDER; i++)
-	{
-		x->lc[i] = 1.0;
-		for(int k=0; k<=VD_FILTER_ORDER; k++)
-		{
-			if(k!=i) { x->lc[i] *= (D-(t_sample)k)/((t_sample)(i-k)); }
-		}
-	}
-    
-    // [ recalculate lowpass filter coefficients ]
-    amstring_calcLpfCoeffs(x);
-}
-
-/*
- * Calculate the control-rate LPF coefficients
- */
-void amstring_calcLpfCoeffs(t_amstring* x)
-{
-    t_sample omega0 = TWOPI / ( x->delayTime + 1.0 ); // delayTime has been reduced by 1.0 to compensate for LPF, so omega0 must be calc'd with delayTime+1.0
-    x->lpf_a1 = ( x->fbgain + x->highFreqGain * x->fbgain * cos(omega0) ) / ( 1.0 + cos(omega0) );
-    x->lpf_a0 = ( x->lpf_a1 - x->highFreqGain * x->fbgain ) * 0.5;
-
-    if ( x->lpf_a0 < 0.0 ) {
-        x->lpf_a0 = 0.0;
-        x->lpf_a1 = x->fbgain;
-    }
+	clock_fdelay(x->collectClock, AMSTRING_COLLECT_INTERVAL);
 }
 
 /*
- * Set the feedback gain (sustain)
+ * Free the old delay line once the perform routine has swapped in the new one. (While DSP
+ * is off the swap waits for it to be turned on, so the clock keeps checking.)
  */
-void amstring_setFbGain(t_amstring *x, double newFbGain)
+void amstring_collect(t_amstring *x)
 {
-    if ( newFbGain < -MAXFBGAIN ) {
-        x->fbgain = -MAXFBGAIN;
-    }
-    else if ( newFbGain > MAXFBGAIN ) {
-        x->fbgain = MAXFBGAIN;
-    }
-    else {
-        x->fbgain = newFbGain;
-    }
-    
-    // [ recalculate lowpass filter coefficients ]
-    amstring_calcLpfCoeffs(x);
-}
-
-/*
- * Set the 'brightness'
- * This must be between 0.0 and MAXFBGAIN, since the two gains must have the same sign.
- */
-void amstring_setBrightness(t_amstring *x, double newBrightness)
-{
-    if ( newBrightness > MAXFBGAIN ) {
-        x->highFreqGain = MAXFBGAIN;
-    }
-    else if ( newBrightness < 0.0 ) {
-        x->highFreqGain = 0.0;
-    }
-    else {
-        x->highFreqGain = (t_sample)newBrightness;
-    }
-    
-    // [ recalculate lowpass filter coefficients ]
-    amstring_calcLpfCoeffs(x);
+	if(amstring_collectMemory(x)) clock_fdelay(x->collectClock, AMSTRING_COLLECT_INTERVAL);
 }
 
-/*
- * Handle the 'clear' message by zeroing everything.
+/****************************************************************************************************
+ * Message handler functions
  */
-void amstring_clear(t_amstring *x)
-{
-	for(long i=0; i < x->delayLineLength; i++) x->delayLine[i] = 0.0;
-	x->dlWrite = 0;
-    x->previousHpfOutput = 0.0;
-    x->previousHpfInput = 0.0;
-    x->lpf_xnminus1 = 0.0;
-    x->lpf_xnminus2 = 0.0;
-}
 
 /*
  * Provide tooltips for inlets and outlets
@@ -339,7 +252,7 @@ void amstring_assist(t_amstring *x, void *box, long msg, long arg, char *dstStri
 				sprintf(dstString,"gain multiplier (signal, min: %.5lf, max: %.5lf )", -MAXFBGAIN, MAXFBGAIN);
 			break;
 			case 2:
-				sprintf(dstString,"delay time in samples (signal, min: %.1lf, max: %.1lf )", MINDELAY, x->maxDelay);
+				sprintf(dstString,"delay time in samples (signal, min: %.1lf, max: %.1lf )", AMSTRING_MINDELAY(x->params.order), x->maxDelay);
 			break;
 		}
 	}
@@ -360,21 +273,55 @@ void amstring_assist(t_amstring *x, void *box, long msg, long arg, char *dstStri
 void amstring_params(t_amstring *x)
 {
 	post("---------------------------------------------------");
-	post("am.string~ filter order, M = %ld",VD_FILTER_ORDER);
-	post("am.string~ always ensure that: %.1f <= delay time <= %.1f samples",MINDELAY,(t_sample)(x->maxDelay));
-#ifdef _DEBUG_			
-	post("am.string~ x->dlwrite: %d",x->dlWrite);
-#endif
-	post("am.string~ feedback gain at fundamental: %f dB ( %f )", 20*log10(x->fbgain), x->fbgain );
-    post("am.string~ relative high-frequency gain: %f dB ( %f )", 20*log10(x->highFreqGain), x->highFreqGain );
-    post("am.string~ feedback gain at Nyquist: %f dB ( %f )",     20*log10(x->fbgain * x->highFreqGain), x->fbgain * x->highFreqGain );
-	post("am.string~ control rate delay period: %f samples",      x->delayTime+1.0);
+	post("am.string~ filter order, M = %ld",x->params.order);
+	post("am.string~ always ensure that: %.1f <= delay time <= %.1f samples",AMSTRING_MINDELAY(x->params.order),(t_sample)(x->maxDelay));
+	post("am.string~ feedback gain at fundamental: %f dB ( %f )", 20*log10(x->params.fbgain), x->params.fbgain );
+    post("am.string~ relative high-frequency gain: %f dB ( %f )", 20*log10(x->params.highFreqGain), x->params.highFreqGain );
+    post("am.string~ feedback gain at Nyquist: %f dB ( %f )",     20*log10(x->params.fbgain * x->params.highFreqGain), x->params.fbgain * x->params.highFreqGain );
+	post("am.string~ control rate delay period: %f samples",      x->params.delayTime+1.0);
+	post("am.string~ interpolation: %s",                           amstring_interpModeNames[x->params.interpMode]);
+	if(x->params.controlBlock) post("am.string~ signal inlets read every %ld samples (coefficients ramped in between)", x->params.controlBlock);
+	else post("am.string~ signal inlets read every sample");
+	if(x->params.sleepThreshold > 0.0) post("am.string~ sleeps when quieter than: %f dB ( %f )", 20*log10(x->params.sleepThreshold), x->params.sleepThreshold);
+	else post("am.string~ never sleeps");
+	post("am.string~ shared memory arena: %s", amstring_arenaName());
 #ifdef _DEBUG_
-	post("am.string~ actual delay line length: %ld samples",      x->delayLineLength);
+	post("am.string~ actual delay line length: %ld samples",      amstring_delayLineLengthFor(x->maxDelay));
 #endif
 	post("---------------------------------------------------");
 }
 
+/*
+ * Handle the 'stats' message by printing out the performance counters (see am.string.stats.h),
+ * and 'stats reset' by zeroing them
+ */
+void amstring_stats(t_amstring *x, t_symbol *s)
+{
+	t_amstring_statsReport r;
+	if(s == gensym("reset")) {
+		amstring_resetStats(x);
+		return;
+	}
+	amstring_getStats(x, &r);
+
+	double seconds = r.ticksPerSecond > 0.0 ? (double)r.ticks / r.ticksPerSecond : 0.0;
+	double usPerTick = r.ticksPerSecond > 0.0 ? 1.0e6 / r.ticksPerSecond : 0.0;
+	double samplerate = sys_getsr();
+
+	post("---------------------------------------------------");
+	post("am.string~ perform routine: %s", amstring_routineNames[r.routine]);
+	post("am.string~ vectors: %llu (%llu asleep, %llu with constant signal inlets), samples: %llu", (unsigned long long)r.calls, (unsigned long long)r.asleepCalls,
+		 (unsigned long long)r.constantCalls, (unsigned long long)r.samples);
+	if(r.calls) {
+		post("am.string~ time per sample: %.1f ns", r.samples ? 1.0e9 * seconds / (double)r.samples : 0.0);
+		post("am.string~ time per vector: %.2f us average, %.2f us slowest, %.2f us last",
+			 1.0e6 * seconds / (double)r.calls, usPerTick * (double)r.maxTicks, usPerTick * (double)r.lastTicks);
+		if(r.samples && samplerate > 0.0) post("am.string~ DSP load: %.3f%% of one core at %.0f Hz", 100.0 * seconds * samplerate / (double)r.samples, samplerate);
+	}
+	post("am.string~ clamped signal samples: period %llu, gain %llu", (unsigned long long)r.periodClamps, (unsigned long long)r.gainClamps);
+	post("---------------------------------------------------");
+}
+
 /*
  * Handle the 'info' message by printing out object details
  */
@@ -389,6 +336,7 @@ void amstring_info(t_amstring *x)
 #ifdef LITE
     post("LITE Version (minor sound differences: less computationally demanding)");
 #endif
+	post("interpolation kernels: %s", amstring_simdName());
 	post("aengus martin 2013");
 	post("www.am-process.org");
 	post("this version compiled: %s at %s",__DATE__,__TIME__);
@@ -24,65 +24,166 @@
 //
 
 #include <math.h>
-#include "ext.h"
-#include "ext_obex.h"
-#include "z_dsp.h"
-#include "am.string.h"
+#include <string.h>
+#include "am.string.core.h"
+#include "am.string.lagrange.h"
+#include "am.string.lpf.h"
+#include "am.string.simd.h"
+#include "am.string.fpmode.h"
+#include "am.string.order.h"
+#include "am.string.exciter.h"
+#include "am.string.stats.h"
 #include "am.string.dsp.h"
 
 /*
- * Perform function 1: Only leftmost (input) signal connected.
- * ins[0][n]  = leftmost input (signal)
- * outs[0][n] = leftmost output (string output)
+ * Sleeping (see amstring_setSleep)
+ *
+ * At the start of a perform routine: while the string is asleep its state is all zero,
+ * so until the input is non-zero the output is silence. Returns 1 if the vector has
+ * been dealt with. (The input is checked before the output is written, as MSP may pass
+ * the same vector for both.)
  */
-void amstring_dodsp1_64(t_amstring *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam)
+static inline long amstring_sleeping(t_amstring *x, const double *in, double *out, long sampleframes)
+{
+	if(!x->hot->asleep) return 0;
+	for(long j=0; j<sampleframes; j++)
+	{
+		if(in[j] != 0.0) {
+			x->hot->asleep = 0;
+			return 0;
+		}
+	}
+	memset(out, 0, sampleframes * sizeof(double));
+	amstring_statsAdd(&x->stats.asleepCalls, 1);
+	return 1;
+}
+
+/*
+ * At the end of a perform routine, given the sums of squares of the vector's output
+ * and input (and with the string's state stored back in x):
+ *  - count the vector's samples as written to the delay line;
+ *  - if a non-finite value has got into the loop, reset the string and silence the vector;
+ *  - flush filter state that has decayed below AMSTRING_FLUSH to zero;
+ *  - fall asleep if the output and input have been below the threshold for longer than period.
+ */
+static inline void amstring_endOfVector(t_amstring *x, double *out, t_sample outputEnergy, t_sample inputEnergy, long sampleframes, t_sample period)
 {
-	t_int i, j, dt;
-	t_sample D, delayLineOutput;
-	long dlRead[VD_FILTER_LENGTH];
+	// [ the vector has been written to the delay line (see amstring_clear) ]
+	if(x->hot->dirty < x->hot->delayLineLength) x->hot->dirty += sampleframes;
+
+	if(!isfinite(outputEnergy) || !isfinite(x->hot->lpf_xnminus1) || !isfinite(x->hot->lpf_xnminus2) || !isfinite(x->hot->previousHpfInput)
+	   || !isfinite(x->hot->ap_ynminus1) || !isfinite(x->hot->ap_ynminus2)) {
+		amstring_clear(x);
+		memset(out, 0, sampleframes * sizeof(double));
+		return;
+	}
+
+	if(fabs(x->hot->previousHpfOutput) < AMSTRING_FLUSH) x->hot->previousHpfOutput = 0.0;
+	if(fabs(x->hot->previousHpfInput) < AMSTRING_FLUSH) x->hot->previousHpfInput = 0.0;
+	if(fabs(x->hot->lpf_xnminus1) < AMSTRING_FLUSH) x->hot->lpf_xnminus1 = 0.0;
+	if(fabs(x->hot->lpf_xnminus2) < AMSTRING_FLUSH) x->hot->lpf_xnminus2 = 0.0;
+	if(fabs(x->hot->ap_ynminus1) < AMSTRING_FLUSH) x->hot->ap_ynminus1 = 0.0;
+	if(fabs(x->hot->ap_ynminus2) < AMSTRING_FLUSH) x->hot->ap_ynminus2 = 0.0;
+
+	t_sample limit = x->hot->sleepThreshold * x->hot->sleepThreshold * (t_sample)sampleframes;
+	if(outputEnergy >= limit || inputEnergy >= limit) {
+		x->hot->silentSamples = 0;
+		return;
+	}
+	x->hot->silentSamples += sampleframes;
+	if(x->hot->silentSamples > (long)period + x->hot->order + 1) {
+		amstring_clear(x);
+		x->hot->asleep = 1;
+	}
+}
+
+/*
+ * The interpolation kernels for an order: the selected SIMD kernels where the order's filter
+ * fills their span (order 7), otherwise the unrolled kernels of am.string.order.h. (For the
+ * other orders the padding would be wasted work, and the unrolled kernels measured faster.)
+ */
+template<int ORDER> static inline t_amsample amstring_orderTapSum(const t_amsample* lcoeff, const t_amsample* span, t_amstring_tapSumFn tapSum, long simd)
+{
+	if(simd && ORDER + 1 == VD_FILTER_PADDED) return tapSum(lcoeff, span);
+	return amstring_tapSumOrder<ORDER>(lcoeff, span);
+}
+
+template<int ORDER> static inline void amstring_orderLagCoeffs(t_amsample D, const t_amsample* cc, t_amsample* lcoeff, t_amstring_lagCoeffsFn lagCoeffs, long simd)
+{
+	if(simd && ORDER + 1 == VD_FILTER_PADDED) lagCoeffs(D, cc, lcoeff);
+	else amstring_lagCoeffsOrder<ORDER>(D, lcoeff);
+}
+
+template<int ORDER> static inline t_amsample amstring_orderFarrow(const t_amsample* farrowTable, const t_amsample* span, t_amsample d, t_amstring_farrowFn farrow, long simd)
+{
+	if(simd && ORDER + 1 == VD_FILTER_PADDED) return farrow(farrowTable, span, d);
+	return amstring_farrowOrder<ORDER>(farrowTable, span, d);
+}
+
+/*
+ * The constant-coefficient loop: the string with the given (zero-padded) lagrange coefficients,
+ * LPF coefficients and (already reduced by 1.0) delay time throughout the vector. Run by
+ * perform function 1, and by perform functions 2 and 3 when their signal inlets are constant.
+ *
+ * Where the SIMD kernels are used (see amstring_orderTapSum) and dt is at least AMSTRING_BLOCKMIN,
+ * the vector goes in sub-blocks of at most dt samples (and AMSTRING_BLOCK). The taps of every
+ * output of such a sub-block were written before it starts, so the lagrange filter is run over
+ * the whole sub-block first, as one block tap sum over contiguous history (see am.string.simd.h).
+ * So are the LPF, which only feeds forward from the taps, and the feed-forward half of the DC
+ * blocker, and only the DC blocker's one-pole recursion goes sample by sample. A sub-block also
+ * ends where the reads wrap round the delay line, so that its spans are contiguous. Otherwise
+ * the vector goes sample by sample: there the unrolled kernels keep up with the recursion, and
+ * below AMSTRING_BLOCKMIN the block tap sum would read samples still on their way to memory.
+ */
+template<int ORDER> static void amstring_dodspConstant(t_amstring *x, double **ins, double **outs, long sampleframes, const t_amsample* lcoeff, t_amsample lpf_a0, t_amsample lpf_a1, t_sample delayTime)
+{
+	t_amstring_fpmode fpmode = amstring_fpModeEnter();
+	const int PADDED = AMSTRING_PADDED(ORDER);
+	const t_sample DELOFF = AMSTRING_DELOFFSET(ORDER);
+	t_int j, k, dt, n;
+	t_amsample delayLineOutput;
+	t_amsample blockOutput[AMSTRING_BLOCK + 2]; // [ the sub-block's delay line outputs, after the two before it (the LPF state) ]
+	t_amsample hpfInput[AMSTRING_BLOCK + 1]; // [ the sub-block's, after the one before it ]
+	t_amsample hpfForward[AMSTRING_BLOCK]; // [ the part of the DCB output that does not feed back ]
+	t_sample outputEnergy = 0.0, inputEnergy = 0.0;
+	long dlRead;
+	t_amstring_tapSumFn tapSum = amstring_tapSum;
+	t_amstring_blockTapSumFn blockTapSum = amstring_blockTapSum;
+	long simd = !amstring_simdScalar;
 	
     // [ Delay Line ]
-	t_sample* lcoeff = x->lc;
-    t_sample* delayLine = x->delayLine;
-	long dlWrite = x->dlWrite;
-	long delayLineLength = x->delayLineLength;
+    t_amsample* delayLine = x->hot->delayLine;
+	long dlWrite = x->hot->dlWrite;
+	long delayLineLength = x->hot->delayLineLength;
+	long mirrorStart = delayLineLength - DLGUARD;
     
     // [ LPF ]
-    t_sample lpf_a0 = x->lpf_a0; // coefficiencts of LPF
-    t_sample lpf_a1 = x->lpf_a1; // ...
-    t_sample lpf_xnminus1 = x->lpf_xnminus1;
-    t_sample lpf_xnminus2 = x->lpf_xnminus2;
-    t_sample lpf_output; // output of LPF
+    t_amsample lpf_xnminus1 = x->hot->lpf_xnminus1;
+    t_amsample lpf_xnminus2 = x->hot->lpf_xnminus2;
+    t_amsample lpf_output; // output of LPF
 
     // [ DCB ]
-    t_sample previousHpfOutput = x->previousHpfOutput;
-    t_sample previousHpfInput = x->previousHpfInput;
-    t_sample currentHpfInput;
-    t_sample dcb_a0 = x->dcb_a0;
-    t_sample dcb_a1 = x->dcb_a1;
-    t_sample dcb_b1 = x->dcb_b1;
-
-	// [ calculate integer part of delay time, dt. ]
-	dt = (t_int)floor(x->delayTime - DELOFFSET);
-	
-	// [ calculate fractional part of the delay time ]
-	D = x->delayTime - (t_sample)dt;
+    t_amsample previousHpfOutput = x->hot->previousHpfOutput;
+    t_amsample previousHpfInput = x->hot->previousHpfInput;
+    t_amsample currentHpfInput;
+    t_amsample dcb_a0 = x->hot->dcb_a0;
+    t_amsample dcb_a1 = x->hot->dcb_a1;
+    t_amsample dcb_b1 = x->hot->dcb_b1;
+
+	// [ calculate integer part of delay time, dt. (the fractional part is accounted for in lcoeff) ]
+	// ( the delay time can be beyond this delay line only while a longer one waits to be swapped in: see amstring_setMaxDelay )
+	dt = (t_int)floor((delayTime < x->hot->maxDelay ? delayTime : x->hot->maxDelay) - DELOFF);
 	
-	for(j=0; j<sampleframes; j++)
+	// [ sample by sample, or in sub-blocks (see above) ]
+	long blocks = simd && ORDER + 1 == VD_FILTER_PADDED && dt >= AMSTRING_BLOCKMIN;
+	for(j=0; j<sampleframes && !blocks; j++)
     {
-        // [ calculate the positions of the lagrange read pointers ]
-		dlRead[0] = dlWrite - dt;
-		if(dlRead[0] < 0) dlRead[0] += delayLineLength;
-		for(i=1; i<=VD_FILTER_ORDER; i++) {
-			dlRead[i] = dlRead[i-1] - 1;
-			if(dlRead[i] < 0) dlRead[i] += delayLineLength;
-		}
+        // [ calculate the position of the most recent lagrange tap ]
+		dlRead = dlWrite - dt;
+		dlRead += dlRead < 0 ? delayLineLength : 0;
         
         // [ calculate delay line output ]
-		delayLineOutput = lcoeff[0]*delayLine[dlRead[0]];
-		for(i=1; i<=VD_FILTER_ORDER; i++) {
-			delayLineOutput += lcoeff[i]*delayLine[dlRead[i]];
-		}
+		delayLineOutput = amstring_orderTapSum<ORDER>(lcoeff, delayLine + dlRead - (PADDED-1), tapSum, simd);
         
         // [ LPF ]
         lpf_output = lpf_a0 * delayLineOutput + lpf_a1 * lpf_xnminus1 + lpf_a0 * lpf_xnminus2;
@@ -90,21 +191,456 @@ void amstring_dodsp1_64(t_amstring *x, t_object *dsp64, double **ins, long numin
         lpf_xnminus1 = delayLineOutput;
         
         // [ DCB and output]
-        currentHpfInput = lpf_output + ins[0][j];
+        currentHpfInput = lpf_output + (t_amsample)ins[0][j];
+        inputEnergy += ins[0][j] * ins[0][j];
         delayLine[dlWrite] = outs[0][j] = previousHpfOutput = dcb_a0 * currentHpfInput + dcb_a1 * previousHpfInput + dcb_b1 * previousHpfOutput;
+        delayLine[dlWrite >= mirrorStart ? dlWrite - delayLineLength : dlWrite] = previousHpfOutput; // [ mirror into the guard zone (or rewrite the same sample) ]
         previousHpfInput = currentHpfInput;
+        outputEnergy += previousHpfOutput * previousHpfOutput;
         
 		// [ increment write position, folding back to zero if necessary ]
-		dlWrite += 1;
-		if(dlWrite >= delayLineLength) dlWrite = 0;
+		dlWrite = dlWrite + 1 < delayLineLength ? dlWrite + 1 : 0;
+	}
+
+	while(j < sampleframes)
+    {
+		dlRead = dlWrite - dt;
+		dlRead += dlRead < 0 ? delayLineLength : 0;
+        
+        // [ calculate delay line output, for a sub-block of up to dt samples that ends before the reads wrap ]
+		n = sampleframes - j;
+		n = n < AMSTRING_BLOCK ? n : AMSTRING_BLOCK;
+		n = n < dt ? n : dt;
+		n = n < delayLineLength - dlRead ? n : delayLineLength - dlRead;
+		blockTapSum(lcoeff, delayLine + dlRead - (PADDED-1), blockOutput + 2, n);
+		blockOutput[0] = lpf_xnminus2;
+		blockOutput[1] = lpf_xnminus1;
+		hpfInput[0] = previousHpfInput;
+
+		// [ LPF, and the input (read before any output is written, as MSP may pass the same vector for both) ]
+		for(k=0; k<n; k++) {
+			hpfInput[k+1] = lpf_a0 * blockOutput[k+2] + lpf_a1 * blockOutput[k+1] + lpf_a0 * blockOutput[k] + (t_amsample)ins[0][j+k];
+		}
+		for(k=0; k<n; k++) inputEnergy += ins[0][j+k] * ins[0][j+k];
+
+		// [ DCB: the feed-forward terms over the sub-block, then the recursion ]
+		for(k=0; k<n; k++) hpfForward[k] = dcb_a0 * hpfInput[k+1] + dcb_a1 * hpfInput[k];
+		for(k=0; k<n; k++, j++)
+		{
+			delayLine[dlWrite] = outs[0][j] = previousHpfOutput = hpfForward[k] + dcb_b1 * previousHpfOutput;
+			delayLine[dlWrite >= mirrorStart ? dlWrite - delayLineLength : dlWrite] = previousHpfOutput; // [ mirror into the guard zone (or rewrite the same sample) ]
+			outputEnergy += previousHpfOutput * previousHpfOutput;
+			
+			// [ increment write position, folding back to zero if necessary ]
+			dlWrite = dlWrite + 1 < delayLineLength ? dlWrite + 1 : 0;
+		}
+		lpf_xnminus2 = blockOutput[n];
+		lpf_xnminus1 = blockOutput[n+1];
+		previousHpfInput = hpfInput[n];
 	}
 	
     // [ store things for next time ]
-	x->dlWrite = dlWrite;
-    x->previousHpfOutput = previousHpfOutput;
-    x->previousHpfInput = previousHpfInput;
-    x->lpf_xnminus1 = lpf_xnminus1;
-    x->lpf_xnminus2 = lpf_xnminus2;
+	x->hot->dlWrite = dlWrite;
+    x->hot->previousHpfOutput = previousHpfOutput;
+    x->hot->previousHpfInput = previousHpfInput;
+    x->hot->lpf_xnminus1 = lpf_xnminus1;
+    x->hot->lpf_xnminus2 = lpf_xnminus2;
+    
+    amstring_endOfVector(x, outs[0], outputEnergy, inputEnergy, sampleframes, delayTime);
+    amstring_fpModeLeave(fpmode);
+}
+
+/*
+ * Recalculate the Thiran allpass state for its current coefficients: as if the allpass had
+ * always run with them, from the last AMSTRING_THIRAN_PRIME samples at its tap (or as many as
+ * the delay line holds beyond the tap). Its poles are within 0.47 of the origin, so what
+ * came before those samples would be below 1e-15. The allpass then carries on from the
+ * delay line without the transient that switching its coefficients under the old state
+ * would start: only the jump in the delay itself is heard, as with the lagrange filter.
+ */
+static void amstring_primeThiran(t_amstring *x, t_int dt)
+{
+	t_amstring_hot* hot = x->hot;
+	const t_amsample* delayLine = hot->delayLine;
+	long delayLineLength = hot->delayLineLength;
+	t_amsample ap_a1 = hot->ap_a1, ap_a2 = hot->ap_a2;
+	t_amsample x0, x1 = 0.0, x2 = 0.0, y0, y1 = 0.0, y2 = 0.0;
+
+	// [ the history beyond the tap, less the two samples before the oldest ]
+	long n = delayLineLength - (long)dt - 3;
+	n = n < AMSTRING_THIRAN_PRIME ? n : AMSTRING_THIRAN_PRIME;
+
+	long dlRead = hot->dlWrite - (long)dt - n;
+	while(dlRead < 0) dlRead += delayLineLength;
+	for(long k=0; k<n; k++)
+	{
+		x0 = delayLine[dlRead];
+		y0 = ap_a2 * x0 + ap_a1 * x1 + x2 - ap_a1 * y1 - ap_a2 * y2;
+		x2 = x1;
+		x1 = x0;
+		y2 = y1;
+		y1 = y0;
+		dlRead = dlRead + 1 < delayLineLength ? dlRead + 1 : 0;
+	}
+	hot->ap_ynminus1 = y1;
+	hot->ap_ynminus2 = y2;
+	hot->ap_valid = 1;
+}
+
+/*
+ * The constant-period loop of the Thiran mode: a second-order Thiran allpass after a single
+ * delay line tap, in place of the lagrange filter. Its magnitude response is flat, so the
+ * high partials lose nothing to it (the lagrange filter rolls them off slightly when the
+ * delay is near the middle of its range), and it takes four multiplies a sample whatever
+ * the order. Its inputs are read from the delay line, so only its outputs are kept as state.
+ */
+static void amstring_dodspThiran(t_amstring *x, double **ins, double **outs, long sampleframes)
+{
+	t_amstring_fpmode fpmode = amstring_fpModeEnter();
+	t_int j;
+	t_amsample delayLineOutput;
+	t_sample outputEnergy = 0.0, inputEnergy = 0.0;
+	long dlRead;
+
+	// [ the tap, within this delay line (see amstring_dodspConstant), and the allpass state for the current coefficients ]
+	t_int dt = x->hot->ap_dt < (t_int)x->hot->maxDelay ? x->hot->ap_dt : (t_int)x->hot->maxDelay;
+	if(!x->hot->ap_valid) amstring_primeThiran(x, dt);
+
+    // [ Delay Line ]
+    t_amsample* delayLine = x->hot->delayLine;
+	long dlWrite = x->hot->dlWrite;
+	long delayLineLength = x->hot->delayLineLength;
+	long mirrorStart = delayLineLength - DLGUARD;
+
+    // [ allpass ]
+    t_amsample ap_a1 = x->hot->ap_a1;
+    t_amsample ap_a2 = x->hot->ap_a2;
+    t_amsample ap_ynminus1 = x->hot->ap_ynminus1;
+    t_amsample ap_ynminus2 = x->hot->ap_ynminus2;
+
+    // [ LPF ]
+    t_amsample lpf_a0 = x->hot->lpf_a0;
+    t_amsample lpf_a1 = x->hot->lpf_a1;
+    t_amsample lpf_xnminus1 = x->hot->lpf_xnminus1;
+    t_amsample lpf_xnminus2 = x->hot->lpf_xnminus2;
+    t_amsample lpf_output;
+
+    // [ DCB ]
+    t_amsample previousHpfOutput = x->hot->previousHpfOutput;
+    t_amsample previousHpfInput = x->hot->previousHpfInput;
+    t_amsample currentHpfInput;
+    t_amsample dcb_a0 = x->hot->dcb_a0;
+    t_amsample dcb_a1 = x->hot->dcb_a1;
+    t_amsample dcb_b1 = x->hot->dcb_b1;
+
+	for(j=0; j<sampleframes; j++)
+    {
+		dlRead = dlWrite - dt;
+		dlRead += dlRead < 0 ? delayLineLength : 0;
+
+        // [ allpass (the two samples before the tap are in the guard zone when it is at the start of the delay line) ]
+        delayLineOutput = ap_a2 * delayLine[dlRead] + ap_a1 * delayLine[dlRead-1] + delayLine[dlRead-2] - ap_a1 * ap_ynminus1 - ap_a2 * ap_ynminus2;
+        ap_ynminus2 = ap_ynminus1;
+        ap_ynminus1 = delayLineOutput;
+
+        // [ LPF ]
+        lpf_output = lpf_a0 * delayLineOutput + lpf_a1 * lpf_xnminus1 + lpf_a0 * lpf_xnminus2;
+        lpf_xnminus2 = lpf_xnminus1;
+        lpf_xnminus1 = delayLineOutput;
+
+        // [ DCB and output]
+        currentHpfInput = lpf_output + (t_amsample)ins[0][j];
+        inputEnergy += ins[0][j] * ins[0][j];
+        delayLine[dlWrite] = outs[0][j] = previousHpfOutput = dcb_a0 * currentHpfInput + dcb_a1 * previousHpfInput + dcb_b1 * previousHpfOutput;
+        delayLine[dlWrite >= mirrorStart ? dlWrite - delayLineLength : dlWrite] = previousHpfOutput; // [ mirror into the guard zone (or rewrite the same sample) ]
+        previousHpfInput = currentHpfInput;
+        outputEnergy += previousHpfOutput * previousHpfOutput;
+
+		dlWrite = dlWrite + 1 < delayLineLength ? dlWrite + 1 : 0;
+	}
+
+    // [ store things for next time ]
+	x->hot->dlWrite = dlWrite;
+    x->hot->previousHpfOutput = previousHpfOutput;
+    x->hot->previousHpfInput = previousHpfInput;
+    x->hot->lpf_xnminus1 = lpf_xnminus1;
+    x->hot->lpf_xnminus2 = lpf_xnminus2;
+    x->hot->ap_ynminus1 = ap_ynminus1;
+    x->hot->ap_ynminus2 = ap_ynminus2;
+
+    amstring_endOfVector(x, outs[0], outputEnergy, inputEnergy, sampleframes, x->hot->delayTime);
+    amstring_fpModeLeave(fpmode);
+}
+
+/*
+ * Perform function 1: Only leftmost (input) signal connected.
+ * ins[0][n]  = leftmost input (signal)
+ * outs[0][n] = leftmost output (string output)
+ * In the Thiran mode, the allpass takes the place of the lagrange filter (unless the period
+ * is too short for it). Otherwise its state is marked out of date, to be recalculated if the
+ * mode is chosen again.
+ */
+template<int ORDER> static void amstring_dodsp1(t_amstring *x, double **ins, double **outs, long sampleframes)
+{
+	if(amstring_sleeping(x, ins[0], outs[0], sampleframes)) return;
+
+	if(x->interpMode == AMSTRING_INTERP_THIRAN && x->hot->ap_dt > 0) {
+		amstring_dodspThiran(x, ins, outs, sampleframes);
+		return;
+	}
+	x->hot->ap_valid = 0;
+	
+	amstring_dodspConstant<ORDER>(x, ins, outs, sampleframes, x->hot->lc, x->hot->lpf_a0, x->hot->lpf_a1, x->hot->delayTime);
+}
+
+/*
+ * Constant signal inlets (for perform functions 2 and 3)
+ *
+ * Returns 1 if the period signal (and, if gainConnected, the gain signal) holds one value
+ * throughout the vector, leaving the constant coefficients for that value in x->sig_coeffs,
+ * so the vector can be run by amstring_dodspConstant. They are calculated exactly as the
+ * per-sample routines would calculate them, but only when the value (or the order, the
+ * gains or the coefficient mode) has changed since they were last calculated. Under
+ * control-rate updates, a vector only qualifies once the ramps have reached them.
+ * (A connected sig~, or a line~ at the end of its ramp, then costs no more than dodsp1.)
+ */
+template<int ORDER> static inline long amstring_constantSignals(t_amstring *x, double **ins, long sampleframes, int gainConnected)
+{
+	const int PADDED = AMSTRING_PADDED(ORDER);
+	const t_sample DELOFF = AMSTRING_DELOFFSET(ORDER);
+	t_amstring_coeffs* c = &x->sig_coeffs;
+	double period = ins[2][0];
+	double gain = ins[1][0];
+	long i, j;
+
+	// [ compare every sample with the first (a NaN never compares equal, so is left to the per-sample routines) ]
+	for(j=0; j<sampleframes && ins[2][j] == period; j++) ;
+	if(j < sampleframes) return 0;
+	if(gainConnected) {
+		for(j=0; j<sampleframes && ins[1][j] == gain; j++) ;
+		if(j < sampleframes) return 0;
+	}
+
+	// [ clamp the values as the per-sample routines do ]
+	t_sample maxDelay = x->hot->maxDelay;
+	t_sample delayTime = period - 1.0;
+	long periodClamped = !(delayTime >= DELOFF && delayTime <= maxDelay);
+	delayTime = delayTime > maxDelay ? maxDelay : delayTime;
+	delayTime = delayTime >= DELOFF ? delayTime : DELOFF;
+	t_sample fbgain = x->hot->fbgain;
+	long gainClamped = 0;
+	if(gainConnected) {
+		fbgain = gain;
+		gainClamped = !(fbgain >= -MAXFBGAIN && fbgain <= MAXFBGAIN);
+		fbgain = fbgain > MAXFBGAIN ? MAXFBGAIN : fbgain;
+		fbgain = fbgain < -MAXFBGAIN ? -MAXFBGAIN : fbgain;
+	}
+
+	// [ (the control-rate routine always calculates the exact coefficients at the ends of its sub-blocks, and the Thiran mode is exact here) ]
+	long interpMode = x->controlBlock || x->interpMode == AMSTRING_INTERP_THIRAN ? (long)AMSTRING_INTERP_EXACT : x->interpMode;
+	t_int dt = (t_int)floor(delayTime - DELOFF);
+
+	if(c->order != ORDER || c->delayTime != delayTime || c->fbgain != fbgain || c->highFreqGain != x->hot->highFreqGain || x->sig_interp != interpMode)
+	{
+		t_sample D = delayTime - (t_sample)dt;
+		if(interpMode == AMSTRING_INTERP_TABLE) amstring_lagTableNearest(amstring_lagTable(ORDER), PADDED, D - DELOFF, c->lc);
+		else if(interpMode == AMSTRING_INTERP_TABLE_LINEAR) amstring_lagTableLinear(amstring_lagTable(ORDER), PADDED, D - DELOFF, c->lc);
+		else if(interpMode == AMSTRING_INTERP_FARROW) amstring_farrowCoeffs(amstring_farrowTable(ORDER), ORDER, D - DELOFF, c->lc);
+		else amstring_orderLagCoeffs<ORDER>(D, t_amstring_cc<ORDER>::value, c->lc, amstring_lagCoeffs, !amstring_simdScalar);
+		if(interpMode == AMSTRING_INTERP_TABLE || interpMode == AMSTRING_INTERP_TABLE_LINEAR) amstring_lpfTableCoeffs(amstring_lpfTable(), delayTime, fbgain, x->hot->highFreqGain, &c->lpf_a0, &c->lpf_a1);
+		else amstring_calcLpfCoeffsFor(delayTime, fbgain, x->hot->highFreqGain, &c->lpf_a0, &c->lpf_a1);
+		c->order = ORDER;
+		c->delayTime = delayTime;
+		c->fbgain = fbgain;
+		c->highFreqGain = x->hot->highFreqGain;
+		x->sig_interp = interpMode;
+	}
+
+	// [ under control-rate updates: wait for the ramps to arrive (or take the coefficients straight away, as that routine would, if there are no ramps yet) ]
+	if(x->controlBlock) {
+		if(x->ctl_valid) {
+			if(x->ctl_dt != dt || x->ctl_lpf_a0 != c->lpf_a0 || x->ctl_lpf_a1 != c->lpf_a1) return 0;
+			for(i=0; i<PADDED; i++) if(x->ctl_lc[i] != c->lc[i]) return 0;
+		}
+		else {
+			for(i=0; i<PADDED; i++) x->ctl_lc[i] = c->lc[i];
+			x->ctl_dt = dt;
+			x->ctl_lpf_a0 = c->lpf_a0;
+			x->ctl_lpf_a1 = c->lpf_a1;
+			x->ctl_valid = 1;
+		}
+	}
+
+	amstring_statsAdd(&x->stats.constantCalls, 1);
+	if(periodClamped) amstring_statsAdd(&x->stats.periodClamps, (uint64_t)sampleframes);
+	if(gainClamped) amstring_statsAdd(&x->stats.gainClamps, (uint64_t)sampleframes);
+	return 1;
+}
+
+/*
+ * Control-rate processing for perform functions 2 and 3.
+ *
+ * The period (and, if gainConnected, the gain) signals are sampled at the end of each
+ * sub-block of x->controlBlock samples. The lagrange and LPF coefficients are calculated
+ * there only, and ramped linearly from the values reached at the end of the previous
+ * sub-block. If the integer part of the delay changes within a sub-block, the lagrange
+ * coefficients of that sub-block are calculated every sample instead (the LPF coefficients
+ * are still ramped).
+ */
+template<int ORDER> static void amstring_dodspControlRate(t_amstring *x, double **ins, double **outs, long sampleframes, int gainConnected)
+{
+	const int PADDED = AMSTRING_PADDED(ORDER);
+	const t_sample DELOFF = AMSTRING_DELOFFSET(ORDER);
+	t_int i, j, j0, n, dt, dtj;
+	t_sample D;
+	t_amsample delayLineOutput;
+	t_sample outputEnergy = 0.0, inputEnergy = 0.0;
+	t_amsample lcoeff[PADDED];
+	t_amsample lcoeffTarget[PADDED];
+	t_amsample lcoeffStep[PADDED];
+	long dlRead;
+	long periodClamps = 0, gainClamps = 0;
+	t_amstring_tapSumFn tapSum = amstring_tapSum;
+	long simd = !amstring_simdScalar;
+	t_amstring_lagCoeffsFn lagCoeffs = amstring_lagCoeffs;
+	
+	long dlWrite = x->hot->dlWrite;
+	const t_amsample* cc = t_amstring_cc<ORDER>::value;
+	long interpMode = x->interpMode;
+	const t_amsample* lagTable = amstring_lagTable(ORDER);
+	const t_amsample* farrowTable = amstring_farrowTable(ORDER);
+	long delayLineLength = x->hot->delayLineLength;
+	long mirrorStart = delayLineLength - DLGUARD;
+	t_amsample* delayLine = x->hot->delayLine;
+	long controlBlock = x->controlBlock;
+    
+    t_amsample lpf_a0 = x->ctl_lpf_a0;
+    t_amsample lpf_a1 = x->ctl_lpf_a1;
+    t_amsample lpf_a0Target, lpf_a1Target, lpf_a0Step, lpf_a1Step;
+    t_amsample lpf_xnminus1 = x->hot->lpf_xnminus1;
+    t_amsample lpf_xnminus2 = x->hot->lpf_xnminus2;
+    t_amsample lpf_output;
+    t_sample highFreqGainFactor = x->hot->highFreqGain;
+    
+    t_amsample previousHpfOutput = x->hot->previousHpfOutput;
+    t_amsample previousHpfInput = x->hot->previousHpfInput;
+    t_amsample currentHpfInput;
+    t_amsample dcb_a0 = x->hot->dcb_a0;
+    t_amsample dcb_a1 = x->hot->dcb_a1;
+    t_amsample dcb_b1 = x->hot->dcb_b1;
+	
+	t_sample delayTime, stepScale;
+    t_sample maxDelay = x->hot->maxDelay;
+    t_sample fbgain = x->hot->fbgain;
+    
+	for(i=0; i<PADDED; i++) lcoeff[i] = x->ctl_lc[i];
+	t_int lcoeffDt = x->ctl_dt;
+	
+	for(j0=0; j0<sampleframes; j0+=n)
+	{
+		n = sampleframes - j0 < controlBlock ? sampleframes - j0 : controlBlock;
+		
+		// [ sample the control signals at the end of the sub-block, and clamp them ]
+		// ( a clamped value counts for every sample of the sub-block, as it does in the per-sample routines )
+		delayTime = ins[2][j0+n-1] - 1.0;
+        periodClamps += n * !(delayTime >= DELOFF && delayTime <= maxDelay);
+        delayTime = delayTime > maxDelay ? maxDelay : delayTime;
+        delayTime = delayTime >= DELOFF ? delayTime : DELOFF; // ( NaN becomes DELOFF )
+		if(gainConnected) {
+			fbgain = ins[1][j0+n-1];
+			gainClamps += n * !(fbgain >= -MAXFBGAIN && fbgain <= MAXFBGAIN);
+			fbgain = fbgain > MAXFBGAIN ? MAXFBGAIN : fbgain;
+			fbgain = fbgain < -MAXFBGAIN ? -MAXFBGAIN : fbgain;
+		}
+		
+		// [ calculate the coefficients to be reached at the end of the sub-block ]
+		dt = (t_int)floor(delayTime - DELOFF);
+		D = delayTime - (t_sample)dt;
+		amstring_orderLagCoeffs<ORDER>(D, cc, lcoeffTarget, lagCoeffs, simd);
+		amstring_calcLpfCoeffsFor(delayTime, fbgain, highFreqGainFactor, &lpf_a0Target, &lpf_a1Target);
+		
+		// [ nothing to ramp from after a clear or a change of mode ]
+		if(!x->ctl_valid) {
+			for(i=0; i<PADDED; i++) lcoeff[i] = lcoeffTarget[i];
+			lcoeffDt = dt;
+			lpf_a0 = lpf_a0Target;
+			lpf_a1 = lpf_a1Target;
+			x->ctl_valid = 1;
+		}
+		
+		// [ per-sample increments ]
+		stepScale = 1.0 / (t_sample)n;
+		for(i=0; i<PADDED; i++) lcoeffStep[i] = (lcoeffTarget[i] - lcoeff[i]) * stepScale;
+		lpf_a0Step = (lpf_a0Target - lpf_a0) * stepScale;
+		lpf_a1Step = (lpf_a1Target - lpf_a1) * stepScale;
+		
+		for(j=j0; j<j0+n; j++)
+		{
+			lpf_a0 += lpf_a0Step;
+			lpf_a1 += lpf_a1Step;
+			
+			if(dt == lcoeffDt) {
+				for(i=0; i<PADDED; i++) lcoeff[i] += lcoeffStep[i];
+				dtj = dt;
+			}
+			else {
+				// [ the read position crosses an integer boundary: calculate this sample's coefficients ]
+				delayTime = ins[2][j] - 1.0;
+				delayTime = delayTime > maxDelay ? maxDelay : delayTime;
+				delayTime = delayTime >= DELOFF ? delayTime : DELOFF; // ( NaN becomes DELOFF )
+				dtj = (t_int)floor(delayTime - DELOFF);
+				D = delayTime - (t_sample)dtj;
+				if(interpMode == AMSTRING_INTERP_TABLE) amstring_lagTableNearest(lagTable, PADDED, D - DELOFF, lcoeff);
+				else if(interpMode == AMSTRING_INTERP_TABLE_LINEAR) amstring_lagTableLinear(lagTable, PADDED, D - DELOFF, lcoeff);
+				else if(interpMode == AMSTRING_INTERP_FARROW) amstring_farrowCoeffs(farrowTable, ORDER, D - DELOFF, lcoeff);
+				else amstring_orderLagCoeffs<ORDER>(D, cc, lcoeff, lagCoeffs, simd);
+			}
+			
+			// [ calculate the position of the most recent lagrange tap ]
+			dlRead = dlWrite - dtj;
+			dlRead += dlRead < 0 ? delayLineLength : 0;
+			
+			// [ calculate delay line output ]
+			delayLineOutput = amstring_orderTapSum<ORDER>(lcoeff, delayLine + dlRead - (PADDED-1), tapSum, simd);
+			
+			// [ LPF ]
+			lpf_output = lpf_a0 * delayLineOutput + lpf_a1 * lpf_xnminus1 + lpf_a0 * lpf_xnminus2;
+			lpf_xnminus2 = lpf_xnminus1;
+			lpf_xnminus1 = delayLineOutput;
+			
+			// [ DCB and output]
+			currentHpfInput = lpf_output + (t_amsample)ins[0][j];
+			inputEnergy += ins[0][j] * ins[0][j];
+			delayLine[dlWrite] = outs[0][j] = previousHpfOutput = dcb_a0 * currentHpfInput + dcb_a1 * previousHpfInput + dcb_b1 * previousHpfOutput;
+			delayLine[dlWrite >= mirrorStart ? dlWrite - delayLineLength : dlWrite] = previousHpfOutput; // [ mirror into the guard zone (or rewrite the same sample) ]
+			previousHpfInput = currentHpfInput;
+			outputEnergy += previousHpfOutput * previousHpfOutput;
+			
+			// [ increment write position, folding back to zero if necessary ]
+			dlWrite = dlWrite + 1 < delayLineLength ? dlWrite + 1 : 0;
+		}
+		
+		// [ land exactly on the targets, ready to ramp from them in the next sub-block ]
+		for(i=0; i<PADDED; i++) lcoeff[i] = lcoeffTarget[i];
+		lcoeffDt = dt;
+		lpf_a0 = lpf_a0Target;
+		lpf_a1 = lpf_a1Target;
+	}
+	
+    // [ store things for next time ]
+	for(i=0; i<PADDED; i++) x->ctl_lc[i] = lcoeff[i];
+	x->ctl_dt = lcoeffDt;
+	x->ctl_lpf_a0 = lpf_a0;
+	x->ctl_lpf_a1 = lpf_a1;
+	x->hot->dlWrite = dlWrite;
+    x->hot->previousHpfOutput = previousHpfOutput;
+    x->hot->previousHpfInput = previousHpfInput;
+    x->hot->lpf_xnminus1 = lpf_xnminus1;
+    x->hot->lpf_xnminus2 = lpf_xnminus2;
+    
+    amstring_statsAdd(&x->stats.periodClamps, (uint64_t)periodClamps);
+    amstring_statsAdd(&x->stats.gainClamps, (uint64_t)gainClamps);
+    amstring_endOfVector(x, outs[0], outputEnergy, inputEnergy, sampleframes, maxDelay);
 }
 
 /*
@@ -113,49 +649,81 @@ void amstring_dodsp1_64(t_amstring *x, t_object *dsp64, double **ins, long numin
  * ins[1][n]  = rightmost input (delay time input)
  * outs[0][n] = leftmost output (string output)
  */
-void amstring_dodsp2_64(t_amstring *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam)
+template<int ORDER> static void amstring_dodsp2(t_amstring *x, double **ins, double **outs, long sampleframes)
 {
-	t_int i, j, k, dt;
-	t_sample D, delayLineOutput;
-	t_sample lcoeff[VD_FILTER_LENGTH];
-	long dlRead[VD_FILTER_LENGTH];
+	if(amstring_sleeping(x, ins[0], outs[0], sampleframes)) return;
+	
+	// [ (the Thiran mode's allpass is not run under a period signal: see amstring_dodsp1) ]
+	x->hot->ap_valid = 0;
+	
+	if(amstring_constantSignals<ORDER>(x, ins, sampleframes, 0)) {
+		amstring_dodspConstant<ORDER>(x, ins, outs, sampleframes, x->sig_coeffs.lc, x->sig_coeffs.lpf_a0, x->sig_coeffs.lpf_a1, x->sig_coeffs.delayTime);
+		return;
+	}
+	
+	t_amstring_fpmode fpmode = amstring_fpModeEnter();
+	
+	if(x->controlBlock) {
+		amstring_dodspControlRate<ORDER>(x, ins, outs, sampleframes, 0);
+		amstring_fpModeLeave(fpmode);
+		return;
+	}
+	
+	const int PADDED = AMSTRING_PADDED(ORDER);
+	const t_sample DELOFF = AMSTRING_DELOFFSET(ORDER);
+	t_int j, dt;
+	t_sample D;
+	t_amsample delayLineOutput;
+	t_sample outputEnergy = 0.0, inputEnergy = 0.0;
+	t_amsample lcoeff[PADDED];
+	long dlRead;
+	long periodClamps = 0;
 	
 	/*
 	 * Use local copies of object variables needed inside the for loop
 	 */
-	long dlWrite = x->dlWrite;
-	t_sample* dminusk = x->dminusk;
-	t_sample* cc = x->cc;
-	long delayLineLength = x->delayLineLength;
-	t_sample* delayLine = x->delayLine;
+	long dlWrite = x->hot->dlWrite;
+	const t_amsample* cc = t_amstring_cc<ORDER>::value;
+	t_amstring_tapSumFn tapSum = amstring_tapSum;
+	long simd = !amstring_simdScalar;
+	t_amstring_lagCoeffsFn lagCoeffs = amstring_lagCoeffs;
+	long interpMode = x->interpMode == AMSTRING_INTERP_THIRAN ? (long)AMSTRING_INTERP_EXACT : x->interpMode;
+	const t_amsample* lagTable = amstring_lagTable(ORDER);
+	t_amstring_farrowFn farrow = amstring_farrow;
+	const t_amsample* farrowTable = amstring_farrowTable(ORDER);
+	const t_sample* lpfTable = (interpMode == AMSTRING_INTERP_TABLE || interpMode == AMSTRING_INTERP_TABLE_LINEAR) ? amstring_lpfTable() : NULL;
+	long delayLineLength = x->hot->delayLineLength;
+	long mirrorStart = delayLineLength - DLGUARD;
+	t_amsample* delayLine = x->hot->delayLine;
     
     t_sample omega0; // fundamental frequency in radians/s
-    t_sample lpf_a0; // coefficiencts of LPF
-    t_sample lpf_a1; // ...
-    t_sample lpf_xnminus1 = x->lpf_xnminus1;
-    t_sample lpf_xnminus2 = x->lpf_xnminus2;
-    t_sample lpf_output; // output of LPF
-    t_sample highFreqGainFactor = x->highFreqGain;
+    t_amsample lpf_a0; // coefficiencts of LPF
+    t_amsample lpf_a1; // ...
+    t_amsample lpf_xnminus1 = x->hot->lpf_xnminus1;
+    t_amsample lpf_xnminus2 = x->hot->lpf_xnminus2;
+    t_amsample lpf_output; // output of LPF
+    t_sample highFreqGainFactor = x->hot->highFreqGain;
     
-    t_sample previousHpfOutput = x->previousHpfOutput;
-    t_sample previousHpfInput = x->previousHpfInput;
-    t_sample currentHpfInput;
-    t_sample dcb_a0 = x->dcb_a0;
-    t_sample dcb_a1 = x->dcb_a1;
-    t_sample dcb_b1 = x->dcb_b1;
+    t_amsample previousHpfOutput = x->hot->previousHpfOutput;
+    t_amsample previousHpfInput = x->hot->previousHpfInput;
+    t_amsample currentHpfInput;
+    t_amsample dcb_a0 = x->hot->dcb_a0;
+    t_amsample dcb_a1 = x->hot->dcb_a1;
+    t_amsample dcb_b1 = x->hot->dcb_b1;
 	
 	t_sample delayTime;
-    t_sample maxDelay = x->maxDelay;
+    t_sample maxDelay = x->hot->maxDelay;
     
-    t_sample fbgain = x->fbgain;
+    t_sample fbgain = x->hot->fbgain;
     
 	for(j=0; j<sampleframes; j++)
 	{
 		delayTime = ins[2][j] - 1.0; // reduce by 1 sample to compensate for additional delay due to LPF
         
-        // [ clamp the delayTime variable ]
+        // [ clamp the delayTime variable (counting the samples clamped, see am.string.stats.h) ]
+        periodClamps += !(delayTime >= DELOFF && delayTime <= maxDelay);
         delayTime = delayTime > maxDelay ? maxDelay : delayTime;
-        delayTime = delayTime < DELOFFSET ? DELOFFSET : delayTime;
+        delayTime = delayTime >= DELOFF ? delayTime : DELOFF; // ( NaN becomes DELOFF )
         
 		/*
 		 * Calculate integer part of delay time, dt.
@@ -163,58 +731,44 @@ void amstring_dodsp2_64(t_amstring *x, t_object *dsp64, double **ins, long numin
 		 * delay time allowed is x->ldeloffset. It is up to the user
 		 * to ensure that the delay time is greater than x->ldeloffset
 		 */
-		dt = (t_int)floor(delayTime - DELOFFSET);
+		dt = (t_int)floor(delayTime - DELOFF);
 		
 		// [ calculate fractional part of the delay time ]
 		D = delayTime - (t_sample)dt;
 		
-		/*
-		 * This block calculates:
-		 *   (1) The positions of the lagrange read pointers
-		 *   (2) dminusk (D-k), k = 0,1,...,N (where N = filter order)
-		 *   (3) lcoeff[0] (the first lagrange coefficient)
-		 */
-		dlRead[0] = dlWrite - dt;
-		if(dlRead[0] < 0) dlRead[0] += delayLineLength;
-		dminusk[0] = D; // (D - 0) = D
-		lcoeff[0] = cc[0];
-		for(i=1; i<=VD_FILTER_ORDER; i++)
-		{
-			dlRead[i] = dlRead[i-1] - 1;
-			if(dlRead[i] < 0) dlRead[i] += delayLineLength;
-			dminusk[i] = D - (t_sample)i;
-			lcoeff[0] *= dminusk[i];
-		}
+		// [ calculate the position of the most recent lagrange tap ]
+		dlRead = dlWrite - dt;
+		dlRead += dlRead < 0 ? delayLineLength : 0;
 		
-		/*
-		 * This block calculates:
-		 *    (1) lagrange coefficients, lcoeff[i], i = 1,...,N
-		 *    (2) current output sample
-		 */
-		delayLineOutput = lcoeff[0]*delayLine[dlRead[0]]; // this is why lcoeff[0] was calculated in the last block
-		for(i=1; i<=VD_FILTER_ORDER; i++)
-		{
-			lcoeff[i] = cc[i];
-			for(k=0; k<=VD_FILTER_ORDER; k++)
-			{
-				if(k!=i) { lcoeff[i] *= dminusk[k]; }
-			}
-			// [ add contribution from ith filter tap ]
-			delayLineOutput += lcoeff[i]*delayLine[dlRead[i]];
+		// [ calculate the lagrange coefficients, or look them up in the shared table, and the delay line output ]
+		// ( the Farrow structure goes straight to the output, without the coefficients )
+		if(interpMode == AMSTRING_INTERP_FARROW) {
+			delayLineOutput = amstring_orderFarrow<ORDER>(farrowTable, delayLine + dlRead - (PADDED-1), (t_amsample)(D - DELOFF), farrow, simd);
+		}
+		else {
+			if(interpMode == AMSTRING_INTERP_EXACT) amstring_orderLagCoeffs<ORDER>(D, cc, lcoeff, lagCoeffs, simd);
+			else if(interpMode == AMSTRING_INTERP_TABLE) amstring_lagTableNearest(lagTable, PADDED, D - DELOFF, lcoeff);
+			else amstring_lagTableLinear(lagTable, PADDED, D - DELOFF, lcoeff);
+			delayLineOutput = amstring_orderTapSum<ORDER>(lcoeff, delayLine + dlRead - (PADDED-1), tapSum, simd);
 		}
         
         /*
          * 2nd-Order FIR LPF
          *
-         * (it might be pretty much as good, and more efficient, to calculate omega0 and cos(omega0) just once per buffer)
+         * (in the table modes the coefficients come from the shared table of am.string.lpf.h)
 		 */
-        omega0 = TWOPI / ( delayTime + 1.0 ); // delayTime has been reduced by 1.0 to compensate for LPF, so omega0 must be calc'd with delayTime+1.0
-        lpf_a1 = ( fbgain + highFreqGainFactor * fbgain * cos(omega0) ) / ( 1.0 + cos(omega0) );
-        lpf_a0 = ( lpf_a1 - highFreqGainFactor * fbgain ) * 0.5;
-        
-        if ( lpf_a0 < 0.0 ) {
-            lpf_a0 = 0.0;
-            lpf_a1 = fbgain;
+        if(lpfTable) {
+            amstring_lpfTableCoeffs(lpfTable, delayTime, fbgain, highFreqGainFactor, &lpf_a0, &lpf_a1);
+        }
+        else {
+            omega0 = TWOPI / ( delayTime + 1.0 ); // delayTime has been reduced by 1.0 to compensate for LPF, so omega0 must be calc'd with delayTime+1.0
+            lpf_a1 = ( fbgain + highFreqGainFactor * fbgain * cos(omega0) ) / ( 1.0 + cos(omega0) );
+            lpf_a0 = ( lpf_a1 - highFreqGainFactor * fbgain ) * 0.5;
+            
+            if ( lpf_a0 < 0.0 ) {
+                lpf_a0 = 0.0;
+                lpf_a1 = fbgain;
+            }
         }
         
         lpf_output = lpf_a0 * delayLineOutput + lpf_a1 * lpf_xnminus1 + lpf_a0 * lpf_xnminus2;
@@ -223,7 +777,8 @@ void amstring_dodsp2_64(t_amstring *x, t_object *dsp64, double **ins, long numin
         lpf_xnminus1 = delayLineOutput;
         
         // [ input to HPF is output of LPF + new audio input ]
-        currentHpfInput = lpf_output + ins[0][j];
+        currentHpfInput = lpf_output + (t_amsample)ins[0][j];
+        inputEnergy += ins[0][j] * ins[0][j];
         
         /*
          * D.C. Blocking HPF and Output
@@ -231,21 +786,26 @@ void amstring_dodsp2_64(t_amstring *x, t_object *dsp64, double **ins, long numin
          * [ perform filtering, write to output and also input of delay line at current write position ]
          */
         delayLine[dlWrite] = outs[0][j] = previousHpfOutput = dcb_a0 * currentHpfInput + dcb_a1 * previousHpfInput + dcb_b1 * previousHpfOutput;
+        delayLine[dlWrite >= mirrorStart ? dlWrite - delayLineLength : dlWrite] = previousHpfOutput; // [ mirror into the guard zone (or rewrite the same sample) ]
         
         // [ store previous input to hpf for next sample ]
         previousHpfInput = currentHpfInput;
+        outputEnergy += previousHpfOutput * previousHpfOutput;
 		
 		// [ increment write position, folding back to zero if necessary ]
-		dlWrite += 1;
-		if(dlWrite >= delayLineLength) dlWrite = 0;
+		dlWrite = dlWrite + 1 < delayLineLength ? dlWrite + 1 : 0;
 	}
     
     // [ store things for next time ]
-	x->dlWrite = dlWrite;
-    x->previousHpfOutput = previousHpfOutput;
-    x->previousHpfInput = previousHpfInput;
-    x->lpf_xnminus1 = lpf_xnminus1;
-    x->lpf_xnminus2 = lpf_xnminus2;
+	x->hot->dlWrite = dlWrite;
+    x->hot->previousHpfOutput = previousHpfOutput;
+    x->hot->previousHpfInput = previousHpfInput;
+    x->hot->lpf_xnminus1 = lpf_xnminus1;
+    x->hot->lpf_xnminus2 = lpf_xnminus2;
+    
+    amstring_statsAdd(&x->stats.periodClamps, (uint64_t)periodClamps);
+    amstring_endOfVector(x, outs[0], outputEnergy, inputEnergy, sampleframes, maxDelay);
+    amstring_fpModeLeave(fpmode);
 }
 
 /*
@@ -255,39 +815,70 @@ void amstring_dodsp2_64(t_amstring *x, t_object *dsp64, double **ins, long numin
  * ins[2][n]  = rightmost input (delay time input)
  * outs[0][n] = leftmost output (string output)
  */
-void amstring_dodsp3_64(t_amstring *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam)
+template<int ORDER> static void amstring_dodsp3(t_amstring *x, double **ins, double **outs, long sampleframes)
 {
-	t_int i, j, k, dt;
-	t_sample D, delayLineOutput;
-	t_sample lcoeff[VD_FILTER_LENGTH];
-	long dlRead[VD_FILTER_LENGTH];
+	if(amstring_sleeping(x, ins[0], outs[0], sampleframes)) return;
+	
+	// [ (the Thiran mode's allpass is not run under a period signal: see amstring_dodsp1) ]
+	x->hot->ap_valid = 0;
+	
+	if(amstring_constantSignals<ORDER>(x, ins, sampleframes, 1)) {
+		amstring_dodspConstant<ORDER>(x, ins, outs, sampleframes, x->sig_coeffs.lc, x->sig_coeffs.lpf_a0, x->sig_coeffs.lpf_a1, x->sig_coeffs.delayTime);
+		return;
+	}
+	
+	t_amstring_fpmode fpmode = amstring_fpModeEnter();
+	
+	if(x->controlBlock) {
+		amstring_dodspControlRate<ORDER>(x, ins, outs, sampleframes, 1);
+		amstring_fpModeLeave(fpmode);
+		return;
+	}
+	
+	const int PADDED = AMSTRING_PADDED(ORDER);
+	const t_sample DELOFF = AMSTRING_DELOFFSET(ORDER);
+	t_int j, dt;
+	t_sample D;
+	t_amsample delayLineOutput;
+	t_sample outputEnergy = 0.0, inputEnergy = 0.0;
+	t_amsample lcoeff[PADDED];
+	long dlRead;
+	long periodClamps = 0, gainClamps = 0;
 	
 	/*
 	 * Use local copies of object variables needed inside the for loop
 	 */
-	long dlWrite = x->dlWrite;
-	t_sample* dminusk = x->dminusk;
-	t_sample* cc = x->cc;
-	long delayLineLength = x->delayLineLength;
-	t_sample* delayLine = x->delayLine;
+	long dlWrite = x->hot->dlWrite;
+	const t_amsample* cc = t_amstring_cc<ORDER>::value;
+	t_amstring_tapSumFn tapSum = amstring_tapSum;
+	long simd = !amstring_simdScalar;
+	t_amstring_lagCoeffsFn lagCoeffs = amstring_lagCoeffs;
+	long interpMode = x->interpMode == AMSTRING_INTERP_THIRAN ? (long)AMSTRING_INTERP_EXACT : x->interpMode;
+	const t_amsample* lagTable = amstring_lagTable(ORDER);
+	t_amstring_farrowFn farrow = amstring_farrow;
+	const t_amsample* farrowTable = amstring_farrowTable(ORDER);
+	const t_sample* lpfTable = (interpMode == AMSTRING_INTERP_TABLE || interpMode == AMSTRING_INTERP_TABLE_LINEAR) ? amstring_lpfTable() : NULL;
+	long delayLineLength = x->hot->delayLineLength;
+	long mirrorStart = delayLineLength - DLGUARD;
+	t_amsample* delayLine = x->hot->delayLine;
     
     t_sample omega0; // fundamental frequency in radians/s
-    t_sample lpf_a0; // coefficiencts of LPF
-    t_sample lpf_a1; // ...
-    t_sample lpf_xnminus1 = x->lpf_xnminus1;
-    t_sample lpf_xnminus2 = x->lpf_xnminus2;
-    t_sample lpf_output; // output of LPF
-    t_sample highFreqGainFactor = x->highFreqGain;
+    t_amsample lpf_a0; // coefficiencts of LPF
+    t_amsample lpf_a1; // ...
+    t_amsample lpf_xnminus1 = x->hot->lpf_xnminus1;
+    t_amsample lpf_xnminus2 = x->hot->lpf_xnminus2;
+    t_amsample lpf_output; // output of LPF
+    t_sample highFreqGainFactor = x->hot->highFreqGain;
     
-    t_sample previousHpfOutput = x->previousHpfOutput;
-    t_sample previousHpfInput = x->previousHpfInput;
-    t_sample currentHpfInput;
-    t_sample dcb_a0 = x->dcb_a0;
-    t_sample dcb_a1 = x->dcb_a1;
-    t_sample dcb_b1 = x->dcb_b1;
+    t_amsample previousHpfOutput = x->hot->previousHpfOutput;
+    t_amsample previousHpfInput = x->hot->previousHpfInput;
+    t_amsample currentHpfInput;
+    t_amsample dcb_a0 = x->hot->dcb_a0;
+    t_amsample dcb_a1 = x->hot->dcb_a1;
+    t_amsample dcb_b1 = x->hot->dcb_b1;
 	
 	t_sample delayTime;
-    t_sample maxDelay = x->maxDelay;
+    t_sample maxDelay = x->hot->maxDelay;
     
     t_sample fbgain;
     
@@ -296,11 +887,13 @@ void amstring_dodsp3_64(t_amstring *x, t_object *dsp64, double **ins, long numin
         fbgain = ins[1][j];
 		delayTime = ins[2][j] - 1.0; // reduce by 1 sample to compensate for additional delay due to LPF
         
-        // [ clamp the delayTime variable ]
+        // [ clamp the delayTime variable (counting the samples clamped, see am.string.stats.h) ]
+        periodClamps += !(delayTime >= DELOFF && delayTime <= maxDelay);
         delayTime = delayTime > maxDelay ? maxDelay : delayTime;
-        delayTime = delayTime < DELOFFSET ? DELOFFSET : delayTime;
+        delayTime = delayTime >= DELOFF ? delayTime : DELOFF; // ( NaN becomes DELOFF )
         
         // [ clamp the fbgain variable ]
+        gainClamps += !(fbgain >= -MAXFBGAIN && fbgain <= MAXFBGAIN);
         fbgain = fbgain > MAXFBGAIN ? MAXFBGAIN : fbgain;
         fbgain = fbgain < -MAXFBGAIN ? -MAXFBGAIN : fbgain;
         
@@ -310,58 +903,44 @@ void amstring_dodsp3_64(t_amstring *x, t_object *dsp64, double **ins, long numin
 		 * delay time allowed is x->ldeloffset. It is up to the user
 		 * to ensure that the delay time is greater than x->ldeloffset
 		 */
-		dt = (t_int)floor(delayTime - DELOFFSET);
+		dt = (t_int)floor(delayTime - DELOFF);
 		
 		// [ calculate fractional part of the delay time ]
 		D = delayTime - (t_sample)dt;
 		
-		/*
-		 * This block calculates:
-		 *   (1) The positions of the lagrange read pointers
-		 *   (2) dminusk (D-k), k = 0,1,...,N (where N = filter order)
-		 *   (3) lcoeff[0] (the first lagrange coefficient)
-		 */
-		dlRead[0] = dlWrite - dt;
-		if(dlRead[0] < 0) dlRead[0] += delayLineLength;
-		dminusk[0] = D; // (D - 0) = D
-		lcoeff[0] = cc[0];
-		for(i=1; i<=VD_FILTER_ORDER; i++)
-		{
-			dlRead[i] = dlRead[i-1] - 1;
-			if(dlRead[i] < 0) dlRead[i] += delayLineLength;
-			dminusk[i] = D - (t_sample)i;
-			lcoeff[0] *= dminusk[i];
-		}
+		// [ calculate the position of the most recent lagrange tap ]
+		dlRead = dlWrite - dt;
+		dlRead += dlRead < 0 ? delayLineLength : 0;
 		
-		/*
-		 * This block calculates:
-		 *    (1) lagrange coefficients, lcoeff[i], i = 1,...,N
-		 *    (2) current output sample
-		 */
-		delayLineOutput = lcoeff[0]*delayLine[dlRead[0]]; // this is why lcoeff[0] was calculated in the last block
-		for(i=1; i<=VD_FILTER_ORDER; i++)
-		{
-			lcoeff[i] = cc[i];
-			for(k=0; k<=VD_FILTER_ORDER; k++)
-			{
-				if(k!=i) { lcoeff[i] *= dminusk[k]; }
-			}
-			// [ add contribution from ith filter tap ]
-			delayLineOutput += lcoeff[i]*delayLine[dlRead[i]];
+		// [ calculate the lagrange coefficients, or look them up in the shared table, and the delay line output ]
+		// ( the Farrow structure goes straight to the output, without the coefficients )
+		if(interpMode == AMSTRING_INTERP_FARROW) {
+			delayLineOutput = amstring_orderFarrow<ORDER>(farrowTable, delayLine + dlRead - (PADDED-1), (t_amsample)(D - DELOFF), farrow, simd);
+		}
+		else {
+			if(interpMode == AMSTRING_INTERP_EXACT) amstring_orderLagCoeffs<ORDER>(D, cc, lcoeff, lagCoeffs, simd);
+			else if(interpMode == AMSTRING_INTERP_TABLE) amstring_lagTableNearest(lagTable, PADDED, D - DELOFF, lcoeff);
+			else amstring_lagTableLinear(lagTable, PADDED, D - DELOFF, lcoeff);
+			delayLineOutput = amstring_orderTapSum<ORDER>(lcoeff, delayLine + dlRead - (PADDED-1), tapSum, simd);
 		}
         
         /*
          * 2nd-Order FIR LPF
          *
-         * (it might be pretty much as good, and more efficient, to calculate omega0 and cos(omega0) just once per buffer)
+         * (in the table modes the coefficients come from the shared table of am.string.lpf.h)
 		 */
-        omega0 = TWOPI / ( delayTime + 1.0 ); // delayTime has been reduced by 1.0 to compensate for LPF, so omega0 must be calc'd with delayTime+1.0
-        lpf_a1 = ( fbgain + highFreqGainFactor * fbgain * cos(omega0) ) / ( 1.0 + cos(omega0) );
-        lpf_a0 = ( lpf_a1 - highFreqGainFactor * fbgain ) * 0.5;
-        
-        if ( lpf_a0 < 0.0 ) {
-            lpf_a0 = 0.0;
-            lpf_a1 = fbgain;
+        if(lpfTable) {
+            amstring_lpfTableCoeffs(lpfTable, delayTime, fbgain, highFreqGainFactor, &lpf_a0, &lpf_a1);
+        }
+        else {
+            omega0 = TWOPI / ( delayTime + 1.0 ); // delayTime has been reduced by 1.0 to compensate for LPF, so omega0 must be calc'd with delayTime+1.0
+            lpf_a1 = ( fbgain + highFreqGainFactor * fbgain * cos(omega0) ) / ( 1.0 + cos(omega0) );
+            lpf_a0 = ( lpf_a1 - highFreqGainFactor * fbgain ) * 0.5;
+            
+            if ( lpf_a0 < 0.0 ) {
+                lpf_a0 = 0.0;
+                lpf_a1 = fbgain;
+            }
         }
         
         lpf_output = lpf_a0 * delayLineOutput + lpf_a1 * lpf_xnminus1 + lpf_a0 * lpf_xnminus2;
@@ -370,7 +949,8 @@ void amstring_dodsp3_64(t_amstring *x, t_object *dsp64, double **ins, long numin
         lpf_xnminus1 = delayLineOutput;
         
         // [ input to HPF is output of LPF + new audio input ]
-        currentHpfInput = lpf_output + ins[0][j];
+        currentHpfInput = lpf_output + (t_amsample)ins[0][j];
+        inputEnergy += ins[0][j] * ins[0][j];
         
         /*
          * D.C. Blocking HPF and Output
@@ -378,19 +958,157 @@ void amstring_dodsp3_64(t_amstring *x, t_object *dsp64, double **ins, long numin
          * [ perform filtering, write to output and also input of delay line at current write position ]
          */
         delayLine[dlWrite] = outs[0][j] = previousHpfOutput = dcb_a0 * currentHpfInput + dcb_a1 * previousHpfInput + dcb_b1 * previousHpfOutput;
+        delayLine[dlWrite >= mirrorStart ? dlWrite - delayLineLength : dlWrite] = previousHpfOutput; // [ mirror into the guard zone (or rewrite the same sample) ]
         
         // [ store previous input to hpf for next sample ]
         previousHpfInput = currentHpfInput;
+        outputEnergy += previousHpfOutput * previousHpfOutput;
 		
 		// [ increment write position, folding back to zero if necessary ]
-		dlWrite += 1;
-		if(dlWrite >= delayLineLength) dlWrite = 0;
+		dlWrite = dlWrite + 1 < delayLineLength ? dlWrite + 1 : 0;
 	}
     
     // [ store things for next time ]
-	x->dlWrite = dlWrite;
-    x->previousHpfOutput = previousHpfOutput;
-    x->previousHpfInput = previousHpfInput;
-    x->lpf_xnminus1 = lpf_xnminus1;
-    x->lpf_xnminus2 = lpf_xnminus2;
-}
\ No newline at end of file
+	x->hot->dlWrite = dlWrite;
+    x->hot->previousHpfOutput = previousHpfOutput;
+    x->hot->previousHpfInput = previousHpfInput;
+    x->hot->lpf_xnminus1 = lpf_xnminus1;
+    x->hot->lpf_xnminus2 = lpf_xnminus2;
+    
+    amstring_statsAdd(&x->stats.periodClamps, (uint64_t)periodClamps);
+    amstring_statsAdd(&x->stats.gainClamps, (uint64_t)gainClamps);
+    amstring_endOfVector(x, outs[0], outputEnergy, inputEnergy, sampleframes, maxDelay);
+    amstring_fpModeLeave(fpmode);
+}
+
+/*
+ * The built-in exciter (see amstring_pluck)
+ *
+ * Start a pending pluck, to be played over the given period.
+ */
+static inline void amstring_startPluck(t_amstring *x, t_sample period)
+{
+	period = period >= AMSTRING_MINDELAY(x->hot->order) ? period : AMSTRING_MINDELAY(x->hot->order); // ( NaN becomes the minimum, so the excitation still ends )
+	period = period <= x->hot->maxDelay ? period : x->hot->maxDelay;
+	x->hot->exciteTable = amstring_exciteTable(x->pluckShape);
+	x->excitePos = 0.0;
+	x->exciteStep = (t_sample)AMSTRING_EXCITE_LENGTH / period;
+	x->exciteLevel = x->hot->pluckLevel;
+	x->hot->pluckLevel = 0.0;
+}
+
+/*
+ * Add the excitation to n samples of input (linearly interpolating the table), and stop
+ * the exciter once the table has been played through.
+ */
+static inline void amstring_exciteInput(t_amstring *x, const double *in, double *out, long n)
+{
+	const t_amsample* table = x->hot->exciteTable;
+	t_sample pos = x->excitePos;
+	t_sample step = x->exciteStep;
+	t_sample level = x->exciteLevel;
+	long j = 0;
+
+	for(; j<n && pos < (t_sample)AMSTRING_EXCITE_LENGTH; j++)
+	{
+		long p = (long)pos;
+		t_sample frac = pos - (t_sample)p;
+		out[j] = in[j] + level * (table[p] + frac * (table[p+1] - table[p]));
+		pos += step;
+	}
+	for(; j<n; j++) out[j] = in[j];
+
+	x->excitePos = pos;
+	if(pos >= (t_sample)AMSTRING_EXCITE_LENGTH) x->hot->exciteTable = NULL;
+}
+
+typedef void (*t_amstring_performFn)(t_amstring *x, double **ins, double **outs, long sampleframes);
+
+/*
+ * Run a perform routine for a vector in which the exciter plays: in sub-vectors of up to
+ * AMSTRING_EXCITE_CHUNK samples, each with the excitation added to a copy of its input,
+ * until the excitation ends. (So only strings being excited pay for it, and the signal
+ * inlet needs nothing connected. The copy is needed as MSP may pass the same vector for
+ * input and output.) period is the string's period at the start of the vector.
+ */
+static void amstring_performExcited(t_amstring *x, double **ins, long numins, double **outs, long sampleframes, t_amstring_performFn perform, t_sample period)
+{
+	double excited[AMSTRING_EXCITE_CHUNK];
+	double* chunkIns[3];
+	double* chunkOuts[1];
+	long n;
+
+	if(x->hot->pluckLevel != 0.0) amstring_startPluck(x, period);
+
+	for(long j0=0; j0<sampleframes; j0+=n)
+	{
+		for(long i=0; i<numins && i<3; i++) chunkIns[i] = ins[i] + j0;
+		chunkOuts[0] = outs[0] + j0;
+
+		// [ once the excitation has ended, the rest of the vector is processed in one go ]
+		if(!x->hot->exciteTable) {
+			perform(x, chunkIns, chunkOuts, sampleframes - j0);
+			return;
+		}
+
+		n = sampleframes - j0 < AMSTRING_EXCITE_CHUNK ? sampleframes - j0 : AMSTRING_EXCITE_CHUNK;
+		amstring_exciteInput(x, chunkIns[0], excited, n);
+		chunkIns[0] = excited;
+		perform(x, chunkIns, chunkOuts, n);
+	}
+}
+
+/*
+ * Each perform routine, run at the instantiation for the string's interpolation order
+ * (see am.string.order.h)
+ */
+static void amstring_perform1(t_amstring *x, double **ins, double **outs, long sampleframes)
+{
+	AMSTRING_ORDER_DISPATCH(x->hot->order, amstring_dodsp1, (x, ins, outs, sampleframes));
+}
+
+static void amstring_perform2(t_amstring *x, double **ins, double **outs, long sampleframes)
+{
+	AMSTRING_ORDER_DISPATCH(x->hot->order, amstring_dodsp2, (x, ins, outs, sampleframes));
+}
+
+static void amstring_perform3(t_amstring *x, double **ins, double **outs, long sampleframes)
+{
+	AMSTRING_ORDER_DISPATCH(x->hot->order, amstring_dodsp3, (x, ins, outs, sampleframes));
+}
+
+/*
+ * The perform functions added to the DSP chain, which also keep the performance counters
+ * (see am.string.stats.h), swap in the delay line for a new maximum delay (see
+ * amstring_setMaxDelay) and take up newly published coefficients (see amstring_publishCoeffs).
+ * (The period for a pluck is the delay time inlet's first sample when it is connected.)
+ */
+void amstring_dodsp1_64(t_amstring *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam)
+{
+	uint64_t start = amstring_statsClock();
+	if(x->pendingMemory.load(std::memory_order_relaxed)) amstring_swapMemory(x);
+	if(x->coeffMiddle.load(std::memory_order_relaxed) & AMSTRING_COEFFS_NEW) amstring_takeCoeffs(x);
+	if(x->hot->pluckLevel != 0.0 || x->hot->exciteTable) amstring_performExcited(x, ins, numins, outs, sampleframes, amstring_perform1, x->hot->delayTime + 1.0);
+	else amstring_perform1(x, ins, outs, sampleframes);
+	amstring_statsCall(&x->stats, AMSTRING_ROUTINE_DODSP1, sampleframes, start);
+}
+
+void amstring_dodsp2_64(t_amstring *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam)
+{
+	uint64_t start = amstring_statsClock();
+	if(x->pendingMemory.load(std::memory_order_relaxed)) amstring_swapMemory(x);
+	if(x->coeffMiddle.load(std::memory_order_relaxed) & AMSTRING_COEFFS_NEW) amstring_takeCoeffs(x);
+	if(x->hot->pluckLevel != 0.0 || x->hot->exciteTable) amstring_performExcited(x, ins, numins, outs, sampleframes, amstring_perform2, ins[2][0]);
+	else amstring_perform2(x, ins, outs, sampleframes);
+	amstring_statsCall(&x->stats, AMSTRING_ROUTINE_DODSP2, sampleframes, start);
+}
+
+void amstring_dodsp3_64(t_amstring *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam)
+{
+	uint64_t start = amstring_statsClock();
+	if(x->pendingMemory.load(std::memory_order_relaxed)) amstring_swapMemory(x);
+	if(x->coeffMiddle.load(std::memory_order_relaxed) & AMSTRING_COEFFS_NEW) amstring_takeCoeffs(x);
+	if(x->hot->pluckLevel != 0.0 || x->hot->exciteTable) amstring_performExcited(x, ins, numins, outs, sampleframes, amstring_perform3, ins[2][0]);
+	else amstring_perform3(x, ins, outs, sampleframes);
+	amstring_statsCall(&x->stats, AMSTRING_ROUTINE_DODSP3, sampleframes, start);
+}
@@ -0,0 +1,114 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  am.string.exciter.cpp
+//  am.string~
+//
+
+#include <math.h>
+#include "am.string.core.h"
+#include "am.string.exciter.h"
+
+/*
+ * Fill one period with white noise, from a fixed seed so that the bank is the same every time
+ */
+static void amstring_exciteNoise(t_sample* e)
+{
+	unsigned long seed = 1;
+	for(long i=0; i<AMSTRING_EXCITE_LENGTH; i++)
+	{
+		seed = (seed * 1664525UL + 1013904223UL) & 0xffffffffUL;
+		e[i] = (t_sample)(seed & 0xffffff) / (t_sample)0x800000 - 1.0;
+	}
+}
+
+/*
+ * Lowpass one period circularly with two passes of a one-pole filter (the first time round
+ * the period only settles the filter state, so the result has no start-up transient)
+ */
+static void amstring_exciteSoften(t_sample* e)
+{
+	const t_sample a = 0.9;
+	for(int pass=0; pass<2; pass++)
+	{
+		t_sample y = 0.0;
+		for(long i=0; i<2*AMSTRING_EXCITE_LENGTH; i++)
+		{
+			y = (1.0 - a) * e[i % AMSTRING_EXCITE_LENGTH] + a * y;
+			if(i >= AMSTRING_EXCITE_LENGTH) e[i - AMSTRING_EXCITE_LENGTH] = y;
+		}
+	}
+}
+
+/*
+ * Comb one period circularly for a pluck at fraction beta of the string length
+ */
+static void amstring_excitePosition(t_sample* e, t_sample beta)
+{
+	t_sample s[AMSTRING_EXCITE_LENGTH];
+	long offset = (long)(beta * AMSTRING_EXCITE_LENGTH + 0.5);
+	for(long i=0; i<AMSTRING_EXCITE_LENGTH; i++) s[i] = e[i];
+	for(long i=0; i<AMSTRING_EXCITE_LENGTH; i++) e[i] = s[i] - s[(i - offset + AMSTRING_EXCITE_LENGTH) % AMSTRING_EXCITE_LENGTH];
+}
+
+/*
+ * Remove the mean of one period, scale it to a peak of 1 and store it as a table, with the
+ * guard sample (the first sample again) after it
+ */
+static void amstring_exciteStore(const t_sample* e, t_amsample* table)
+{
+	t_sample mean = 0.0, peak = 0.0;
+	for(long i=0; i<AMSTRING_EXCITE_LENGTH; i++) mean += e[i];
+	mean /= (t_sample)AMSTRING_EXCITE_LENGTH;
+	for(long i=0; i<AMSTRING_EXCITE_LENGTH; i++) if(fabs(e[i] - mean) > peak) peak = fabs(e[i] - mean);
+	for(long i=0; i<AMSTRING_EXCITE_LENGTH; i++) table[i] = (t_amsample)((e[i] - mean) / peak);
+	table[AMSTRING_EXCITE_LENGTH] = table[0];
+}
+
+/*
+ * Return the table for an excitation shape, building the bank on first use.
+ * (The first call is made from amstring_init, i.e. never on the audio thread.)
+ */
+const t_amsample* amstring_exciteTable(long shape)
+{
+	static t_amsample bank[AMSTRING_PLUCK_NUMSHAPES][AMSTRING_EXCITE_LENGTH+1];
+	static bool built = false;
+	t_sample e[AMSTRING_EXCITE_LENGTH];
+
+	if(!built)
+	{
+		amstring_exciteNoise(e);
+		amstring_exciteStore(e, bank[AMSTRING_PLUCK_NOISE]);
+		amstring_excitePosition(e, 0.125);
+		amstring_exciteStore(e, bank[AMSTRING_PLUCK_BRIDGE]);
+
+		amstring_exciteNoise(e);
+		amstring_exciteSoften(e);
+		amstring_exciteStore(e, bank[AMSTRING_PLUCK_SOFT]);
+		amstring_excitePosition(e, 0.5);
+		amstring_exciteStore(e, bank[AMSTRING_PLUCK_MIDDLE]);
+
+		amstring_exciteNoise(e);
+		amstring_exciteSoften(e);
+		amstring_excitePosition(e, 1.0/3.0);
+		amstring_exciteStore(e, bank[AMSTRING_PLUCK_THIRD]);
+		built = true;
+	}
+	if(shape < 0 || shape >= AMSTRING_PLUCK_NUMSHAPES) shape = AMSTRING_PLUCK_NOISE;
+	return bank[shape];
+}
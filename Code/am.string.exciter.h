@@ -0,0 +1,55 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  am.string.exciter.h
+//  am.string~
+//
+//  The built-in exciter: a bank of excitation wavetables, built once and shared
+//  read-only by all instances, which a 'pluck' message plays into the string's input
+//  (see amstring_pluck). Each table holds one period of excitation in normalised time,
+//  AMSTRING_EXCITE_LENGTH samples long (plus one guard sample for interpolation), and is
+//  played back stretched to the string's period, so that it fills the loop exactly once
+//  whatever the pitch. Every table has zero mean and a peak of 1.
+//
+//  The pluck-position tables are comb filtered circularly, e(t) = s(t) - s(t - beta mod 1),
+//  which is the comb of a string plucked at fraction beta of its length: harmonics at
+//  multiples of 1/beta are missing.
+//
+
+#ifndef am_string__am_string_exciter_h
+#define am_string__am_string_exciter_h
+
+#define AMSTRING_EXCITE_LENGTH 1024 // samples in one period of an excitation table
+
+#define AMSTRING_EXCITE_CHUNK 256 // largest sub-vector processed while exciting (see am.string.dsp.cpp)
+
+/*
+ * Excitation shapes (the second argument of the 'pluck' message)
+ */
+enum {
+	AMSTRING_PLUCK_NOISE = 0,   // white noise: the classic Karplus-Strong excitation
+	AMSTRING_PLUCK_SOFT,        // lowpassed noise: a rounder pluck, as with the flesh of the finger
+	AMSTRING_PLUCK_MIDDLE,      // soft, plucked at 1/2 of the string length (odd harmonics only)
+	AMSTRING_PLUCK_THIRD,       // soft, plucked at 1/3 of the string length
+	AMSTRING_PLUCK_BRIDGE,      // white, plucked at 1/8 of the string length: thin and bright
+	AMSTRING_PLUCK_NUMSHAPES
+};
+
+const t_amsample* amstring_exciteTable(long shape);
+
+#endif
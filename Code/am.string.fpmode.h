@@ -0,0 +1,78 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  am.string.fpmode.h
+//  am.string~
+//
+//  Flush-to-zero for the perform routines. As a string decays, its state and delay
+//  line drift into the subnormal range, where arithmetic is many times slower on x86.
+//  A perform routine calls amstring_fpModeEnter at the start and amstring_fpModeLeave
+//  at the end, so that subnormal results are flushed to zero (and subnormal inputs read
+//  as zero) while it runs, and the caller's floating-point mode is restored afterwards:
+//      x86 (SSE):  MXCSR FTZ and DAZ bits
+//      AArch64:    FPCR FZ bit
+//  On other targets these do nothing, and the flushing of the filter state at the end of
+//  each vector (AMSTRING_FLUSH) is all that keeps it out of the subnormal range.
+//
+
+#ifndef am_string__am_string_fpmode_h
+#define am_string__am_string_fpmode_h
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <xmmintrin.h>
+#define AMSTRING_FPMODE_SSE
+#define AMSTRING_FPMODE_FLUSH 0x8040u // FTZ | DAZ
+#elif defined(__aarch64__) && defined(__GNUC__)
+#define AMSTRING_FPMODE_AARCH64
+#define AMSTRING_FPMODE_FLUSH (1u << 24) // FZ
+#endif
+
+typedef struct _amstring_fpmode
+{
+	unsigned long saved;
+} t_amstring_fpmode;
+
+static inline t_amstring_fpmode amstring_fpModeEnter(void)
+{
+	t_amstring_fpmode mode;
+#if defined(AMSTRING_FPMODE_SSE)
+	mode.saved = _mm_getcsr();
+	if((mode.saved & AMSTRING_FPMODE_FLUSH) != AMSTRING_FPMODE_FLUSH) _mm_setcsr((unsigned int)(mode.saved | AMSTRING_FPMODE_FLUSH));
+#elif defined(AMSTRING_FPMODE_AARCH64)
+	unsigned long fpcr;
+	__asm__ __volatile__("mrs %0, fpcr" : "=r"(fpcr));
+	mode.saved = fpcr;
+	if((fpcr & AMSTRING_FPMODE_FLUSH) != AMSTRING_FPMODE_FLUSH) __asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr | AMSTRING_FPMODE_FLUSH));
+#else
+	mode.saved = 0;
+#endif
+	return mode;
+}
+
+static inline void amstring_fpModeLeave(t_amstring_fpmode mode)
+{
+#if defined(AMSTRING_FPMODE_SSE)
+	if((mode.saved & AMSTRING_FPMODE_FLUSH) != AMSTRING_FPMODE_FLUSH) _mm_setcsr((unsigned int)mode.saved);
+#elif defined(AMSTRING_FPMODE_AARCH64)
+	if((mode.saved & AMSTRING_FPMODE_FLUSH) != AMSTRING_FPMODE_FLUSH) __asm__ __volatile__("msr fpcr, %0" : : "r"(mode.saved));
+#else
+	(void)mode;
+#endif
+}
+
+#endif
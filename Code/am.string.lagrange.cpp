@@ -0,0 +1,138 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  am.string.lagrange.cpp
+//  am.string~
+//
+
+#include <math.h>
+#include "am.string.core.h"
+#include "am.string.lagrange.h"
+
+#define AMSTRING_NUMORDERS (AMSTRING_MAXORDER/2 + 1) // odd orders 1..AMSTRING_MAXORDER, table index (order-1)/2
+
+/*
+ * Exact Lagrange coefficients of an order for fractional delay D (as in amstring_setDelayTime)
+ */
+static void amstring_lagExact(long order, t_sample D, t_sample* lcoeff)
+{
+	for(int i=0; i<=order; i++)
+	{
+		lcoeff[i] = 1.0;
+		for(int k=0; k<=order; k++)
+		{
+			if(k!=i) { lcoeff[i] *= (D-(t_sample)k)/((t_sample)(i-k)); }
+		}
+	}
+	for(int i=order+1; i<AMSTRING_PADDED(order); i++) lcoeff[i] = 0.0;
+}
+
+/*
+ * Return the shared coefficient table for an order, building it on first use.
+ * (The first call is made from amstring_init or amstring_setOrder, i.e. never on the audio thread.)
+ */
+const t_amsample* amstring_lagTable(long order)
+{
+	static t_amsample tables[AMSTRING_NUMORDERS][(LAGTABLE_PHASES+1)*AMSTRING_MAXPADDED];
+	static bool built[AMSTRING_NUMORDERS] = { false };
+	t_amsample* table = tables[(order-1)/2];
+	const int padded = AMSTRING_PADDED(order);
+	t_sample row[AMSTRING_MAXPADDED];
+
+	if(!built[(order-1)/2])
+	{
+		for(long p=0; p<=LAGTABLE_PHASES; p++)
+		{
+			amstring_lagExact(order, AMSTRING_DELOFFSET(order) + (t_sample)p/(t_sample)LAGTABLE_PHASES, row);
+			for(int i=0; i<padded; i++) table[p*padded + i] = (t_amsample)row[i];
+		}
+		built[(order-1)/2] = true;
+	}
+	return table;
+}
+
+/*
+ * Return the shared Farrow table for an order, building it on first use (as amstring_lagTable).
+ * Coefficient i is the product over k != i of (d + AMSTRING_DELOFFSET(order) - k)/(i - k), multiplied out.
+ */
+const t_amsample* amstring_farrowTable(long order)
+{
+	static t_amsample tables[AMSTRING_NUMORDERS][AMSTRING_MAXPADDED*AMSTRING_MAXPADDED];
+	static bool built[AMSTRING_NUMORDERS] = { false };
+	t_amsample* table = tables[(order-1)/2];
+	const int padded = AMSTRING_PADDED(order);
+
+	if(!built[(order-1)/2])
+	{
+		for(int i=0; i<padded; i++)
+		{
+			t_sample poly[AMSTRING_MAXPADDED] = { 0.0 };
+			if(i <= order)
+			{
+				int degree = 0;
+				poly[0] = 1.0;
+				for(int k=0; k<=order; k++)
+				{
+					if(k==i) continue;
+					// [ multiply by (d - r)/(i - k) ]
+					t_sample r = (t_sample)k - AMSTRING_DELOFFSET(order);
+					t_sample scale = 1.0 / (t_sample)(i - k);
+					degree++;
+					for(int m=degree; m>0; m--) poly[m] = (poly[m-1] - r * poly[m]) * scale;
+					poly[0] = -r * poly[0] * scale;
+				}
+			}
+			for(int m=0; m<padded; m++) table[i*padded + m] = (t_amsample)poly[m];
+		}
+		built[(order-1)/2] = true;
+	}
+	return table;
+}
+
+/*
+ * Measure the accuracy of a table lookup (or Farrow) mode at an order against the exact
+ * calculation: the largest sum over the taps of the absolute coefficient error, over a
+ * dense sweep of fractional delays. This bounds the error in the delay line output
+ * for a signal bounded by +/-1.
+ */
+t_sample amstring_lagTableMaxError(long order, long interpMode)
+{
+	const t_amsample* table = amstring_lagTable(order);
+	const t_amsample* farrow = amstring_farrowTable(order);
+	const int padded = AMSTRING_PADDED(order);
+	t_sample exact[AMSTRING_MAXPADDED];
+	t_amsample approx[AMSTRING_MAXPADDED];
+	t_sample maxError = 0.0;
+	const long steps = 64 * LAGTABLE_PHASES;
+
+	if(interpMode == AMSTRING_INTERP_EXACT) return 0.0;
+
+	for(long s=0; s<steps; s++)
+	{
+		t_sample frac = (t_sample)s/(t_sample)steps + 0.5/(t_sample)steps;
+		amstring_lagExact(order, AMSTRING_DELOFFSET(order) + frac, exact);
+		if(interpMode == AMSTRING_INTERP_TABLE) amstring_lagTableNearest(table, padded, frac, approx);
+		else if(interpMode == AMSTRING_INTERP_TABLE_LINEAR) amstring_lagTableLinear(table, padded, frac, approx);
+		else amstring_farrowCoeffs(farrow, (int)order, frac, approx);
+
+		t_sample error = 0.0;
+		for(int i=0; i<=order; i++) error += fabs(approx[i] - exact[i]);
+		if(error > maxError) maxError = error;
+	}
+	return maxError;
+}
@@ -0,0 +1,93 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  am.string.lagrange.h
+//  am.string~
+//
+//  Polyphase tables of Lagrange coefficients, one per interpolation order, shared by
+//  all instances of that order.
+//
+//  Row p of the table for an order holds the AMSTRING_PADDED(order) (zero-padded)
+//  coefficients for the fractional delay D = AMSTRING_DELOFFSET(order) + p/LAGTABLE_PHASES,
+//  for p = 0..LAGTABLE_PHASES (the extra row at p = LAGTABLE_PHASES allows interpolation
+//  up to D = AMSTRING_DELOFFSET(order)+1).
+//
+//  Measured accuracy at order 7 with LAGTABLE_PHASES = 1024, given as the largest sum
+//  over the taps of |table coefficient - exact coefficient| (which bounds the error in
+//  the delay line output for a signal bounded by +/-1):
+//      nearest phase:          1.3e-3  (-58 dB)
+//      linear interpolation:   7.2e-7  (-123 dB)
+//  amstring_lagTableMaxError() repeats this measurement (see main.cpp). (With
+//  AMSTRING_FLOAT the table is single precision, and both errors include its rounding.)
+//
+//  The Farrow table for an order holds the same filter as polynomials: coefficient i is a
+//  polynomial of degree order in the fractional part d = D - AMSTRING_DELOFFSET(order),
+//  0 <= d < 1,
+//      lcoeff[i] = sum over m of farrow[i*AMSTRING_PADDED(order) + m] * d^m
+//  so that the filter output is the sum over m of d^m times the output of a fixed FIR
+//  sub-filter (the coefficients of d^m) over the taps (see amstring_farrow). It is exact
+//  up to rounding: its measured error is about 1e-15 (3e-7 with AMSTRING_FLOAT).
+//
+
+#ifndef am_string__am_string_lagrange_h
+#define am_string__am_string_lagrange_h
+
+#define LAGTABLE_PHASES 1024
+
+const t_amsample* amstring_lagTable(long order);
+const t_amsample* amstring_farrowTable(long order);
+t_sample amstring_lagTableMaxError(long order, long interpMode);
+
+/*
+ * Look up the coefficients for a fractional delay of AMSTRING_DELOFFSET(order)+frac,
+ * 0 <= frac < 1, in a table whose rows are padded values long.
+ */
+static inline void amstring_lagTableNearest(const t_amsample* table, int padded, t_sample frac, t_amsample* lcoeff)
+{
+	const t_amsample* row = table + (long)(frac * LAGTABLE_PHASES + 0.5) * padded;
+	for(int i=0; i<padded; i++) lcoeff[i] = row[i];
+}
+
+static inline void amstring_lagTableLinear(const t_amsample* table, int padded, t_sample frac, t_amsample* lcoeff)
+{
+	t_sample pos = frac * LAGTABLE_PHASES;
+	long p = (long)pos;
+	t_amsample w = (t_amsample)(pos - (t_sample)p);
+	const t_amsample* row = table + p * padded;
+	for(int i=0; i<padded; i++) lcoeff[i] = row[i] + w * (row[i+padded] - row[i]);
+}
+
+/*
+ * Evaluate the coefficients of the Farrow table for an order at a fractional delay of
+ * AMSTRING_DELOFFSET(order)+frac, 0 <= frac < 1, by Horner's rule (for when the
+ * coefficients themselves are needed)
+ */
+static inline void amstring_farrowCoeffs(const t_amsample* farrow, int order, t_sample frac, t_amsample* lcoeff)
+{
+	const int padded = AMSTRING_PADDED(order);
+	t_amsample d = (t_amsample)frac;
+	for(int i=0; i<padded; i++)
+	{
+		const t_amsample* poly = farrow + i * padded;
+		t_amsample c = poly[order];
+		for(int m=order-1; m>=0; m--) c = c * d + poly[m];
+		lcoeff[i] = c;
+	}
+}
+
+#endif
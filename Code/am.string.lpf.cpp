@@ -0,0 +1,97 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  am.string.lpf.cpp
+//  am.string~
+//
+
+#include <math.h>
+#include "am.string.core.h"
+#include "am.string.lpf.h"
+
+/*
+ * P(t), and its derivative, for a loop period t
+ */
+static t_sample amstring_lpfP(t_sample t)
+{
+	return 1.0 / (2.0 * (1.0 + cos(TWOPI / t)));
+}
+
+static t_sample amstring_lpfdPdt(t_sample t)
+{
+	t_sample w = TWOPI / t;
+	t_sample c = 1.0 + cos(w);
+	return -(TWOPI / (t * t)) * sin(w) / (2.0 * c * c);
+}
+
+/*
+ * Return the shared LPF table, building it on first use.
+ * (The first call is made from amstring_setInterp, i.e. never on the audio thread.)
+ * Octave k holds the points t = 4 * 2^k * (1 + i/LPFTABLE_POINTS), i = 0..LPFTABLE_POINTS,
+ * each as P(t) and its slope multiplied by the spacing of the points.
+ */
+const t_sample* amstring_lpfTable(void)
+{
+	static t_sample table[LPFTABLE_OCTAVES * (LPFTABLE_POINTS + 1) * 2];
+	static bool built = false;
+
+	if(!built)
+	{
+		for(long k=0; k<LPFTABLE_OCTAVES; k++)
+		{
+			t_sample start = LPFTABLE_MIN * ldexp(1.0, (int)k);
+			t_sample spacing = start / (t_sample)LPFTABLE_POINTS;
+			for(long i=0; i<=LPFTABLE_POINTS; i++)
+			{
+				t_sample t = start + (t_sample)i * spacing;
+				table[2 * (k * (LPFTABLE_POINTS + 1) + i)] = amstring_lpfP(t);
+				table[2 * (k * (LPFTABLE_POINTS + 1) + i) + 1] = amstring_lpfdPdt(t) * spacing;
+			}
+		}
+		built = true;
+	}
+	return table;
+}
+
+/*
+ * Measure the accuracy of the table against amstring_calcLpfCoeffsFor: the largest error
+ * in lpf_a0 or lpf_a1 at unit feedback gain and zero high-frequency gain (where the
+ * coefficients are largest), over a sweep of periods through every interval of the table.
+ */
+t_sample amstring_lpfTableMaxError(void)
+{
+	const t_sample* table = amstring_lpfTable();
+	t_sample maxError = 0.0;
+	const long steps = 16;
+
+	for(long k=0; k<LPFTABLE_OCTAVES; k++)
+	{
+		t_sample start = LPFTABLE_MIN * ldexp(1.0, (int)k);
+		t_sample spacing = start / (t_sample)(LPFTABLE_POINTS * steps);
+		for(long s=0; s<LPFTABLE_POINTS * steps; s++)
+		{
+			t_sample delayTime = start + ((t_sample)s + 0.5) * spacing - 1.0;
+			t_amsample a0, a1, exact_a0, exact_a1;
+			amstring_lpfTableCoeffs(table, delayTime, 1.0, 0.0, &a0, &a1);
+			amstring_calcLpfCoeffsFor(delayTime, 1.0, 0.0, &exact_a0, &exact_a1);
+			t_sample error = fmax(fabs((t_sample)a0 - (t_sample)exact_a0), fabs((t_sample)a1 - (t_sample)exact_a1));
+			if(error > maxError) maxError = error;
+		}
+	}
+	return maxError;
+}
@@ -0,0 +1,96 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  am.string.lpf.h
+//  am.string~
+//
+//  The loop filter (LPF) coefficients from a table shared by all instances, for the
+//  audio-rate routines in the table modes, in place of a cosine and a division every sample.
+//
+//  For a loop period t (the delay time before it is reduced by 1.0), feedback gain g and
+//  high-frequency gain h, the coefficients of amstring_calcLpfCoeffsFor are
+//      lpf_a0 = g (1-h) P(t),   lpf_a1 = g h + 2 lpf_a0,   P(t) = 1 / (2 (1 + cos(2 pi / t)))
+//  or lpf_a0 = 0, lpf_a1 = g where g (1-h) < 0. The gains enter linearly, so only P is
+//  tabulated, and the table does not grow with the number of gain or brightness settings.
+//
+//  The table covers 4 <= t < 2^(LPFTABLE_OCTAVES+2), in octaves of LPFTABLE_POINTS points
+//  each, so that its resolution follows the period. A lookup reads the octave and the
+//  position in it straight from the bits of t, and interpolates between two points by
+//  cubic Hermite interpolation (each point holds P and its slope). Shorter and longer
+//  periods are calculated exactly. The table takes 25 KB, but one string only reads the
+//  one or two cache lines around its period.
+//
+//  Measured accuracy with LPFTABLE_POINTS = 64, as the largest error in lpf_a0 or lpf_a1 at
+//  g = 1, h = 0 (where they are largest):
+//      4 <= t < 8:     7.7e-8
+//      8 <= t < 16:    2.7e-9
+//      t >= 128:       below 1e-11
+//  amstring_lpfTableMaxError() repeats this measurement (see main.cpp). (With AMSTRING_FLOAT
+//  the error is that of rounding the coefficients to single precision, 1.2e-7.)
+//
+
+#ifndef am_string__am_string_lpf_h
+#define am_string__am_string_lpf_h
+
+#include <stdint.h>
+#include <string.h>
+
+#define LPFTABLE_BITS 6
+#define LPFTABLE_POINTS (1 << LPFTABLE_BITS)
+#define LPFTABLE_OCTAVES 24
+#define LPFTABLE_MIN 4.0
+
+const t_sample* amstring_lpfTable(void);
+t_sample amstring_lpfTableMaxError(void);
+
+/*
+ * The LPF coefficients for a given (already reduced by 1.0) delay time and gains, as
+ * amstring_calcLpfCoeffsFor, from the table.
+ */
+static inline void amstring_lpfTableCoeffs(const t_sample* table, t_sample delayTime, t_sample fbgain, t_sample highFreqGain, t_amsample* lpf_a0, t_amsample* lpf_a1)
+{
+	t_sample t = delayTime + 1.0;
+	if(!(t >= LPFTABLE_MIN && t < LPFTABLE_MIN * (t_sample)(1L << LPFTABLE_OCTAVES))) {
+		amstring_calcLpfCoeffsFor(delayTime, fbgain, highFreqGain, lpf_a0, lpf_a1);
+		return;
+	}
+
+	// [ the octave is the exponent of t, the point the top bits of its mantissa, and the rest the position between points ]
+	const int shift = 52 - LPFTABLE_BITS;
+	uint64_t bits;
+	memcpy(&bits, &t, sizeof(bits));
+	long octave = (long)(bits >> 52) - 1025;
+	long point = (long)((bits >> shift) & (LPFTABLE_POINTS - 1));
+	t_sample f = (t_sample)(int64_t)(bits & ((1ULL << shift) - 1)) * (1.0 / (t_sample)(1ULL << shift)); // ( signed: converts faster, and fits )
+
+	// [ cubic Hermite interpolation between the point and the next (slopes are per point spacing) ]
+	const t_sample* e = table + 2 * (octave * (LPFTABLE_POINTS + 1) + point);
+	t_sample p0 = e[0], m0 = e[1], p1 = e[2], m1 = e[3];
+	t_sample P = p0 + f * (m0 + f * ((3.0 * (p1 - p0) - 2.0 * m0 - m1) + f * (2.0 * (p0 - p1) + m0 + m1)));
+
+	t_sample a0 = fbgain * (1.0 - highFreqGain) * P;
+	if(a0 < 0.0) {
+		*lpf_a0 = 0.0;
+		*lpf_a1 = (t_amsample)fbgain;
+		return;
+	}
+	*lpf_a0 = (t_amsample)a0;
+	*lpf_a1 = (t_amsample)(fbgain * highFreqGain + 2.0 * a0);
+}
+
+#endif
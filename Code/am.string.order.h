@@ -0,0 +1,125 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  am.string.order.h
+//  am.string~
+//
+//  The interpolation order as a compile-time constant. The perform routines
+//  (am.string.dsp.cpp) are templates on the order, instantiated for each of 1, 3, 5, 7
+//  and 9, so that within each one the filter length, span width and DELOFFSET are
+//  constants, the loops over the taps unroll fully, and the constant parts of the
+//  Lagrange coefficients (cc) are compiled in.
+//
+//  The kernels here are the scalar ones. They do the arithmetic of the scalar kernels of
+//  am.string.simd.cpp in the same order, over ORDER+1 taps, so for the default order they
+//  are bit-identical to them. The perform routines use them when the scalar kernel set is
+//  selected, and at every order but 7 (see amstring_orderTapSum in am.string.dsp.cpp).
+//
+
+#ifndef am_string__am_string_order_h
+#define am_string__am_string_order_h
+
+#include "am.string.core.h"
+
+/*
+ * The constant part of lagrange coefficient n for an order: the product over k != n of
+ * 1/(n-k), formed left to right as amstring_ccCalc always has (0.0 past the order)
+ */
+constexpr t_sample amstring_ccProduct(int order, int n, int k, t_sample c)
+{
+	return k > order ? c : amstring_ccProduct(order, n, k + 1, k == n ? c : c * 1.0/((t_sample)(n-k)));
+}
+
+constexpr t_sample amstring_ccFor(int order, int n)
+{
+	return n > order ? 0.0 : amstring_ccProduct(order, n, 0, 1.0);
+}
+
+template<int ORDER> struct t_amstring_cc
+{
+	static constexpr t_amsample value[AMSTRING_MAXPADDED] = {
+		(t_amsample)amstring_ccFor(ORDER, 0),  (t_amsample)amstring_ccFor(ORDER, 1),  (t_amsample)amstring_ccFor(ORDER, 2),  (t_amsample)amstring_ccFor(ORDER, 3),
+		(t_amsample)amstring_ccFor(ORDER, 4),  (t_amsample)amstring_ccFor(ORDER, 5),  (t_amsample)amstring_ccFor(ORDER, 6),  (t_amsample)amstring_ccFor(ORDER, 7),
+		(t_amsample)amstring_ccFor(ORDER, 8),  (t_amsample)amstring_ccFor(ORDER, 9),  (t_amsample)amstring_ccFor(ORDER, 10), (t_amsample)amstring_ccFor(ORDER, 11),
+		(t_amsample)amstring_ccFor(ORDER, 12), (t_amsample)amstring_ccFor(ORDER, 13), (t_amsample)amstring_ccFor(ORDER, 14), (t_amsample)amstring_ccFor(ORDER, 15)
+	};
+};
+
+template<int ORDER> constexpr t_amsample t_amstring_cc<ORDER>::value[AMSTRING_MAXPADDED];
+
+/*
+ * Call fn<order> with the given (parenthesised) arguments, for an order already
+ * validated by amstring_setOrder
+ */
+#define AMSTRING_ORDER_DISPATCH(order, fn, args) \
+	switch(order) { \
+		case 1: fn<1> args; break; \
+		case 3: fn<3> args; break; \
+		case 5: fn<5> args; break; \
+		case 7: fn<7> args; break; \
+		default: fn<9> args; break; \
+	}
+
+/*
+ * Scalar kernels (see am.string.simd.h for the meaning of the arguments)
+ */
+template<int ORDER> static inline t_amsample amstring_tapSumOrder(const t_amsample* lcoeff, const t_amsample* span)
+{
+	const int PADDED = AMSTRING_PADDED(ORDER);
+	t_amsample sum = lcoeff[0]*span[PADDED-1];
+	for(int i=1; i<=ORDER; i++) {
+		sum += lcoeff[i]*span[PADDED-1-i];
+	}
+	return sum;
+}
+
+template<int ORDER> static inline void amstring_lagCoeffsOrder(t_amsample D, t_amsample* lcoeff)
+{
+	const int PADDED = AMSTRING_PADDED(ORDER);
+	const t_amsample* cc = t_amstring_cc<ORDER>::value;
+	t_amsample dminusk[ORDER+1];
+	int i, k;
+
+	for(k=0; k<=ORDER; k++) dminusk[k] = D - (t_amsample)k;
+	for(i=0; i<=ORDER; i++)
+	{
+		lcoeff[i] = cc[i];
+		for(k=0; k<=ORDER; k++)
+		{
+			if(k!=i) { lcoeff[i] *= dminusk[k]; }
+		}
+	}
+	for(i=ORDER+1; i<PADDED; i++) lcoeff[i] = 0.0;
+}
+
+template<int ORDER> static inline t_amsample amstring_farrowOrder(const t_amsample* farrow, const t_amsample* span, t_amsample d)
+{
+	const int PADDED = AMSTRING_PADDED(ORDER);
+	t_amsample y = 0.0;
+	t_amsample power = 1.0;
+	for(int m=0; m<=ORDER; m++)
+	{
+		t_amsample sub = farrow[m] * span[PADDED-1];
+		for(int i=1; i<=ORDER; i++) sub += farrow[i*PADDED + m] * span[PADDED-1-i];
+		y += sub * power;
+		power *= d;
+	}
+	return y;
+}
+
+#endif
@@ -0,0 +1,125 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  am.string.pool.cpp
+//  am.string~
+//
+
+#include "am.string.pool.h"
+
+static bool ampool_takeTask(t_ampool *pool, long w, long *task)
+{
+	{
+		std::lock_guard<std::mutex> guard(pool->workers[w].lock);
+		if(!pool->workers[w].tasks.empty()) {
+			*task = pool->workers[w].tasks.back();
+			pool->workers[w].tasks.pop_back();
+			return true;
+		}
+	}
+	for(long i=1; i<pool->numWorkers; i++)
+	{
+		t_ampool_worker* victim = &pool->workers[(w + i) % pool->numWorkers];
+		std::lock_guard<std::mutex> guard(victim->lock);
+		if(!victim->tasks.empty()) {
+			*task = victim->tasks.front();
+			victim->tasks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+static void ampool_work(t_ampool *pool, long w)
+{
+	long task;
+	while(ampool_takeTask(pool, w, &task))
+	{
+		pool->fn(pool->context, task);
+		if(pool->remaining.fetch_sub(1) == 1) {
+			std::lock_guard<std::mutex> guard(pool->lock);
+			pool->finished.notify_all();
+		}
+	}
+}
+
+static void ampool_workerThread(t_ampool *pool, long w)
+{
+	long seen = 0;
+	for(;;)
+	{
+		{
+			std::unique_lock<std::mutex> guard(pool->lock);
+			pool->started.wait(guard, [&] { return pool->quit || pool->generation != seen; });
+			if(pool->quit) return;
+			seen = pool->generation;
+		}
+		ampool_work(pool, w);
+	}
+}
+
+void ampool_start(t_ampool *pool, long numWorkers)
+{
+	pool->numWorkers = numWorkers > 0 ? numWorkers : 1;
+	pool->workers = new t_ampool_worker[pool->numWorkers];
+	pool->remaining = 0;
+	pool->generation = 0;
+	pool->quit = false;
+	for(long w=1; w<pool->numWorkers; w++) pool->threads.push_back(std::thread(ampool_workerThread, pool, w));
+}
+
+/*
+ * Run tasks 0..numTasks-1. (The batch is set up before its tasks are dealt, as a worker
+ * still looking for work from the last batch may take one of them straight away.)
+ */
+void ampool_run(t_ampool *pool, long numTasks, t_ampool_taskFn fn, void *context)
+{
+	if(numTasks <= 0) return;
+	{
+		std::lock_guard<std::mutex> guard(pool->lock);
+		pool->fn = fn;
+		pool->context = context;
+		pool->remaining = numTasks;
+	}
+	for(long w=0; w<pool->numWorkers; w++)
+	{
+		std::lock_guard<std::mutex> guard(pool->workers[w].lock);
+		for(long t = w * numTasks / pool->numWorkers; t < (w + 1) * numTasks / pool->numWorkers; t++) pool->workers[w].tasks.push_back(t);
+	}
+	{
+		std::lock_guard<std::mutex> guard(pool->lock);
+		pool->generation++;
+	}
+	pool->started.notify_all();
+	ampool_work(pool, 0);
+
+	std::unique_lock<std::mutex> guard(pool->lock);
+	pool->finished.wait(guard, [&] { return pool->remaining.load() == 0; });
+}
+
+void ampool_stop(t_ampool *pool)
+{
+	{
+		std::lock_guard<std::mutex> guard(pool->lock);
+		pool->quit = true;
+	}
+	pool->started.notify_all();
+	for(size_t i=0; i<pool->threads.size(); i++) pool->threads[i].join();
+	pool->threads.clear();
+	delete [] pool->workers;
+}
@@ -0,0 +1,70 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  am.string.pool.h
+//  am.string~
+//
+//  A pool of worker threads for the headless tools, which runs batches of independent
+//  tasks with work stealing: each worker owns a deque of task indices, dealt out in
+//  contiguous runs, taking from its back and, when it is empty, stealing from the
+//  front of the others'. The calling thread is worker 0, and ampool_run returns when
+//  every task of the batch has finished.
+//
+
+#ifndef am_string__am_string_pool_h
+#define am_string__am_string_pool_h
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef void (*t_ampool_taskFn)(void *context, long task);
+
+typedef struct _ampool_worker
+{
+	std::mutex lock;
+	std::deque<long> tasks;
+} t_ampool_worker;
+
+typedef struct _ampool
+{
+	long numWorkers;
+	t_ampool_worker* workers;
+	std::vector<std::thread> threads;
+
+	// [ the current batch of tasks: its function, and how many of its tasks are unfinished ]
+	t_ampool_taskFn fn;
+	void* context;
+	std::atomic<long> remaining;
+
+	// [ batches are started by incrementing generation; quit ends the threads ]
+	std::mutex lock;
+	std::condition_variable started;
+	std::condition_variable finished;
+	long generation;
+	bool quit;
+} t_ampool;
+
+void ampool_start(t_ampool *pool, long numWorkers);
+void ampool_run(t_ampool *pool, long numTasks, t_ampool_taskFn fn, void *context);
+void ampool_stop(t_ampool *pool);
+
+#endif
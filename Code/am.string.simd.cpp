@@ -0,0 +1,433 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  am.string.simd.cpp
+//  am.string~
+//
+//  The x86 kernels are compiled with per-function target attributes, so this
+//  file needs no special compiler flags and the kernels are only ever called
+//  after checking that the host supports them.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include "am.string.core.h"
+#include "am.string.simd.h"
+
+#ifdef AMSTRING_SIMD_X86
+#include <immintrin.h>
+#endif
+
+/****************************************************************************************************
+ * Scalar kernels
+ */
+
+static t_amsample amstring_tapSumScalar(const t_amsample* lcoeff, const t_amsample* span)
+{
+	t_amsample sum = lcoeff[0]*span[VD_FILTER_PADDED-1];
+	for(int i=1; i<VD_FILTER_PADDED; i++) {
+		sum += lcoeff[i]*span[VD_FILTER_PADDED-1-i];
+	}
+	return sum;
+}
+
+static void amstring_blockTapSumScalar(const t_amsample* lcoeff, const t_amsample* span, t_amsample* out, long n)
+{
+	long k;
+	for(k=0; k<n; k++) out[k] = lcoeff[0]*span[k + VD_FILTER_PADDED-1];
+	for(int i=1; i<VD_FILTER_PADDED; i++) {
+		for(k=0; k<n; k++) out[k] += lcoeff[i]*span[k + VD_FILTER_PADDED-1-i];
+	}
+}
+
+static void amstring_lagCoeffsScalar(t_amsample D, const t_amsample* cc, t_amsample* lcoeff)
+{
+	t_amsample dminusk[VD_FILTER_PADDED];
+	int i, k, order;
+
+	// [ the order is where the zero padding of cc starts ]
+	for(order=VD_FILTER_PADDED-1; order>0 && cc[order]==0.0; order--);
+
+	// [ the nested product of the original perform routines: lcoeff[i] = cc[i] * prod_{k!=i}(D-k) ]
+	for(k=0; k<=order; k++) dminusk[k] = D - (t_amsample)k;
+	for(i=0; i<=order; i++)
+	{
+		lcoeff[i] = cc[i];
+		for(k=0; k<=order; k++)
+		{
+			if(k!=i) { lcoeff[i] *= dminusk[k]; }
+		}
+	}
+	for(i=order+1; i<VD_FILTER_PADDED; i++) lcoeff[i] = 0.0;
+}
+
+static t_amsample amstring_farrowScalar(const t_amsample* farrow, const t_amsample* span, t_amsample d)
+{
+	int i, m;
+
+	// [ the output of the sub-filter for the coefficients of d^m, times d^m, summed over m ]
+	// ( powers of d rather than Horner's rule, so that the sub-filters do not wait on each other )
+	t_amsample y = 0.0;
+	t_amsample power = 1.0;
+	for(m=0; m<VD_FILTER_PADDED; m++)
+	{
+		t_amsample sub = farrow[m] * span[VD_FILTER_PADDED-1];
+		for(i=1; i<VD_FILTER_PADDED; i++) sub += farrow[i*VD_FILTER_PADDED + m] * span[VD_FILTER_PADDED-1-i];
+		y += sub * power;
+		power *= d;
+	}
+	return y;
+}
+
+#if defined(AMSTRING_SIMD_X86) && !defined(AMSTRING_FLOAT)
+
+/****************************************************************************************************
+ * SSE2 kernels
+ */
+
+__attribute__((target("sse2")))
+static t_sample amstring_tapSumSSE2(const t_sample* lcoeff, const t_sample* span)
+{
+	__m128d sum = _mm_setzero_pd();
+	for(int i=0; i<VD_FILTER_PADDED; i+=2) {
+		__m128d taps = _mm_loadu_pd(span + VD_FILTER_PADDED - 2 - i);
+		taps = _mm_shuffle_pd(taps, taps, 1); // reverse the pair
+		sum = _mm_add_pd(sum, _mm_mul_pd(_mm_loadu_pd(lcoeff + i), taps));
+	}
+	return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+}
+
+/****************************************************************************************************
+ * AVX2 kernels
+ */
+
+// [ lanes 0..3 of v rotated by one, two and three places, multiplied together ]
+__attribute__((target("avx2,fma")))
+static inline __m256d amstring_othersProductAVX2(__m256d v)
+{
+	__m256d r1 = _mm256_permute4x64_pd(v, 0x39);
+	__m256d r2 = _mm256_permute4x64_pd(v, 0x4E);
+	__m256d r3 = _mm256_permute4x64_pd(v, 0x93);
+	return _mm256_mul_pd(_mm256_mul_pd(r1, r2), r3);
+}
+
+__attribute__((target("avx2,fma")))
+static t_sample amstring_tapSumAVX2(const t_sample* lcoeff, const t_sample* span)
+{
+	// [ reverse each half of the span and pair it with the opposite half of the coefficients ]
+	__m256d tapsLo = _mm256_permute4x64_pd(_mm256_loadu_pd(span + 4), 0x1B);
+	__m256d tapsHi = _mm256_permute4x64_pd(_mm256_loadu_pd(span), 0x1B);
+	__m256d sum = _mm256_mul_pd(_mm256_loadu_pd(lcoeff), tapsLo);
+	sum = _mm256_fmadd_pd(_mm256_loadu_pd(lcoeff + 4), tapsHi, sum);
+
+	__m128d pair = _mm_add_pd(_mm256_castpd256_pd128(sum), _mm256_extractf128_pd(sum, 1));
+	return _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+}
+
+__attribute__((target("avx2,fma")))
+static void amstring_blockTapSumAVX2(const t_sample* lcoeff, const t_sample* span, t_sample* out, long n)
+{
+	long k = 0;
+
+	// [ four outputs at a time, each lane accumulating one output over the taps ]
+	for(; k+4<=n; k+=4)
+	{
+		__m256d sum = _mm256_mul_pd(_mm256_set1_pd(lcoeff[0]), _mm256_loadu_pd(span + k + VD_FILTER_PADDED-1));
+		for(int i=1; i<VD_FILTER_PADDED; i++) {
+			sum = _mm256_fmadd_pd(_mm256_set1_pd(lcoeff[i]), _mm256_loadu_pd(span + k + VD_FILTER_PADDED-1-i), sum);
+		}
+		_mm256_storeu_pd(out + k, sum);
+	}
+	if(k < n) amstring_blockTapSumScalar(lcoeff, span + k, out + k, n - k);
+}
+
+__attribute__((target("avx2,fma")))
+static void amstring_lagCoeffsAVX2(t_sample D, const t_sample* cc, t_sample* lcoeff)
+{
+	// [ (D-k) for k = 0..7, with 1.0 in the padding lanes (where cc is zero) ]
+	static const double offsets[8] = { 0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0 };
+	__m256d d = _mm256_set1_pd(D);
+	__m256d ccLo = _mm256_loadu_pd(cc);
+	__m256d ccHi = _mm256_loadu_pd(cc + 4);
+	__m256d lo = _mm256_sub_pd(d, _mm256_loadu_pd(offsets));
+	__m256d hi = _mm256_sub_pd(d, _mm256_loadu_pd(offsets + 4));
+	lo = _mm256_blendv_pd(lo, _mm256_set1_pd(1.0), _mm256_cmp_pd(ccLo, _mm256_setzero_pd(), _CMP_EQ_OQ));
+	hi = _mm256_blendv_pd(hi, _mm256_set1_pd(1.0), _mm256_cmp_pd(ccHi, _mm256_setzero_pd(), _CMP_EQ_OQ));
+
+	__m256d othersLo = amstring_othersProductAVX2(lo);
+	__m256d othersHi = amstring_othersProductAVX2(hi);
+	__m256d allLo = _mm256_mul_pd(othersLo, lo);
+	__m256d allHi = _mm256_mul_pd(othersHi, hi);
+
+	_mm256_storeu_pd(lcoeff,     _mm256_mul_pd(_mm256_mul_pd(ccLo, othersLo), allHi));
+	_mm256_storeu_pd(lcoeff + 4, _mm256_mul_pd(_mm256_mul_pd(ccHi, othersHi), allLo));
+}
+
+__attribute__((target("avx2,fma")))
+static t_sample amstring_farrowAVX2(const t_sample* farrow, const t_sample* span, t_sample d)
+{
+	// [ sub-filter outputs for d^0..d^3 (lo) and d^4..d^7 (hi), the taps split between two sets of sums ]
+	__m256d lo0 = _mm256_setzero_pd(), hi0 = _mm256_setzero_pd();
+	__m256d lo1 = _mm256_setzero_pd(), hi1 = _mm256_setzero_pd();
+	for(int i=0; i<VD_FILTER_PADDED; i+=2)
+	{
+		__m256d tap0 = _mm256_broadcast_sd(span + VD_FILTER_PADDED-1-i);
+		__m256d tap1 = _mm256_broadcast_sd(span + VD_FILTER_PADDED-2-i);
+		lo0 = _mm256_fmadd_pd(_mm256_loadu_pd(farrow + i*VD_FILTER_PADDED), tap0, lo0);
+		hi0 = _mm256_fmadd_pd(_mm256_loadu_pd(farrow + i*VD_FILTER_PADDED + 4), tap0, hi0);
+		lo1 = _mm256_fmadd_pd(_mm256_loadu_pd(farrow + (i+1)*VD_FILTER_PADDED), tap1, lo1);
+		hi1 = _mm256_fmadd_pd(_mm256_loadu_pd(farrow + (i+1)*VD_FILTER_PADDED + 4), tap1, hi1);
+	}
+
+	// [ combine with (1, d, d^2, d^3) and d^4 times the same ]
+	t_sample d2 = d * d;
+	__m256d powers = _mm256_setr_pd(1.0, d, d2, d2 * d);
+	__m256d sum = _mm256_mul_pd(_mm256_add_pd(lo0, lo1), powers);
+	sum = _mm256_fmadd_pd(_mm256_add_pd(hi0, hi1), _mm256_mul_pd(powers, _mm256_set1_pd(d2 * d2)), sum);
+
+	__m128d pair = _mm_add_pd(_mm256_castpd256_pd128(sum), _mm256_extractf128_pd(sum, 1));
+	return _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+}
+
+/****************************************************************************************************
+ * AVX-512 kernels
+ *
+ * (The AVX-512 set uses the AVX2 tap sum: reversing a single 512-bit span and reducing
+ * it measured slower than the two 256-bit halves.)
+ */
+
+__attribute__((target("avx512f")))
+static void amstring_blockTapSumAVX512(const t_sample* lcoeff, const t_sample* span, t_sample* out, long n)
+{
+	long k = 0;
+
+	// [ eight outputs at a time (the rest as in the AVX2 kernel) ]
+	for(; k+8<=n; k+=8)
+	{
+		__m512d sum = _mm512_mul_pd(_mm512_set1_pd(lcoeff[0]), _mm512_loadu_pd(span + k + VD_FILTER_PADDED-1));
+		for(int i=1; i<VD_FILTER_PADDED; i++) {
+			sum = _mm512_fmadd_pd(_mm512_set1_pd(lcoeff[i]), _mm512_loadu_pd(span + k + VD_FILTER_PADDED-1-i), sum);
+		}
+		_mm512_storeu_pd(out + k, sum);
+	}
+	if(k < n) amstring_blockTapSumAVX2(lcoeff, span + k, out + k, n - k);
+}
+
+__attribute__((target("avx512f")))
+static void amstring_lagCoeffsAVX512(t_sample D, const t_sample* cc, t_sample* lcoeff)
+{
+	// [ (D-k) for k = 0..7, with 1.0 in the padding lanes (where cc is zero) ]
+	__m512d c = _mm512_loadu_pd(cc);
+	__m512d v = _mm512_sub_pd(_mm512_set1_pd(D), _mm512_set_pd(7.0, 6.0, 5.0, 4.0, 3.0, 2.0, 1.0, 0.0));
+	v = _mm512_mask_mov_pd(v, _mm512_cmp_pd_mask(c, _mm512_setzero_pd(), _CMP_EQ_OQ), _mm512_set1_pd(1.0));
+
+	// [ product of the other seven lanes, from the seven rotations of v ]
+	__m512d r1 = _mm512_permutexvar_pd(_mm512_set_epi64(0, 7, 6, 5, 4, 3, 2, 1), v);
+	__m512d r2 = _mm512_permutexvar_pd(_mm512_set_epi64(1, 0, 7, 6, 5, 4, 3, 2), v);
+	__m512d r3 = _mm512_permutexvar_pd(_mm512_set_epi64(2, 1, 0, 7, 6, 5, 4, 3), v);
+	__m512d r4 = _mm512_permutexvar_pd(_mm512_set_epi64(3, 2, 1, 0, 7, 6, 5, 4), v);
+	__m512d r5 = _mm512_permutexvar_pd(_mm512_set_epi64(4, 3, 2, 1, 0, 7, 6, 5), v);
+	__m512d r6 = _mm512_permutexvar_pd(_mm512_set_epi64(5, 4, 3, 2, 1, 0, 7, 6), v);
+	__m512d r7 = _mm512_permutexvar_pd(_mm512_set_epi64(6, 5, 4, 3, 2, 1, 0, 7), v);
+	__m512d others = _mm512_mul_pd(_mm512_mul_pd(_mm512_mul_pd(r1, r2), _mm512_mul_pd(r3, r4)), _mm512_mul_pd(_mm512_mul_pd(r5, r6), r7));
+	_mm512_storeu_pd(lcoeff, _mm512_mul_pd(c, others));
+}
+
+#endif // AMSTRING_SIMD_X86 && !AMSTRING_FLOAT
+
+#if defined(AMSTRING_SIMD_X86) && defined(AMSTRING_FLOAT)
+
+/****************************************************************************************************
+ * Single precision SSE2 kernels
+ */
+
+__attribute__((target("sse2")))
+static t_amsample amstring_tapSumSSE2(const t_amsample* lcoeff, const t_amsample* span)
+{
+	// [ reverse each half of the span and pair it with the opposite half of the coefficients ]
+	__m128 tapsLo = _mm_loadu_ps(span + 4);
+	__m128 tapsHi = _mm_loadu_ps(span);
+	tapsLo = _mm_shuffle_ps(tapsLo, tapsLo, 0x1B);
+	tapsHi = _mm_shuffle_ps(tapsHi, tapsHi, 0x1B);
+	__m128 sum = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(lcoeff), tapsLo), _mm_mul_ps(_mm_loadu_ps(lcoeff + 4), tapsHi));
+
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	return _mm_cvtss_f32(_mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55)));
+}
+
+/****************************************************************************************************
+ * Single precision AVX2 kernels (the whole span, and all of the coefficients, in one __m256)
+ */
+
+__attribute__((target("avx2,fma")))
+static t_amsample amstring_tapSumAVX2(const t_amsample* lcoeff, const t_amsample* span)
+{
+	__m256 taps = _mm256_permutevar8x32_ps(_mm256_loadu_ps(span), _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+	__m256 prod = _mm256_mul_ps(_mm256_loadu_ps(lcoeff), taps);
+
+	__m128 sum = _mm_add_ps(_mm256_castps256_ps128(prod), _mm256_extractf128_ps(prod, 1));
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	return _mm_cvtss_f32(_mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55)));
+}
+
+__attribute__((target("avx2,fma")))
+static void amstring_blockTapSumAVX2(const t_amsample* lcoeff, const t_amsample* span, t_amsample* out, long n)
+{
+	long k = 0;
+
+	// [ eight outputs at a time, each lane accumulating one output over the taps ]
+	for(; k+8<=n; k+=8)
+	{
+		__m256 sum = _mm256_mul_ps(_mm256_set1_ps(lcoeff[0]), _mm256_loadu_ps(span + k + VD_FILTER_PADDED-1));
+		for(int i=1; i<VD_FILTER_PADDED; i++) {
+			sum = _mm256_fmadd_ps(_mm256_set1_ps(lcoeff[i]), _mm256_loadu_ps(span + k + VD_FILTER_PADDED-1-i), sum);
+		}
+		_mm256_storeu_ps(out + k, sum);
+	}
+	if(k < n) amstring_blockTapSumScalar(lcoeff, span + k, out + k, n - k);
+}
+
+__attribute__((target("avx2,fma")))
+static void amstring_lagCoeffsAVX2(t_amsample D, const t_amsample* cc, t_amsample* lcoeff)
+{
+	// [ (D-k) for k = 0..7, with 1.0 in the padding lanes (where cc is zero) ]
+	__m256 c = _mm256_loadu_ps(cc);
+	__m256 v = _mm256_sub_ps(_mm256_set1_ps(D), _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f));
+	v = _mm256_blendv_ps(v, _mm256_set1_ps(1.0f), _mm256_cmp_ps(c, _mm256_setzero_ps(), _CMP_EQ_OQ));
+
+	// [ product of the other seven lanes, from the seven rotations of v ]
+	__m256 r1 = _mm256_permutevar8x32_ps(v, _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0));
+	__m256 r2 = _mm256_permutevar8x32_ps(v, _mm256_setr_epi32(2, 3, 4, 5, 6, 7, 0, 1));
+	__m256 r3 = _mm256_permutevar8x32_ps(v, _mm256_setr_epi32(3, 4, 5, 6, 7, 0, 1, 2));
+	__m256 r4 = _mm256_permutevar8x32_ps(v, _mm256_setr_epi32(4, 5, 6, 7, 0, 1, 2, 3));
+	__m256 r5 = _mm256_permutevar8x32_ps(v, _mm256_setr_epi32(5, 6, 7, 0, 1, 2, 3, 4));
+	__m256 r6 = _mm256_permutevar8x32_ps(v, _mm256_setr_epi32(6, 7, 0, 1, 2, 3, 4, 5));
+	__m256 r7 = _mm256_permutevar8x32_ps(v, _mm256_setr_epi32(7, 0, 1, 2, 3, 4, 5, 6));
+	__m256 others = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(r1, r2), _mm256_mul_ps(r3, r4)), _mm256_mul_ps(_mm256_mul_ps(r5, r6), r7));
+	_mm256_storeu_ps(lcoeff, _mm256_mul_ps(c, others));
+}
+
+__attribute__((target("avx2,fma")))
+static t_amsample amstring_farrowAVX2(const t_amsample* farrow, const t_amsample* span, t_amsample d)
+{
+	// [ sub-filter outputs for d^0..d^7, the taps split between two sums ]
+	__m256 sub0 = _mm256_setzero_ps(), sub1 = _mm256_setzero_ps();
+	for(int i=0; i<VD_FILTER_PADDED; i+=2)
+	{
+		sub0 = _mm256_fmadd_ps(_mm256_loadu_ps(farrow + i*VD_FILTER_PADDED), _mm256_broadcast_ss(span + VD_FILTER_PADDED-1-i), sub0);
+		sub1 = _mm256_fmadd_ps(_mm256_loadu_ps(farrow + (i+1)*VD_FILTER_PADDED), _mm256_broadcast_ss(span + VD_FILTER_PADDED-2-i), sub1);
+	}
+
+	// [ combine with the powers of d ]
+	t_amsample d2 = d * d;
+	t_amsample d4 = d2 * d2;
+	__m256 powers = _mm256_setr_ps(1.0f, d, d2, d2 * d, d4, d4 * d, d4 * d2, d4 * d2 * d);
+	__m256 prod = _mm256_mul_ps(_mm256_add_ps(sub0, sub1), powers);
+
+	__m128 sum = _mm_add_ps(_mm256_castps256_ps128(prod), _mm256_extractf128_ps(prod, 1));
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	return _mm_cvtss_f32(_mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55)));
+}
+
+#endif // AMSTRING_SIMD_X86 && AMSTRING_FLOAT
+
+/****************************************************************************************************
+ * Dispatch
+ */
+
+t_amstring_tapSumFn amstring_tapSum = amstring_tapSumScalar;
+t_amstring_lagCoeffsFn amstring_lagCoeffs = amstring_lagCoeffsScalar;
+t_amstring_farrowFn amstring_farrow = amstring_farrowScalar;
+t_amstring_blockTapSumFn amstring_blockTapSum = amstring_blockTapSumScalar;
+long amstring_simdScalar = 1;
+static const char* amstring_simdKernelName = "scalar";
+
+/*
+ * Force a particular set of kernels ("scalar", "sse2", "avx2" or "avx512",
+ * the last not with AMSTRING_FLOAT).
+ * Returns 0 (and changes nothing) if the host does not support it.
+ */
+long amstring_simdSelect(const char* name)
+{
+	if(!strcmp(name, "scalar")) {
+		amstring_tapSum = amstring_tapSumScalar;
+		amstring_lagCoeffs = amstring_lagCoeffsScalar;
+		amstring_farrow = amstring_farrowScalar;
+		amstring_blockTapSum = amstring_blockTapSumScalar;
+		amstring_simdScalar = 1;
+		amstring_simdKernelName = "scalar";
+		return 1;
+	}
+#ifdef AMSTRING_SIMD_X86
+	__builtin_cpu_init();
+	if(!strcmp(name, "sse2") && __builtin_cpu_supports("sse2")) {
+		amstring_tapSum = amstring_tapSumSSE2;
+		amstring_lagCoeffs = amstring_lagCoeffsScalar;
+		amstring_farrow = amstring_farrowScalar;
+		amstring_blockTapSum = amstring_blockTapSumScalar;
+		amstring_simdScalar = 0;
+		amstring_simdKernelName = "sse2";
+		return 1;
+	}
+	if(!strcmp(name, "avx2") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+		amstring_tapSum = amstring_tapSumAVX2;
+		amstring_lagCoeffs = amstring_lagCoeffsAVX2;
+		amstring_farrow = amstring_farrowAVX2;
+		amstring_blockTapSum = amstring_blockTapSumAVX2;
+		amstring_simdScalar = 0;
+		amstring_simdKernelName = "avx2";
+		return 1;
+	}
+#ifndef AMSTRING_FLOAT
+	if(!strcmp(name, "avx512") && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+		amstring_tapSum = amstring_tapSumAVX2;
+		amstring_lagCoeffs = amstring_lagCoeffsAVX512;
+		amstring_farrow = amstring_farrowAVX2;
+		amstring_blockTapSum = amstring_blockTapSumAVX512;
+		amstring_simdScalar = 0;
+		amstring_simdKernelName = "avx512";
+		return 1;
+	}
+#endif
+#endif
+	return 0;
+}
+
+/*
+ * Choose the best kernels for the host, once. The AMSTRING_SIMD environment
+ * variable can be set to one of the names above to override the choice.
+ */
+void amstring_simdInit(void)
+{
+	static bool initialised = false;
+	if(initialised) return;
+	initialised = true;
+
+	const char* forced = getenv("AMSTRING_SIMD");
+	if(forced && amstring_simdSelect(forced)) return;
+
+	if(amstring_simdSelect("avx512")) return;
+	if(amstring_simdSelect("avx2")) return;
+	if(amstring_simdSelect("sse2")) return;
+	amstring_simdSelect("scalar");
+}
+
+const char* amstring_simdName(void)
+{
+	return amstring_simdKernelName;
+}
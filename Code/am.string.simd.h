@@ -0,0 +1,85 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  am.string.simd.h
+//  am.string~
+//
+//  Lagrange interpolation kernels, chosen at run time for the host CPU
+//  (scalar, SSE2, AVX2+FMA or AVX-512 on x86; scalar elsewhere). With AMSTRING_FLOAT
+//  the kernels are single precision, and there is no separate AVX-512 set: a whole
+//  coefficient array then fits in one 256-bit register.
+//
+//  Coefficient arrays hold VD_FILTER_PADDED values, those past the filter order
+//  being zero, so one set of kernels serves every order up to 7 (the lagrange kernels
+//  find the padding from the zeros of cc). A tap span is VD_FILTER_PADDED contiguous
+//  delay line samples ending at the most recent tap, so coefficient i multiplies
+//  span[VD_FILTER_PADDED-1-i]. (The guard zone before the delay line makes every span
+//  contiguous, see DLGUARD.) The perform routines use them at order 7 only, where the
+//  filter fills the span: at the other orders, and when the scalar set is selected
+//  (amstring_simdScalar), they use the unrolled kernels of am.string.order.h instead.
+//
+//  The Farrow kernel takes the place of both for AMSTRING_INTERP_FARROW: it runs the
+//  sub-filters of the Farrow table (see am.string.lagrange.h) over a tap span and
+//  combines their outputs with the powers of d, the fractional delay less the order's DELOFFSET.
+//  (By the powers of d rather than by Horner's rule: the powers do not depend on the
+//  taps, so the chain of dependent steps is shorter.) It does (order+1)^2
+//  multiply-adds against the order*(order+1) products of the exact
+//  coefficients, but needs no per-sample coefficient array.
+//
+//  The block tap sum does the work of the tap sum for n consecutive outputs at once, output
+//  k having the span at span + k. It is for a delay that is at least n samples, when none of
+//  the n spans reaches a sample that is still to be written (see amstring_dodspConstant).
+//  The AVX2 and AVX-512 kernels put consecutive outputs in the lanes of a register, so that
+//  each tap is one multiply-add over four or eight outputs, with no reversal or horizontal
+//  sum (the SSE2 set has the scalar one).
+//
+//  Tolerance: the scalar kernels do the arithmetic of the original perform loops
+//  in the same order and are bit-identical to them. The SIMD kernels add the tap
+//  products in a different order (and with fused multiply-adds), so a tap sum may
+//  differ by up to VD_FILTER_PADDED * 2^-53 * sum|lcoeff[i]*tap[i]|, and they form
+//  each coefficient's product of (D-k) in a different order, so a coefficient may
+//  differ by up to VD_FILTER_PADDED * 2^-53 relative to the scalar value. Both are
+//  about 1e-15 relative; over a decaying string the outputs of the kernel sets were
+//  measured to agree to within 6e-15 of a full-scale output. (In single precision
+//  read 2^-24 for 2^-53: about 5e-7 relative.)
+//
+
+#ifndef am_string__am_string_simd_h
+#define am_string__am_string_simd_h
+
+// [ x86 kernels are compiled with per-function target attributes, which need GCC or clang ]
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AMSTRING_SIMD_X86
+#endif
+
+typedef t_amsample (*t_amstring_tapSumFn)(const t_amsample* lcoeff, const t_amsample* span);
+typedef void (*t_amstring_lagCoeffsFn)(t_amsample D, const t_amsample* cc, t_amsample* lcoeff);
+typedef t_amsample (*t_amstring_farrowFn)(const t_amsample* farrow, const t_amsample* span, t_amsample d);
+typedef void (*t_amstring_blockTapSumFn)(const t_amsample* lcoeff, const t_amsample* span, t_amsample* out, long n);
+
+extern t_amstring_tapSumFn amstring_tapSum;
+extern t_amstring_lagCoeffsFn amstring_lagCoeffs;
+extern t_amstring_farrowFn amstring_farrow;
+extern t_amstring_blockTapSumFn amstring_blockTapSum;
+extern long amstring_simdScalar;
+
+void amstring_simdInit(void);
+long amstring_simdSelect(const char* name);
+const char* amstring_simdName(void);
+
+#endif
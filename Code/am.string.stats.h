@@ -0,0 +1,163 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  am.string.stats.h
+//  am.string~
+//
+//  Per-instance performance counters, shown by the 'stats' message. They are written
+//  only by the audio thread, once per perform call, and can be read at any time from
+//  another. With a single writer no read-modify-write is needed: each update is a
+//  relaxed atomic load and store, which is wait-free and compiles to ordinary moves.
+//  Each counter is read atomically, but a reading may take some counters before and some
+//  after a vector. A reset is requested by the reader and done by the audio thread at
+//  its next call, so the counters never have a second writer.
+//
+//  Time is counted in ticks of amstring_statsClock: the time-stamp counter on x86, which
+//  costs a few cycles to read, and the monotonic clock in nanoseconds elsewhere. The tick
+//  rate is found when the counters are read, from the ticks and nanoseconds that have
+//  passed since the last reset.
+//
+
+#ifndef am_string__am_string_stats_h
+#define am_string__am_string_stats_h
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#if (defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)))
+#include <x86intrin.h>
+#define AMSTRING_STATS_TSC
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define AMSTRING_STATS_TSC
+#endif
+
+/*
+ * The perform routine last run (as chosen by amstring_dsp64)
+ */
+enum {
+	AMSTRING_ROUTINE_NONE = 0,
+	AMSTRING_ROUTINE_DODSP1,    // signal input only
+	AMSTRING_ROUTINE_DODSP2,    // signal input and period
+	AMSTRING_ROUTINE_DODSP3     // signal input, gain and period
+};
+
+typedef std::atomic<uint64_t> t_amstring_counter;
+
+typedef struct _amstring_stats
+{
+	// [ perform calls, of which found the string asleep, and of which found the signal inlets constant, and samples processed ]
+	t_amstring_counter calls;
+	t_amstring_counter asleepCalls;
+	t_amstring_counter constantCalls;
+	t_amstring_counter samples;
+
+	// [ ticks taken by the perform calls: in total, by the slowest and by the last ]
+	t_amstring_counter ticks;
+	t_amstring_counter maxTicks;
+	t_amstring_counter lastTicks;
+
+	// [ samples of the period and gain signals outside their allowed ranges (and so clamped) ]
+	t_amstring_counter periodClamps;
+	t_amstring_counter gainClamps;
+
+	t_amstring_counter routine;
+
+	// [ set by the reader to have the audio thread reset the counters ]
+	t_amstring_counter resetRequested;
+
+	// [ clock readings at the last reset, for finding the tick rate ]
+	t_amstring_counter startTicks;
+	t_amstring_counter startNanos;
+} t_amstring_stats;
+
+/*
+ * A reading of the counters, with the tick rate
+ */
+typedef struct _amstring_statsReport
+{
+	uint64_t calls;
+	uint64_t asleepCalls;
+	uint64_t constantCalls;
+	uint64_t samples;
+	uint64_t ticks;
+	uint64_t maxTicks;
+	uint64_t lastTicks;
+	uint64_t periodClamps;
+	uint64_t gainClamps;
+	long routine;
+	double ticksPerSecond;
+} t_amstring_statsReport;
+
+static inline uint64_t amstring_statsClock(void)
+{
+#ifdef AMSTRING_STATS_TSC
+	return (uint64_t)__rdtsc();
+#else
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+static inline uint64_t amstring_statsNanos(void)
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+ * Add to a counter (from the audio thread only)
+ */
+static inline void amstring_statsAdd(t_amstring_counter *counter, uint64_t n)
+{
+	counter->store(counter->load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+/*
+ * Zero the counters and restart the clock (from the audio thread, or before it runs)
+ */
+static inline void amstring_statsClear(t_amstring_stats *s)
+{
+	s->calls.store(0, std::memory_order_relaxed);
+	s->asleepCalls.store(0, std::memory_order_relaxed);
+	s->constantCalls.store(0, std::memory_order_relaxed);
+	s->samples.store(0, std::memory_order_relaxed);
+	s->ticks.store(0, std::memory_order_relaxed);
+	s->maxTicks.store(0, std::memory_order_relaxed);
+	s->lastTicks.store(0, std::memory_order_relaxed);
+	s->periodClamps.store(0, std::memory_order_relaxed);
+	s->gainClamps.store(0, std::memory_order_relaxed);
+	s->startTicks.store(amstring_statsClock(), std::memory_order_relaxed);
+	s->startNanos.store(amstring_statsNanos(), std::memory_order_relaxed);
+	s->resetRequested.store(0, std::memory_order_relaxed);
+}
+
+/*
+ * At the end of a perform call that started at tick start
+ */
+static inline void amstring_statsCall(t_amstring_stats *s, long routine, long sampleframes, uint64_t start)
+{
+	uint64_t ticks = amstring_statsClock() - start;
+	if(s->resetRequested.load(std::memory_order_relaxed)) amstring_statsClear(s);
+	amstring_statsAdd(&s->calls, 1);
+	amstring_statsAdd(&s->samples, (uint64_t)sampleframes);
+	amstring_statsAdd(&s->ticks, ticks);
+	if(ticks > s->maxTicks.load(std::memory_order_relaxed)) s->maxTicks.store(ticks, std::memory_order_relaxed);
+	s->lastTicks.store(ticks, std::memory_order_relaxed);
+	s->routine.store((uint64_t)routine, std::memory_order_relaxed);
+}
+
+#endif
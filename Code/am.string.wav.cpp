@@ -0,0 +1,303 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  am.string.wav.cpp
+//  am.string~
+//
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "am.string.wav.h"
+
+#define AMWAV_BUFFER_SAMPLES 8192 // samples converted at a time (so also the most channels a file can have)
+
+#define AMWAV_TAG_PCM 1
+#define AMWAV_TAG_FLOAT 3
+#define AMWAV_TAG_EXTENSIBLE 0xfffe
+
+static long amwav_bytesPerSample(long format)
+{
+	switch(format) {
+		case AMWAV_PCM16: return 2;
+		case AMWAV_PCM24: return 3;
+		case AMWAV_FLOAT64: return 8;
+		default: return 4;
+	}
+}
+
+/*
+ * Load and store little-endian integers of 2 and 4 bytes
+ */
+static void amwav_put16(unsigned char* p, unsigned long v)
+{
+	p[0] = (unsigned char)(v & 0xff);
+	p[1] = (unsigned char)((v >> 8) & 0xff);
+}
+
+static void amwav_put32(unsigned char* p, unsigned long v)
+{
+	amwav_put16(p, v & 0xffff);
+	amwav_put16(p + 2, (v >> 16) & 0xffff);
+}
+
+static unsigned long amwav_get16(const unsigned char* p)
+{
+	return (unsigned long)p[0] | ((unsigned long)p[1] << 8);
+}
+
+static unsigned long amwav_get32(const unsigned char* p)
+{
+	return amwav_get16(p) | (amwav_get16(p + 2) << 16);
+}
+
+/*
+ * Convert one sample to and from the file's format
+ */
+static void amwav_encode(t_amwav *w, double s, unsigned char* p)
+{
+	if(w->format == AMWAV_FLOAT32) {
+		float f = (float)s;
+		uint32_t bits;
+		memcpy(&bits, &f, 4);
+		amwav_put32(p, bits);
+		return;
+	}
+	if(w->format == AMWAV_FLOAT64) {
+		uint64_t bits;
+		memcpy(&bits, &s, 8);
+		amwav_put32(p, (unsigned long)(bits & 0xffffffffUL));
+		amwav_put32(p + 4, (unsigned long)(bits >> 32));
+		return;
+	}
+	if(s > 1.0 || s < -1.0 || s != s) {
+		w->clipped++;
+		s = s > 0.0 ? 1.0 : -1.0;
+	}
+	if(w->format == AMWAV_PCM16) {
+		amwav_put16(p, (unsigned long)(long)lrint(s * 32767.0));
+	}
+	else if(w->format == AMWAV_PCM24) {
+		unsigned long v = (unsigned long)(long)lrint(s * 8388607.0);
+		amwav_put16(p, v & 0xffff);
+		p[2] = (unsigned char)((v >> 16) & 0xff);
+	}
+	else {
+		amwav_put32(p, (unsigned long)(long)llrint(s * 2147483647.0));
+	}
+}
+
+static double amwav_decode(const t_amwav *w, const unsigned char* p)
+{
+	switch(w->format) {
+		case AMWAV_PCM16:
+			return (double)(int16_t)amwav_get16(p) / 32768.0;
+		case AMWAV_PCM24:
+			return (double)((int32_t)((uint32_t)amwav_get16(p) << 8 | (uint32_t)p[2] << 24) >> 8) / 8388608.0;
+		case AMWAV_PCM32:
+			return (double)(int32_t)(uint32_t)amwav_get32(p) / 2147483648.0;
+		case AMWAV_FLOAT32: {
+			uint32_t bits = (uint32_t)amwav_get32(p);
+			float f;
+			memcpy(&f, &bits, 4);
+			return (double)f;
+		}
+		default: {
+			uint64_t bits = (uint64_t)amwav_get32(p) | ((uint64_t)amwav_get32(p + 4) << 32);
+			double d;
+			memcpy(&d, &bits, 8);
+			return d;
+		}
+	}
+}
+
+/*
+ * The header: RIFF, fmt (extended by cbSize, and followed by a fact chunk, for float)
+ * and the start of the data chunk. Its length is fixed by the format, so it can be
+ * written again over itself when the sizes are known.
+ */
+static long amwav_writeHeader(t_amwav *w)
+{
+	unsigned char h[58];
+	long isFloat = w->format == AMWAV_FLOAT32 || w->format == AMWAV_FLOAT64;
+	unsigned long blockAlign = (unsigned long)(w->channels * amwav_bytesPerSample(w->format));
+	unsigned long dataBytes = (unsigned long)w->frames * blockAlign;
+	unsigned long headerBytes = isFloat ? 58 : 44;
+	unsigned char* p = h;
+
+	memcpy(p, "RIFF", 4);             amwav_put32(p + 4, headerBytes - 8 + dataBytes + (dataBytes & 1)); p += 8;
+	memcpy(p, "WAVE", 4);             p += 4;
+	memcpy(p, "fmt ", 4);             amwav_put32(p + 4, isFloat ? 18 : 16); p += 8;
+	amwav_put16(p, isFloat ? AMWAV_TAG_FLOAT : AMWAV_TAG_PCM);  amwav_put16(p + 2, (unsigned long)w->channels);
+	amwav_put32(p + 4, (unsigned long)w->samplerate);
+	amwav_put32(p + 8, (unsigned long)w->samplerate * blockAlign);
+	amwav_put16(p + 12, blockAlign);  amwav_put16(p + 14, 8 * amwav_bytesPerSample(w->format)); p += 16;
+	if(isFloat) {
+		amwav_put16(p, 0); p += 2;
+		memcpy(p, "fact", 4); amwav_put32(p + 4, 4); amwav_put32(p + 8, (unsigned long)w->frames); p += 12;
+	}
+	memcpy(p, "data", 4);             amwav_put32(p + 4, dataBytes); p += 8;
+
+	if(fseek(w->file, 0, SEEK_SET)) return 0;
+	return fwrite(h, 1, (size_t)(p - h), w->file) == (size_t)(p - h);
+}
+
+static void amwav_reset(t_amwav *w, long writing, long channels, long samplerate, long format)
+{
+	w->file = NULL;
+	w->writing = writing;
+	w->channels = channels;
+	w->samplerate = samplerate;
+	w->format = format;
+	w->frames = 0;
+	w->clipped = 0;
+	w->length = -1;
+}
+
+long amwav_create(t_amwav *w, const char* path, long channels, long samplerate, long format)
+{
+	amwav_reset(w, 1, channels, samplerate, format);
+	if(channels < 1 || channels > AMWAV_BUFFER_SAMPLES) return 0;
+	w->file = fopen(path, "wb");
+	if(!w->file) return 0;
+	if(!amwav_writeHeader(w)) {
+		fclose(w->file);
+		w->file = NULL;
+		return 0;
+	}
+	return 1;
+}
+
+long amwav_write(t_amwav *w, const double* samples, long frames)
+{
+	unsigned char buffer[AMWAV_BUFFER_SAMPLES * 8];
+	long bytesPerSample = amwav_bytesPerSample(w->format);
+	long maxFrames = AMWAV_BUFFER_SAMPLES / w->channels;
+
+	while(frames > 0)
+	{
+		long n = frames < maxFrames ? frames : maxFrames;
+		long count = n * w->channels;
+		for(long i=0; i<count; i++) amwav_encode(w, samples[i], buffer + i * bytesPerSample);
+		if(fwrite(buffer, 1, (size_t)(count * bytesPerSample), w->file) != (size_t)(count * bytesPerSample)) return 0;
+		w->frames += n;
+		samples += count;
+		frames -= n;
+	}
+	return 1;
+}
+
+/*
+ * Open a WAV file for reading: find its format and the start of its data, which is
+ * read to the end of the file if its size is not filled in (as from a recording in progress)
+ */
+long amwav_open(t_amwav *w, const char* path)
+{
+	unsigned char h[40];
+	long tag = 0, bits = 0;
+
+	amwav_reset(w, 0, 0, 0, 0);
+	w->file = fopen(path, "rb");
+	if(!w->file) return 0;
+	if(fread(h, 1, 12, w->file) != 12 || memcmp(h, "RIFF", 4) || memcmp(h + 8, "WAVE", 4)) goto fail;
+
+	for(;;)
+	{
+		if(fread(h, 1, 8, w->file) != 8) goto fail;
+		unsigned long size = amwav_get32(h + 4);
+		if(!memcmp(h, "fmt ", 4)) {
+			unsigned long n = size < sizeof(h) ? size : sizeof(h);
+			if(n < 16 || fread(h, 1, n, w->file) != n) goto fail;
+			tag = (long)amwav_get16(h);
+			w->channels = (long)amwav_get16(h + 2);
+			w->samplerate = (long)amwav_get32(h + 4);
+			bits = (long)amwav_get16(h + 14);
+			// [ WAVE_FORMAT_EXTENSIBLE: the real tag begins the sub-format GUID ]
+			if(tag == AMWAV_TAG_EXTENSIBLE && n >= 26) tag = (long)amwav_get16(h + 24);
+			if(fseek(w->file, (long)(size - n + (size & 1)), SEEK_CUR)) goto fail;
+		}
+		else if(!memcmp(h, "data", 4)) {
+			if(tag == AMWAV_TAG_PCM && bits == 16) w->format = AMWAV_PCM16;
+			else if(tag == AMWAV_TAG_PCM && bits == 24) w->format = AMWAV_PCM24;
+			else if(tag == AMWAV_TAG_PCM && bits == 32) w->format = AMWAV_PCM32;
+			else if(tag == AMWAV_TAG_FLOAT && bits == 32) w->format = AMWAV_FLOAT32;
+			else if(tag == AMWAV_TAG_FLOAT && bits == 64) w->format = AMWAV_FLOAT64;
+			else goto fail;
+			if(w->channels < 1 || w->channels > AMWAV_BUFFER_SAMPLES) goto fail;
+			if(size != 0 && size != 0xffffffffUL) w->length = (long)(size / (unsigned long)(w->channels * amwav_bytesPerSample(w->format)));
+			return 1;
+		}
+		else if(fseek(w->file, (long)(size + (size & 1)), SEEK_CUR)) goto fail;
+	}
+
+fail:
+	fclose(w->file);
+	w->file = NULL;
+	return 0;
+}
+
+long amwav_openRaw(t_amwav *w, const char* path, long channels, long samplerate, long format)
+{
+	amwav_reset(w, 0, channels, samplerate, format);
+	if(channels < 1 || channels > AMWAV_BUFFER_SAMPLES) return 0;
+	w->file = fopen(path, "rb");
+	return w->file != NULL;
+}
+
+long amwav_read(t_amwav *w, double* samples, long frames)
+{
+	unsigned char buffer[AMWAV_BUFFER_SAMPLES * 8];
+	long bytesPerSample = amwav_bytesPerSample(w->format);
+	long maxFrames = AMWAV_BUFFER_SAMPLES / w->channels;
+	long total = 0;
+
+	if(w->length >= 0 && frames > w->length - w->frames) frames = w->length - w->frames;
+	while(frames > 0)
+	{
+		long n = frames < maxFrames ? frames : maxFrames;
+		size_t got = fread(buffer, (size_t)(w->channels * bytesPerSample), (size_t)n, w->file);
+		long count = (long)got * w->channels;
+		for(long i=0; i<count; i++) samples[i] = amwav_decode(w, buffer + i * bytesPerSample);
+		w->frames += (long)got;
+		total += (long)got;
+		samples += count;
+		frames -= (long)got;
+		if((long)got < n) {
+			if(ferror(w->file)) return -1;
+			break;
+		}
+	}
+	return total;
+}
+
+/*
+ * Close a file; one being written is first padded to an even length and has its sizes filled in
+ */
+long amwav_close(t_amwav *w)
+{
+	long ok = 1;
+	if(!w->file) return 0;
+
+	if(w->writing) {
+		if(((unsigned long)w->frames * w->channels * amwav_bytesPerSample(w->format)) & 1) ok = fputc(0, w->file) != EOF;
+		ok = amwav_writeHeader(w) && ok;
+	}
+	ok = fclose(w->file) == 0 && ok;
+	w->file = NULL;
+	return ok;
+}
@@ -0,0 +1,73 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  am.string.wav.h
+//  am.string~
+//
+//  Minimal WAV file streaming for the headless tools: PCM (16, 24 or 32 bit) or float
+//  (32 or 64 bit), up to 8192 channels, read and written a block of frames at a time,
+//  so a file of any length can be processed without holding it in memory. When writing,
+//  the sizes in the header are filled in when the file is closed. Headerless ("raw")
+//  files of any of the formats can be read too.
+//
+
+#ifndef am_string__am_string_wav_h
+#define am_string__am_string_wav_h
+
+#include <stdio.h>
+
+/*
+ * Sample formats
+ */
+enum {
+	AMWAV_PCM16 = 0,
+	AMWAV_PCM24,
+	AMWAV_PCM32,
+	AMWAV_FLOAT32,
+	AMWAV_FLOAT64
+};
+
+typedef struct _amwav
+{
+	FILE* file;
+	long writing;
+	long channels;
+	long samplerate;
+	long format;
+
+	// [ frames read or written so far, and samples clipped to +/-1 when writing a PCM format ]
+	long frames;
+	long clipped;
+
+	// [ when reading: frames in the file (-1 if unknown: read to the end of the file) ]
+	long length;
+} t_amwav;
+
+/*
+ * Each returns 1 on success and 0 on failure (as amstring_simdSelect), except amwav_read,
+ * which returns the number of frames read (0 at the end of the file, -1 on error).
+ * Samples are passed interleaved by channel.
+ */
+long amwav_create(t_amwav *w, const char* path, long channels, long samplerate, long format);
+long amwav_write(t_amwav *w, const double* samples, long frames);
+long amwav_open(t_amwav *w, const char* path);
+long amwav_openRaw(t_amwav *w, const char* path, long channels, long samplerate, long format);
+long amwav_read(t_amwav *w, double* samples, long frames);
+long amwav_close(t_amwav *w);
+
+#endif
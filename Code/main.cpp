@@ -1,16 +1,16 @@
 /*
 	This file is part of am.string~.
- 
+
  am.string~ is free software: you can redistribute it and/or modify
  it under the terms of the GNU General Public License as published by
  the Free Software Foundation, either version 3 of the License, or
  (at your option) any later version.
- 
+
  am.string~ is distributed in the hope that it will be useful,
  but WITHOUT ANY WARRANTY; without even the implied warranty of
  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
  GNU General Public License for more details.
- 
+
  You should have received a copy of the GNU General Public License
  along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
  */
@@ -21,91 +21,549 @@
 //
 //  Created by Aengus Martin on 17/09/13.
 //
+//  Headless benchmark of the am.string~ DSP core (built with AMSTRING_HEADLESS).
+//
+//  Usage: amstring_bench [--quick] [--samples <n>] [--routine <1|2|3|4>] [--interp <0|1|2|3|4>]
+//                       [--controlrate <n>] [--order <1|3|5|7|9>] [--arena <off|on|huge>]
+//         amstring_bench [--order <1|3|5|7|9>] --accuracy
+//
+//  Every combination of perform routine, vector size, period and number of
+//  concurrent instances is timed, and the results are written to stdout as JSON.
+//  dodsp1 is also timed with no input ("dodsp1_silent"), when the strings are asleep,
+//  and through a long decay tail after a single pluck with sleeping turned off
+//  ("dodsp1_tail", timed in segments as the level falls into the subnormal range).
+//  dodsp3 is also timed with its period and gain signals held constant ("dodsp3_constant"),
+//  when it runs with constant coefficients as dodsp1 does.
+//  Routine 4 is am.polystring~, for which "instances" is the number of voices of
+//  a single object (so its ns_per_sample is per voice, comparable with dodsp1).
+//  It is timed with every voice driven by the input ("polystring"), and with no input
+//  and a quarter of the voices playing notes ("polystring_notes"), where the voices
+//  that are not sounding are skipped.
+//  The audio-rate routines (dodsp2/3) are timed in each lagrange coefficient mode (exact,
+//  table, table_linear and farrow), and dodsp1 with the lagrange filter ("exact") and in the
+//  Thiran allpass mode ("thiran"),
+//  with the signal inlets read every sample unless --controlrate sets a sub-block length.
+//  The interpolation kernels are chosen for the host unless AMSTRING_SIMD is set
+//  (to scalar, sse2, avx2 or avx512). The strings have the default interpolation order
+//  unless --order sets another (am.polystring~ always has the default order).
+//  Each string has its own memory block unless --arena (or AMSTRING_ARENA) packs them
+//  into the shared arena of am.string.arena.h, on huge pages with "huge".
+//
+//  --accuracy instead measures the tuning and decay rate of plucked strings at long
+//  periods (see bench_accuracy), for comparing the double and single precision
+//  (amstring_bench_float) builds.
 //
 
-#include <sys/time.h>
-#include <iostream>
-#include "ext.h"
-#include "ext_obex.h"
-#include "z_dsp.h"
-#include "math.h"
-#include "am.string.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "am.string.core.h"
+#include "am.string.lagrange.h"
+#include "am.string.lpf.h"
+#include "am.string.simd.h"
+#include "am.string.arena.h"
 #include "am.string.dsp.h"
+#include "am.polystring.core.h"
+#include "am.polystring.dsp.h"
+
+typedef void (*t_amstring_perform)(t_amstring *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam);
+
+static const long   benchVectorSizes[]     = { 1, 16, 64, 256, 1024, 4096 };
+static const long   benchQuickVectorSizes[] = { 64, 1024 };
+static const double benchPeriods[]         = { MINDELAY, 32.5, 256.25, 2048.75, DEFAULTMAXDELAY };
+static const double benchQuickPeriods[]    = { MINDELAY, 256.25, DEFAULTMAXDELAY };
+static const long   benchInstances[]       = { 1, 8, 64, 512 };
+static const long   benchQuickInstances[]  = { 1, 64 };
+static const long   benchVoices[]          = { 1, 8, 64, AMPOLY_MAXVOICES };
+static const long   benchQuickVoices[]     = { 8, 64 };
+
+#define BENCH_COUNT(a) (sizeof(a)/sizeof((a)[0]))
+#define BENCH_SAMPLERATE 44100.0
+
+#define BENCH_TAIL_SEGMENTS 16
+#define BENCH_TAIL_SEGMENT_LENGTH 8192
+static const double benchTailPeriods[]     = { 32.5, 256.25 };
+static const long   benchTailInstances[]   = { 1, 8 };
+
+#define BENCH_ACCURACY_MAXDELAY 32768
+#define BENCH_ACCURACY_WINDOWS 32
+static const double benchAccuracyPeriods[] = { 100.5, 1000.25, 8000.125, 30000.0625 };
+static const double benchAccuracyGains[]   = { 0.99, MAXFBGAIN };
+
+static long benchOrder = VD_FILTER_ORDER;
+
+/*
+ * Allocate and initialise a string in the same way as amstring_new
+ */
+static t_amstring* bench_newString(t_sample maxDelay)
+{
+    t_amstring *x = (t_amstring *)calloc(1, sizeof(t_amstring));
+    x->maxDelay = maxDelay;
+    amstring_setMemory(x, amstring_newMemory(x->maxDelay));
+    amstring_init(x);
+    if (benchOrder != VD_FILTER_ORDER) amstring_setOrder(x, benchOrder);
+    amstring_calcDcbCoeffs(x, BENCH_SAMPLERATE);
+    return x;
+}
+
+static void bench_freeString(t_amstring *x)
+{
+    amstring_releaseMemory(x);
+    free(x);
+}
+
+/*
+ * Allocate and initialise a polyphonic string in the same way as ampolystring_new
+ */
+static t_ampolystring* bench_newPolyString(long numVoices, t_sample maxDelay)
+{
+    t_ampolystring *x = (t_ampolystring *)calloc(1, sizeof(t_ampolystring));
+    ampolystring_setVoices(x, numVoices, maxDelay);
+    ampolystring_setMemory(x, calloc(1, ampolystring_memorySize(x)));
+    ampolystring_init(x);
+    ampolystring_setSampleRate(x, BENCH_SAMPLERATE);
+    return x;
+}
+
+static void bench_freePolyString(t_ampolystring *x)
+{
+    free(x->memory);
+    free(x);
+}
+
+/*
+ * Fill the input vectors deterministically:
+ * ins[0] is low-level white noise (so the string never decays to silence),
+ * ins[1] is a constant gain and ins[2] is the period with a slight vibrato
+ * (so that the audio-rate routines really do recalculate their coefficients).
+ */
+static void bench_fillInputs(double **ins, long vectorSize, double period)
+{
+    unsigned long seed = 12345;
+    for (long j = 0; j < vectorSize; j++) {
+        seed = seed * 1664525UL + 1013904223UL;
+        ins[0][j] = 0.1 * ((double)(seed & 0xffffff) / (double)0x800000 - 1.0);
+        ins[1][j] = 0.99;
+        ins[2][j] = period * (1.0 + 0.005 * sin(TWOPI * (double)j / 4096.0));
+        if (ins[2][j] < MINDELAY) ins[2][j] = MINDELAY;
+        if (ins[2][j] > DEFAULTMAXDELAY) ins[2][j] = DEFAULTMAXDELAY;
+    }
+}
+
+/*
+ * Time one configuration. Returns the elapsed time in seconds for 'blocks'
+ * vectors processed by each of the instances in turn (as MSP would).
+ */
+static double bench_run(t_amstring_perform perform, std::vector<t_amstring*> &strings, double **ins, double **outs, long vectorSize, long blocks)
+{
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    for (long b = 0; b < blocks; b++) {
+        for (size_t n = 0; n < strings.size(); n++) {
+            perform(strings[n], NULL, ins, 3, outs, 1, vectorSize, 0, NULL);
+        }
+    }
+    std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(t2 - t1).count();
+}
+
+static double bench_runPoly(t_ampolystring *x, double **ins, double **outs, long vectorSize, long blocks)
+{
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    for (long b = 0; b < blocks; b++) {
+        ampolystring_dodsp_64(x, NULL, ins, 1, outs, 1, vectorSize, 0, NULL);
+    }
+    std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(t2 - t1).count();
+}
+
+/*
+ * Pluck a string (with an impulse) and follow one of its partials: harmonic k, the
+ * first at or above 200 Hz (lower partials are taken by the D.C. blocker at long
+ * periods). The output is demodulated at the nominal frequency k/period over successive
+ * Hann windows of four periods; the phase advance from window to window gives the
+ * partial's actual frequency, and so the effective period of the loop, and the change
+ * in magnitude gives its decay rate.
+ *
+ * Writes the effective period minus the requested period (in samples), the resulting
+ * tuning error (in cents) and the decay per period (in dB) of the partial.
+ */
+static void bench_measurePartial(t_amstring_perform perform, double period, double fbgain, double *periodError, double *cents, double *decayDb)
+{
+    t_amstring *x = bench_newString((t_sample)BENCH_ACCURACY_MAXDELAY);
+    amstring_setDelayTime(x, period);
+    amstring_setFbGain(x, fbgain);
+    amstring_setSleep(x, 0.0);
+
+    long harmonic = (long)ceil(200.0 * period / BENCH_SAMPLERATE);
+    double frequency = (double)harmonic / period; // cycles per sample
+    long window = (long)ceil(4.0 * period);
+    long vectorSize = 64;
+    long length = (BENCH_ACCURACY_WINDOWS * window + vectorSize - 1) / vectorSize * vectorSize;
+
+    double *ins[3], *outs[1];
+    for (int i = 0; i < 3; i++) ins[i] = new double[vectorSize];
+    outs[0] = new double[length];
+    for (long j = 0; j < vectorSize; j++) {
+        ins[0][j] = 0.0;
+        ins[1][j] = fbgain;
+        ins[2][j] = period;
+    }
+
+    ins[0][0] = 1.0;
+    for (long j0 = 0; j0 < length; j0 += vectorSize) {
+        double *out = outs[0] + j0;
+        perform(x, NULL, ins, 3, &out, 1, vectorSize, 0, NULL);
+        ins[0][0] = 0.0;
+    }
+
+    double re[BENCH_ACCURACY_WINDOWS], im[BENCH_ACCURACY_WINDOWS];
+    for (long m = 0; m < BENCH_ACCURACY_WINDOWS; m++) {
+        re[m] = im[m] = 0.0;
+        for (long j = 0; j < window; j++) {
+            long n = m * window + j;
+            double w = 0.5 - 0.5 * cos(TWOPI * ((double)j + 0.5) / (double)window);
+            double phase = TWOPI * fmod(frequency * (double)n, 1.0);
+            re[m] += w * outs[0][n] * cos(phase);
+            im[m] -= w * outs[0][n] * sin(phase);
+        }
+    }
+
+    // [ skip the first window, while the pluck's other partials settle ]
+    double advance = 0.0;
+    for (long m = 2; m < BENCH_ACCURACY_WINDOWS; m++) {
+        advance += atan2(im[m] * re[m-1] - re[m] * im[m-1], re[m] * re[m-1] + im[m] * im[m-1]);
+    }
+    advance /= (double)(BENCH_ACCURACY_WINDOWS - 2);
+    double measured = frequency + advance / (TWOPI * (double)window);
+    *periodError = (double)harmonic / measured - period;
+    *cents = 1200.0 * log2(measured / frequency);
+    double first = hypot(re[1], im[1]), last = hypot(re[BENCH_ACCURACY_WINDOWS-1], im[BENCH_ACCURACY_WINDOWS-1]);
+    *decayDb = 20.0 * log10(last / first) * period / ((double)(BENCH_ACCURACY_WINDOWS - 2) * (double)window);
+
+    for (int i = 0; i < 3; i++) delete [] ins[i];
+    delete [] outs[0];
+    bench_freeString(x);
+}
+
+static void bench_accuracy(void)
+{
+    t_amstring_perform performs[2] = { amstring_dodsp1_64, amstring_dodsp2_64 };
+    const char *performNames[2] = { "dodsp1", "dodsp2" };
+    bool first = true;
+
+    printf("{\n");
+    printf("  \"engine\": \"am.string~\",\n");
+    printf("  \"filter_order\": %ld,\n", benchOrder);
+    printf("  \"precision\": \"%s\",\n", sizeof(t_amsample) == sizeof(float) ? "float" : "double");
+    amstring_simdInit();
+    printf("  \"simd\": \"%s\",\n", amstring_simdName());
+    printf("  \"samplerate\": %.1f,\n", BENCH_SAMPLERATE);
+    printf("  \"results\": [");
+    for (int r = 0; r < 2; r++) {
+        for (size_t g = 0; g < BENCH_COUNT(benchAccuracyGains); g++) {
+            for (size_t p = 0; p < BENCH_COUNT(benchAccuracyPeriods); p++) {
+                double periodError, cents, decayDb;
+                bench_measurePartial(performs[r], benchAccuracyPeriods[p], benchAccuracyGains[g], &periodError, &cents, &decayDb);
+                printf("%s\n    { \"routine\": \"%s\", \"period\": %.4f, \"gain\": %.5f, \"harmonic\": %ld, "
+                       "\"period_error\": %.8e, \"cents\": %.8e, \"decay_db_per_period\": %.8e }",
+                       first ? "" : ",", performNames[r], benchAccuracyPeriods[p], benchAccuracyGains[g],
+                       (long)ceil(200.0 * benchAccuracyPeriods[p] / BENCH_SAMPLERATE), periodError, cents, decayDb);
+                first = false;
+                fflush(stdout);
+            }
+        }
+    }
+    printf("\n  ]\n}\n");
+}
 
 int main(int argc, const char * argv[])
 {
-    std::cout << "Running commandline am.string dsp" << std::endl;
-    long vectorSize = 256;
-    
-#ifdef _DEBUG_
-    std::cout << "_DEBUG_ is defined" << std::endl;
-#endif
-    
+    bool quick = false;
+    long samplesPerConfig = 1L << 20;
+    int onlyRoutine = 0;
+    int onlyInterp = -1;
+    long controlBlock = 0;
+
+    for (int a = 1; a < argc; a++) {
+        if (!strcmp(argv[a], "--quick")) {
+            quick = true;
+            samplesPerConfig = 1L << 16;
+        }
+        else if (!strcmp(argv[a], "--samples") && a + 1 < argc) {
+            samplesPerConfig = atol(argv[++a]);
+        }
+        else if (!strcmp(argv[a], "--routine") && a + 1 < argc) {
+            onlyRoutine = atoi(argv[++a]);
+        }
+        else if (!strcmp(argv[a], "--interp") && a + 1 < argc) {
+            onlyInterp = atoi(argv[++a]);
+        }
+        else if (!strcmp(argv[a], "--controlrate") && a + 1 < argc) {
+            controlBlock = atol(argv[++a]);
+        }
+        else if (!strcmp(argv[a], "--order") && a + 1 < argc) {
+            benchOrder = atol(argv[++a]);
+            if (benchOrder < 1 || benchOrder > AMSTRING_MAXORDER || !(benchOrder & 1)) benchOrder = VD_FILTER_ORDER;
+        }
+        else if (!strcmp(argv[a], "--arena") && a + 1 < argc) {
+            a++;
+            amstring_arenaEnable(!strcmp(argv[a], "huge") ? AMSTRING_ARENA_HUGE : !strcmp(argv[a], "on") ? AMSTRING_ARENA_ON : AMSTRING_ARENA_OFF);
+        }
+        else if (!strcmp(argv[a], "--accuracy")) {
+            bench_accuracy();
+            return 0;
+        }
+        else {
+            fprintf(stderr, "usage: %s [--quick] [--samples <n>] [--routine <1|2|3|4>] [--interp <0|1|2|3|4>] [--controlrate <n>] [--order <1|3|5|7|9>] [--arena <off|on|huge>] | --accuracy\n", argv[0]);
+            return 1;
+        }
+    }
+
+    const long *vectorSizes = quick ? benchQuickVectorSizes : benchVectorSizes;
+    size_t numVectorSizes   = quick ? BENCH_COUNT(benchQuickVectorSizes) : BENCH_COUNT(benchVectorSizes);
+    const double *periods   = quick ? benchQuickPeriods : benchPeriods;
+    size_t numPeriods       = quick ? BENCH_COUNT(benchQuickPeriods) : BENCH_COUNT(benchPeriods);
+    const long *instances   = quick ? benchQuickInstances : benchInstances;
+    size_t numInstances     = quick ? BENCH_COUNT(benchQuickInstances) : BENCH_COUNT(benchInstances);
+    const long *voices      = quick ? benchQuickVoices : benchVoices;
+    size_t numVoiceCounts   = quick ? BENCH_COUNT(benchQuickVoices) : BENCH_COUNT(benchVoices);
+
+    t_amstring_perform performs[3] = { amstring_dodsp1_64, amstring_dodsp2_64, amstring_dodsp3_64 };
+    const char *performNames[3] = { "dodsp1", "dodsp2", "dodsp3" };
+    const char *interpNames[AMSTRING_INTERP_NUMMODES] = { "exact", "table", "table_linear", "farrow", "thiran" };
+
     /*
      * Allocate and initialise
      */
-    t_sample **sigin = new t_sample*[3];
-    t_sample **sigout = new t_sample*[1];
-    for (int i = 0; i < 3; i++ ) sigin[i] = new t_sample[vectorSize];
-    sigout[0] = new t_sample[vectorSize];
-    
-    t_amstring* x = new t_amstring;
-    
-    
-    x->maxDelay = 8192.0;
-	x->delayLineLength = (long)x->maxDelay + (long)ceil(VD_FILTER_ORDER/2.0);
-	x->delayLine = new t_sample[x->delayLineLength];
-	x->dlWrite = 0;
-	
-	// [ constant parts of lagrange coefficients ]
-    int n,k;
-	for(n=0; n<=VD_FILTER_ORDER; n++)
-	{
-		x->cc[n] = 1.0;
-		for(k=0; k<=VD_FILTER_ORDER; k++)
-		{
-			if(k!=n) {x->cc[n] = x->cc[n] * 1.0/((t_sample)(n-k));}
-		}
-	}
-    
-    // [ coefficients for D.C. Blocking HPF ]
-    t_sample sr = 44100.0;
-    t_sample hpfcutoff = TWOPI * 20.0 / sr; // High-pass cutoff in radians/sample.
-    x->dcb_a0 = 1.0 / (1.0 + (hpfcutoff/2.0) );
-    x->dcb_a1 = -x->dcb_a0;
-    x->dcb_b1 = x->dcb_a0 * (1.0 - (hpfcutoff/2.0));
-
-    x->previousHpfOutput = 0.0;
-    x->previousHpfInput = 0.0;
-    x->lpf_xnminus1 = 0.0;
-    x->lpf_xnminus2 = 0.0;
-    x->highFreqGain=0.9;
-    
+    long maxVectorSize = vectorSizes[numVectorSizes-1];
+    double *sigin[3];
+    double *sigout[1];
+    for (int i = 0; i < 3; i++) sigin[i] = new double[maxVectorSize];
+    sigout[0] = new double[maxVectorSize];
+
+    printf("{\n");
+    printf("  \"engine\": \"am.string~\",\n");
+    printf("  \"filter_order\": %ld,\n", benchOrder);
+    printf("  \"precision\": \"%s\",\n", sizeof(t_amsample) == sizeof(float) ? "float" : "double");
+    amstring_simdInit();
+    printf("  \"simd\": \"%s\",\n", amstring_simdName());
+    printf("  \"max_delay\": %d,\n", DEFAULTMAXDELAY);
+    printf("  \"arena\": \"%s\",\n", amstring_arenaName());
+    printf("  \"samplerate\": %.1f,\n", BENCH_SAMPLERATE);
+    printf("  \"control_block\": %ld,\n", controlBlock);
+    printf("  \"poly_lanes\": %d,\n", AMPOLY_LANES);
+    printf("  \"lagrange_table\": { \"phases\": %d, \"max_error_table\": %.3e, \"max_error_table_linear\": %.3e, \"max_error_farrow\": %.3e },\n",
+           LAGTABLE_PHASES, amstring_lagTableMaxError(benchOrder, AMSTRING_INTERP_TABLE), amstring_lagTableMaxError(benchOrder, AMSTRING_INTERP_TABLE_LINEAR),
+           amstring_lagTableMaxError(benchOrder, AMSTRING_INTERP_FARROW));
+    printf("  \"lpf_table\": { \"points_per_octave\": %d, \"octaves\": %d, \"max_error\": %.3e },\n", LPFTABLE_POINTS, LPFTABLE_OCTAVES, amstring_lpfTableMaxError());
+    printf("  \"results\": [");
+
+    bool first = true;
+    for (int r = 0; r < 3; r++) {
+        if (onlyRoutine && onlyRoutine != r + 1) continue;
+        // [ dodsp1 always uses the precomputed coefficients, of the lagrange filter or the Thiran allpass (which is exact under audio-rate period) ]
+        for (int interp = 0; interp < AMSTRING_INTERP_NUMMODES; interp++) {
+        if (r == 0 && interp != AMSTRING_INTERP_EXACT && interp != AMSTRING_INTERP_THIRAN) continue;
+        if (r > 0 && interp == AMSTRING_INTERP_THIRAN) continue;
+        if (onlyInterp >= 0 && r > 0 && onlyInterp != interp) continue;
+        for (size_t p = 0; p < numPeriods; p++) {
+            for (size_t n = 0; n < numInstances; n++) {
+                std::vector<t_amstring*> strings;
+                for (long i = 0; i < instances[n]; i++) {
+                    strings.push_back(bench_newString((t_sample)DEFAULTMAXDELAY));
+                    amstring_setDelayTime(strings.back(), periods[p]);
+                    amstring_setInterp(strings.back(), interp);
+                    amstring_setControlBlock(strings.back(), controlBlock);
+                }
+                for (size_t v = 0; v < numVectorSizes; v++) {
+                    long vectorSize = vectorSizes[v];
+                    long blocks = samplesPerConfig / (vectorSize * instances[n]);
+                    if (blocks < 1) blocks = 1;
+
+                    bench_fillInputs(sigin, vectorSize, periods[p]);
+
+                    /*
+                     * Do the DSP (after a short warm-up)
+                     */
+                    bench_run(performs[r], strings, sigin, sigout, vectorSize, blocks / 8 + 1);
+                    double seconds = bench_run(performs[r], strings, sigin, sigout, vectorSize, blocks);
+
+                    double samples = (double)blocks * (double)vectorSize * (double)instances[n];
+                    printf("%s\n    { \"routine\": \"%s\", \"interp\": \"%s\", \"vector_size\": %ld, \"period\": %.2f, \"instances\": %ld, "
+                           "\"samples\": %.0f, \"seconds\": %.6f, \"ns_per_sample\": %.3f, \"samples_per_sec\": %.0f }",
+                           first ? "" : ",", performNames[r], interpNames[interp], vectorSize, periods[p], instances[n],
+                           samples, seconds, 1.0e9 * seconds / samples, samples / seconds);
+                    first = false;
+                    fflush(stdout);
+                }
+                for (size_t i = 0; i < strings.size(); i++) bench_freeString(strings[i]);
+            }
+        }
+        }
+    }
+
     /*
-     * Do the DSP
+     * dodsp1 with silent input: after one period the strings go to sleep
      */
-    
-    double timeTaken;
-    timeval t1, t2;
-    gettimeofday(&t1, NULL);
-    
-    for (int i = 0; i < 1000; i++ ) {
-        amstring_dodsp3_64(x, NULL, sigin, 3, sigout, 1, vectorSize, 0, NULL);
+    if (!onlyRoutine || onlyRoutine == 1) {
+        for (size_t p = 0; p < numPeriods; p++) {
+            for (size_t n = 0; n < numInstances; n++) {
+                std::vector<t_amstring*> strings;
+                for (long i = 0; i < instances[n]; i++) {
+                    strings.push_back(bench_newString((t_sample)DEFAULTMAXDELAY));
+                    amstring_setDelayTime(strings.back(), periods[p]);
+                }
+                for (size_t v = 0; v < numVectorSizes; v++) {
+                    long vectorSize = vectorSizes[v];
+                    long blocks = samplesPerConfig / (vectorSize * instances[n]);
+                    if (blocks < 1) blocks = 1;
+
+                    bench_fillInputs(sigin, vectorSize, periods[p]);
+                    memset(sigin[0], 0, vectorSize * sizeof(double));
+
+                    bench_run(amstring_dodsp1_64, strings, sigin, sigout, vectorSize, (long)(2 * DEFAULTMAXDELAY / vectorSize) + 1);
+                    double seconds = bench_run(amstring_dodsp1_64, strings, sigin, sigout, vectorSize, blocks);
+
+                    double samples = (double)blocks * (double)vectorSize * (double)instances[n];
+                    printf("%s\n    { \"routine\": \"dodsp1_silent\", \"interp\": \"exact\", \"vector_size\": %ld, \"period\": %.2f, \"instances\": %ld, "
+                           "\"samples\": %.0f, \"seconds\": %.6f, \"ns_per_sample\": %.3f, \"samples_per_sec\": %.0f }",
+                           first ? "" : ",", vectorSize, periods[p], instances[n],
+                           samples, seconds, 1.0e9 * seconds / samples, samples / seconds);
+                    first = false;
+                    fflush(stdout);
+                }
+                for (size_t i = 0; i < strings.size(); i++) bench_freeString(strings[i]);
+            }
+        }
     }
-    
-    gettimeofday(&t2, NULL);
-    timeTaken = (t2.tv_sec - t1.tv_sec) * 1000.0;      // sec to ms
-    timeTaken += (t2.tv_usec - t1.tv_usec) / 1000.0;   // us to ms
-    
-    std::cout << "Time taken: " << timeTaken << " milliseconds" << std::endl;
-    
+
+    /*
+     * dodsp3 with the period and gain signals held constant (as by sig~): the vectors run
+     * with constant coefficients, as in dodsp1 (see amstring_constantSignals)
+     */
+    if (!onlyRoutine || onlyRoutine == 3) {
+        for (size_t p = 0; p < numPeriods; p++) {
+            for (size_t n = 0; n < numInstances; n++) {
+                std::vector<t_amstring*> strings;
+                for (long i = 0; i < instances[n]; i++) {
+                    strings.push_back(bench_newString((t_sample)DEFAULTMAXDELAY));
+                    amstring_setControlBlock(strings.back(), controlBlock);
+                }
+                for (size_t v = 0; v < numVectorSizes; v++) {
+                    long vectorSize = vectorSizes[v];
+                    long blocks = samplesPerConfig / (vectorSize * instances[n]);
+                    if (blocks < 1) blocks = 1;
+
+                    bench_fillInputs(sigin, vectorSize, periods[p]);
+                    for (long j = 0; j < vectorSize; j++) sigin[2][j] = periods[p];
+
+                    bench_run(amstring_dodsp3_64, strings, sigin, sigout, vectorSize, blocks / 8 + 1);
+                    double seconds = bench_run(amstring_dodsp3_64, strings, sigin, sigout, vectorSize, blocks);
+
+                    double samples = (double)blocks * (double)vectorSize * (double)instances[n];
+                    printf("%s\n    { \"routine\": \"dodsp3_constant\", \"interp\": \"exact\", \"vector_size\": %ld, \"period\": %.2f, \"instances\": %ld, "
+                           "\"samples\": %.0f, \"seconds\": %.6f, \"ns_per_sample\": %.3f, \"samples_per_sec\": %.0f }",
+                           first ? "" : ",", vectorSize, periods[p], instances[n],
+                           samples, seconds, 1.0e9 * seconds / samples, samples / seconds);
+                    first = false;
+                    fflush(stdout);
+                }
+                for (size_t i = 0; i < strings.size(); i++) bench_freeString(strings[i]);
+            }
+        }
+    }
+
+    /*
+     * dodsp1 through a decay tail: the feedback gain is set so that each string decays
+     * past the smallest normal double (-6000 dB) about halfway through the run
+     */
+    if (!onlyRoutine || onlyRoutine == 1) {
+        long vectorSize = 64;
+        long tailLength = BENCH_TAIL_SEGMENTS * BENCH_TAIL_SEGMENT_LENGTH;
+        for (size_t p = 0; p < BENCH_COUNT(benchTailPeriods); p++) {
+            for (size_t n = 0; n < BENCH_COUNT(benchTailInstances); n++) {
+                std::vector<t_amstring*> strings;
+                for (long i = 0; i < benchTailInstances[n]; i++) {
+                    strings.push_back(bench_newString((t_sample)DEFAULTMAXDELAY));
+                    amstring_setDelayTime(strings.back(), benchTailPeriods[p]);
+                    amstring_setFbGain(strings.back(), pow(10.0, -310.0 * benchTailPeriods[p] / (0.5 * (double)tailLength)));
+                    amstring_setSleep(strings.back(), 0.0);
+                }
+
+                // [ pluck every string with one vector of noise ]
+                bench_fillInputs(sigin, vectorSize, benchTailPeriods[p]);
+                bench_run(amstring_dodsp1_64, strings, sigin, sigout, vectorSize, 1);
+                memset(sigin[0], 0, vectorSize * sizeof(double));
+
+                for (long segment = 0; segment < BENCH_TAIL_SEGMENTS; segment++) {
+                    long blocks = BENCH_TAIL_SEGMENT_LENGTH / vectorSize;
+                    double seconds = bench_run(amstring_dodsp1_64, strings, sigin, sigout, vectorSize, blocks);
+                    double level = 0.0;
+                    for (long j = 0; j < vectorSize; j++) level = fmax(level, fabs(sigout[0][j]));
+
+                    double samples = (double)blocks * (double)vectorSize * (double)benchTailInstances[n];
+                    printf("%s\n    { \"routine\": \"dodsp1_tail\", \"interp\": \"exact\", \"vector_size\": %ld, \"period\": %.2f, \"instances\": %ld, "
+                           "\"tail_segment\": %ld, \"tail_level_db\": %.0f, "
+                           "\"samples\": %.0f, \"seconds\": %.6f, \"ns_per_sample\": %.3f, \"samples_per_sec\": %.0f }",
+                           first ? "" : ",", vectorSize, benchTailPeriods[p], benchTailInstances[n],
+                           segment, level > 0.0 ? 20.0 * log10(level) : -9999.0,
+                           samples, seconds, 1.0e9 * seconds / samples, samples / seconds);
+                    first = false;
+                    fflush(stdout);
+                }
+                for (size_t i = 0; i < strings.size(); i++) bench_freeString(strings[i]);
+            }
+        }
+    }
+
+    /*
+     * am.polystring~: one object with all of the voices at the same period
+     */
+    for (int notes = 0; notes < 2; notes++) {
+        if (onlyRoutine && onlyRoutine != 4) break;
+        for (size_t p = 0; p < numPeriods; p++) {
+            for (size_t n = 0; n < numVoiceCounts; n++) {
+                t_ampolystring *poly = bench_newPolyString(voices[n], (t_sample)DEFAULTMAXDELAY);
+                ampolystring_setDelayTime(poly, 0, periods[p]);
+                if (notes) {
+                    // [ hold a note on a quarter of the voices, sustaining for the whole run ]
+                    ampolystring_setFbGain(poly, 0, MAXFBGAIN);
+                    double pitch = 69.0 + 12.0 * log2(BENCH_SAMPLERATE / (440.0 * periods[p]));
+                    for (long i = 0; i < (voices[n] + 3) / 4; i++) ampolystring_note(poly, pitch + 0.01 * (double)i, 100.0);
+                }
+                for (size_t v = 0; v < numVectorSizes; v++) {
+                    long vectorSize = vectorSizes[v];
+                    long blocks = samplesPerConfig / (vectorSize * voices[n]);
+                    if (blocks < 1) blocks = 1;
+
+                    bench_fillInputs(sigin, vectorSize, periods[p]);
+                    if (notes) memset(sigin[0], 0, vectorSize * sizeof(double));
+
+                    bench_runPoly(poly, sigin, sigout, vectorSize, blocks / 8 + 1);
+                    double seconds = bench_runPoly(poly, sigin, sigout, vectorSize, blocks);
+
+                    double samples = (double)blocks * (double)vectorSize * (double)voices[n];
+                    printf("%s\n    { \"routine\": \"%s\", \"interp\": \"exact\", \"vector_size\": %ld, \"period\": %.2f, \"instances\": %ld, "
+                           "\"samples\": %.0f, \"seconds\": %.6f, \"ns_per_sample\": %.3f, \"samples_per_sec\": %.0f }",
+                           first ? "" : ",", notes ? "polystring_notes" : "polystring", vectorSize, periods[p], voices[n],
+                           samples, seconds, 1.0e9 * seconds / samples, samples / seconds);
+                    first = false;
+                    fflush(stdout);
+                }
+                bench_freePolyString(poly);
+            }
+        }
+    }
+    printf("\n  ]\n}\n");
+
     /*
      * Deallocate stuff at the end
      */
-    delete [] sigin;
-    delete [] sigout;
-    delete [] x;
-    
+    for (int i = 0; i < 3; i++) delete [] sigin[i];
+    delete [] sigout[0];
+
     return 0;
 }
-
@@ -0,0 +1,332 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  render.cpp
+//  am.string~
+//
+//  Offline renderer: renders a score of string events with the DSP core (built with
+//  AMSTRING_HEADLESS) and mixes the voices down to a mono WAV file.
+//
+//  Usage: amstring_render [--threads <n>] [--samplerate <hz>] [--tail <seconds>] [--gain <g>]
+//                         [--order <1|3|5|7|9>] [--format <16|24|float>] <score> <output.wav>
+//
+//  The score is a text file with one event per line ('#' starts a comment):
+//      <time> <voice> <period> <gain> <brightness> <excitation> [<shape>]
+//  time is in seconds, and voice is any non-negative integer naming a string. The event
+//  sets the string's period (in samples), feedback gain and brightness as the 'period',
+//  'gain' and 'brightness' messages do, then, if excitation is not 0, plucks it at that
+//  level with the shape given (see am.string.exciter.h). Events take effect at the exact
+//  sample, in the order they appear for events at the same time.
+//
+//  Each voice is one am.string~, so its events are rendered in sequence, but different
+//  voices are independent: the renderer spreads them over --threads workers (by default
+//  one per core). The score is rendered in segments of RENDER_SEGMENT samples: each
+//  segment's voices are tasks shared out in contiguous runs, one run per worker, and a
+//  worker that runs out steals from the far end of another's run (see am.string.pool.h).
+//  The segment is then mixed, by sample slices shared out in the same way, summing the
+//  voices in order of voice number. So the output is identical whatever the number of
+//  threads, and throughput scales with the number of cores while there are several
+//  voices per core.
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <thread>
+#include <vector>
+#include "am.string.core.h"
+#include "am.string.simd.h"
+#include "am.string.exciter.h"
+#include "am.string.dsp.h"
+#include "am.string.wav.h"
+#include "am.string.pool.h"
+
+#define RENDER_SEGMENT 8192 // samples rendered by every voice before the mix
+#define RENDER_MIXSLICE 512 // samples of a segment mixed by one task
+#define RENDER_VECTOR 64 // largest vector passed to the perform routine
+
+/*
+ * A score event (time converted to samples) and a voice: its string and its events in time order
+ */
+typedef struct _render_event
+{
+    long sample;
+    double period;
+    double gain;
+    double brightness;
+    double excitation;
+    long shape;
+} t_render_event;
+
+typedef struct _render_voice
+{
+    long id;
+    t_amstring *string;
+    std::vector<t_render_event> events;
+    size_t nextEvent;
+    double *buffer; // RENDER_SEGMENT samples of output
+} t_render_voice;
+
+/*
+ * Rendering
+ */
+typedef struct _render_segment
+{
+    std::vector<t_render_voice> *voices;
+    long start;
+    long length;
+    double gain;
+    double *mix;
+} t_render_segment;
+
+static double renderSilence[RENDER_VECTOR]; // the signal inputs (all excitation is by 'pluck')
+
+static void render_applyEvent(t_amstring *x, const t_render_event *e)
+{
+    amstring_setDelayTime(x, e->period);
+    amstring_setFbGain(x, e->gain);
+    amstring_setBrightness(x, e->brightness);
+    if (e->excitation != 0.0) amstring_pluck(x, e->excitation, e->shape);
+}
+
+/*
+ * Render one voice through the segment, splitting its vectors at its events
+ */
+static void render_voiceTask(void *context, long task)
+{
+    t_render_segment *s = (t_render_segment *)context;
+    t_render_voice *v = &(*s->voices)[task];
+    double *ins[3] = { renderSilence, renderSilence, renderSilence };
+    long end = s->start + s->length;
+
+    for (long pos = s->start; pos < end; ) {
+        while (v->nextEvent < v->events.size() && v->events[v->nextEvent].sample <= pos) {
+            render_applyEvent(v->string, &v->events[v->nextEvent++]);
+        }
+        long n = end - pos < RENDER_VECTOR ? end - pos : RENDER_VECTOR;
+        if (v->nextEvent < v->events.size() && v->events[v->nextEvent].sample - pos < n) n = v->events[v->nextEvent].sample - pos;
+
+        double *outs[1] = { v->buffer + (pos - s->start) };
+        amstring_dodsp1_64(v->string, NULL, ins, 3, outs, 1, n, 0, NULL);
+        pos += n;
+    }
+}
+
+/*
+ * Mix one slice of the segment, adding the voices in order
+ */
+static void render_mixTask(void *context, long task)
+{
+    t_render_segment *s = (t_render_segment *)context;
+    long j0 = task * RENDER_MIXSLICE;
+    long j1 = j0 + RENDER_MIXSLICE < s->length ? j0 + RENDER_MIXSLICE : s->length;
+
+    for (long j = j0; j < j1; j++) s->mix[j] = 0.0;
+    for (size_t v = 0; v < s->voices->size(); v++) {
+        const double *buffer = (*s->voices)[v].buffer;
+        for (long j = j0; j < j1; j++) s->mix[j] += buffer[j];
+    }
+    for (long j = j0; j < j1; j++) s->mix[j] *= s->gain;
+}
+
+/*
+ * Read the score into voices (in order of voice number). Returns 0 on error.
+ */
+static long render_readScore(const char *path, double samplerate, std::vector<t_render_voice> *voices, long *lastSample)
+{
+    FILE *f = fopen(path, "r");
+    char line[1024];
+    long lineNumber = 0;
+    std::map<long, std::vector<t_render_event> > parts;
+
+    if (!f) {
+        fprintf(stderr, "cannot open score %s\n", path);
+        return 0;
+    }
+    *lastSample = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineNumber++;
+        char *comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+
+        double time;
+        long voice;
+        t_render_event e;
+        e.shape = AMSTRING_PLUCK_NOISE;
+        int fields = sscanf(line, "%lf %ld %lf %lf %lf %lf %ld", &time, &voice, &e.period, &e.gain, &e.brightness, &e.excitation, &e.shape);
+        if (fields <= 0) continue;
+        if (fields < 6 || time < 0.0 || voice < 0) {
+            fprintf(stderr, "%s:%ld: expected <time> <voice> <period> <gain> <brightness> <excitation> [<shape>]\n", path, lineNumber);
+            fclose(f);
+            return 0;
+        }
+        e.sample = lrint(time * samplerate);
+        if (e.sample > *lastSample) *lastSample = e.sample;
+        parts[voice].push_back(e);
+    }
+    fclose(f);
+
+    for (std::map<long, std::vector<t_render_event> >::iterator p = parts.begin(); p != parts.end(); ++p) {
+        t_render_voice v;
+        v.id = p->first;
+        v.events = p->second;
+        std::stable_sort(v.events.begin(), v.events.end(), [](const t_render_event &a, const t_render_event &b) { return a.sample < b.sample; });
+        v.nextEvent = 0;
+        v.string = NULL;
+        v.buffer = NULL;
+        voices->push_back(v);
+    }
+    return 1;
+}
+
+/*
+ * Allocate and initialise a voice's string in the same way as amstring_new, long enough for its longest period
+ */
+static void render_newString(t_render_voice *v, double samplerate, long order)
+{
+    t_sample maxDelay = (t_sample)DEFAULTMAXDELAY;
+    for (size_t i = 0; i < v->events.size(); i++) {
+        if (v->events[i].period > maxDelay) maxDelay = (t_sample)ceil(v->events[i].period);
+    }
+    t_amstring *x = (t_amstring *)calloc(1, sizeof(t_amstring));
+    x->maxDelay = maxDelay;
+    amstring_setMemory(x, amstring_newMemory(x->maxDelay));
+    amstring_init(x);
+    if (order != VD_FILTER_ORDER) amstring_setOrder(x, order);
+    amstring_calcDcbCoeffs(x, samplerate);
+    v->string = x;
+    v->buffer = new double[RENDER_SEGMENT];
+}
+
+static void render_freeString(t_render_voice *v)
+{
+    amstring_releaseMemory(v->string);
+    free(v->string);
+    delete [] v->buffer;
+}
+
+int main(int argc, const char * argv[])
+{
+    long numThreads = (long)std::thread::hardware_concurrency();
+    double samplerate = 44100.0;
+    double tail = 4.0;
+    double gain = 1.0;
+    long order = VD_FILTER_ORDER;
+    long format = AMWAV_FLOAT32;
+    const char *scorePath = NULL;
+    const char *outPath = NULL;
+
+    for (int a = 1; a < argc; a++) {
+        if (!strcmp(argv[a], "--threads") && a + 1 < argc) {
+            numThreads = atol(argv[++a]);
+        }
+        else if (!strcmp(argv[a], "--samplerate") && a + 1 < argc) {
+            samplerate = atof(argv[++a]);
+        }
+        else if (!strcmp(argv[a], "--tail") && a + 1 < argc) {
+            tail = atof(argv[++a]);
+        }
+        else if (!strcmp(argv[a], "--gain") && a + 1 < argc) {
+            gain = atof(argv[++a]);
+        }
+        else if (!strcmp(argv[a], "--order") && a + 1 < argc) {
+            order = atol(argv[++a]);
+            if (order < 1 || order > AMSTRING_MAXORDER || !(order & 1)) order = VD_FILTER_ORDER;
+        }
+        else if (!strcmp(argv[a], "--format") && a + 1 < argc) {
+            a++;
+            format = !strcmp(argv[a], "16") ? AMWAV_PCM16 : (!strcmp(argv[a], "24") ? AMWAV_PCM24 : AMWAV_FLOAT32);
+        }
+        else if (argv[a][0] != '-' && !scorePath) {
+            scorePath = argv[a];
+        }
+        else if (argv[a][0] != '-' && !outPath) {
+            outPath = argv[a];
+        }
+        else {
+            scorePath = NULL;
+            break;
+        }
+    }
+    if (!scorePath || !outPath || samplerate < 1.0 || tail < 0.0) {
+        fprintf(stderr, "usage: %s [--threads <n>] [--samplerate <hz>] [--tail <seconds>] [--gain <g>] [--order <1|3|5|7|9>] [--format <16|24|float>] <score> <output.wav>\n", argv[0]);
+        return 1;
+    }
+    if (numThreads < 1) numThreads = 1;
+
+    /*
+     * Read the score and set up the strings (on this thread, so that the shared tables are built before rendering starts)
+     */
+    std::vector<t_render_voice> voices;
+    long lastSample;
+    if (!render_readScore(scorePath, samplerate, &voices, &lastSample)) return 1;
+    for (size_t v = 0; v < voices.size(); v++) render_newString(&voices[v], samplerate, order);
+    long totalSamples = lastSample + lrint(tail * samplerate);
+
+    t_amwav wav;
+    if (!amwav_create(&wav, outPath, 1, lrint(samplerate), format)) {
+        fprintf(stderr, "cannot create %s\n", outPath);
+        return 1;
+    }
+
+    /*
+     * Render segment by segment
+     */
+    t_ampool pool;
+    ampool_start(&pool, numThreads);
+    double *mix = new double[RENDER_SEGMENT];
+    double peak = 0.0;
+    long ok = 1;
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+    for (long start = 0; start < totalSamples && ok; start += RENDER_SEGMENT) {
+        t_render_segment s;
+        s.voices = &voices;
+        s.start = start;
+        s.length = totalSamples - start < RENDER_SEGMENT ? totalSamples - start : RENDER_SEGMENT;
+        s.gain = gain;
+        s.mix = mix;
+        ampool_run(&pool, (long)voices.size(), render_voiceTask, &s);
+        if (voices.empty()) memset(mix, 0, s.length * sizeof(double));
+        else ampool_run(&pool, (s.length + RENDER_MIXSLICE - 1) / RENDER_MIXSLICE, render_mixTask, &s);
+
+        for (long j = 0; j < s.length; j++) peak = fmax(peak, fabs(mix[j]));
+        ok = amwav_write(&wav, mix, s.length);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    ampool_stop(&pool);
+    ok = amwav_close(&wav) && ok;
+    delete [] mix;
+    for (size_t v = 0; v < voices.size(); v++) render_freeString(&voices[v]);
+
+    if (!ok) {
+        fprintf(stderr, "error writing %s\n", outPath);
+        return 1;
+    }
+    fprintf(stderr, "%s: %ld voices, %.2f s of audio in %.2f s with %ld threads (%s kernels): %.1fx real time, %.0f voice samples/s\n",
+            outPath, (long)voices.size(), (double)totalSamples / samplerate, seconds, numThreads, amstring_simdName(),
+            (double)totalSamples / samplerate / seconds, (double)totalSamples * (double)voices.size() / seconds);
+    fprintf(stderr, "peak level %.2f dB%s\n", peak > 0.0 ? 20.0 * log10(peak) : -9999.0,
+            wav.clipped ? " (clipped: lower --gain or use --format float)" : "");
+    return 0;
+}
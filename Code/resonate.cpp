@@ -0,0 +1,344 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  resonate.cpp
+//  am.string~
+//
+//  Streaming file processor: runs a sound file through the DSP core (built with
+//  AMSTRING_HEADLESS), with a string per channel acting as a resonator, as am.string~
+//  does in Max with a signal in its left inlet.
+//
+//  Usage: amstring_resonate [--period <samples>] [--gain <g>] [--brightness <b>] [--input <g>]
+//                           [--control <file>] [--interp <0|1|2|3|4>] [--controlrate <n>]
+//                           [--order <1|3|5|7|9>] [--tail <seconds>] [--threads <n>]
+//                           [--format <16|24|32|float|double>]
+//                           [--raw <channels> <samplerate> <16|24|32|float|double>]
+//                           <input> <output.wav>
+//
+//  The input is a WAV file, or with --raw a headerless file of interleaved samples. It is
+//  scaled by the --input gain and fed to the strings, whose period, feedback gain and
+//  brightness are set as by the messages of those names. With --control, the period and
+//  gain instead follow a control file of breakpoints, one per line ('#' starts a comment),
+//      <time> <period> <gain>
+//  (time in seconds, interpolated linearly between breakpoints and held before the first
+//  and after the last), given to the strings as signals, as to the right and middle inlets
+//  (so --interp and --controlrate apply). --tail carries on for a time after the input ends,
+//  with silent input, to let the strings ring out.
+//
+//  The file is streamed through in chunks of RESONATE_CHUNK frames, so memory use does not
+//  depend on its length. The channels of each chunk are processed in parallel (a task per
+//  channel, see am.string.pool.h), and the output does not depend on the number of threads.
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "am.string.core.h"
+#include "am.string.simd.h"
+#include "am.string.dsp.h"
+#include "am.string.wav.h"
+#include "am.string.pool.h"
+
+#define RESONATE_CHUNK 16384 // frames read, processed and written at a time
+#define RESONATE_VECTOR 256 // largest vector passed to the perform routine
+
+typedef struct _resonate_breakpoint
+{
+    double time;
+    double period;
+    double gain;
+} t_resonate_breakpoint;
+
+/*
+ * The state shared by the channel tasks of a chunk
+ */
+typedef struct _resonate_chunk
+{
+    std::vector<t_amstring*> *strings;
+    double **in;      // per channel, RESONATE_CHUNK frames
+    double **out;     // per channel, RESONATE_CHUNK frames
+    double *gain;     // per frame, when there is a control file
+    double *period;   // per frame, when there is a control file
+    long frames;
+} t_resonate_chunk;
+
+static void resonate_channelTask(void *context, long task)
+{
+    t_resonate_chunk *c = (t_resonate_chunk *)context;
+    t_amstring *x = (*c->strings)[task];
+
+    for (long j = 0; j < c->frames; j += RESONATE_VECTOR) {
+        long n = c->frames - j < RESONATE_VECTOR ? c->frames - j : RESONATE_VECTOR;
+        double *outs[1] = { c->out[task] + j };
+        if (c->period) {
+            double *ins[3] = { c->in[task] + j, c->gain + j, c->period + j };
+            amstring_dodsp3_64(x, NULL, ins, 3, outs, 1, n, 0, NULL);
+        }
+        else {
+            double *ins[3] = { c->in[task] + j, c->in[task] + j, c->in[task] + j };
+            amstring_dodsp1_64(x, NULL, ins, 3, outs, 1, n, 0, NULL);
+        }
+    }
+}
+
+/*
+ * Read the control file. Returns 0 on error.
+ */
+static long resonate_readControl(const char *path, std::vector<t_resonate_breakpoint> *breakpoints)
+{
+    FILE *f = fopen(path, "r");
+    char line[1024];
+    long lineNumber = 0;
+
+    if (!f) {
+        fprintf(stderr, "cannot open control file %s\n", path);
+        return 0;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        lineNumber++;
+        char *comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+
+        t_resonate_breakpoint b;
+        int fields = sscanf(line, "%lf %lf %lf", &b.time, &b.period, &b.gain);
+        if (fields <= 0) continue;
+        if (fields < 3) {
+            fprintf(stderr, "%s:%ld: expected <time> <period> <gain>\n", path, lineNumber);
+            fclose(f);
+            return 0;
+        }
+        breakpoints->push_back(b);
+    }
+    fclose(f);
+    std::stable_sort(breakpoints->begin(), breakpoints->end(), [](const t_resonate_breakpoint &a, const t_resonate_breakpoint &b) { return a.time < b.time; });
+    if (breakpoints->empty()) {
+        fprintf(stderr, "%s: no breakpoints\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+/*
+ * Fill the control signals for frames [start, start+frames), moving *next on through the breakpoints
+ */
+static void resonate_fillControl(const std::vector<t_resonate_breakpoint> &b, size_t *next, double samplerate, long start, long frames, double *period, double *gain)
+{
+    for (long j = 0; j < frames; j++) {
+        double t = (double)(start + j) / samplerate;
+        while (*next < b.size() && b[*next].time <= t) (*next)++;
+        if (*next == 0) {
+            period[j] = b[0].period;
+            gain[j] = b[0].gain;
+        }
+        else if (*next == b.size()) {
+            period[j] = b.back().period;
+            gain[j] = b.back().gain;
+        }
+        else {
+            const t_resonate_breakpoint &p = b[*next - 1], &q = b[*next];
+            double w = (t - p.time) / (q.time - p.time);
+            period[j] = p.period + w * (q.period - p.period);
+            gain[j] = p.gain + w * (q.gain - p.gain);
+        }
+    }
+}
+
+static long resonate_parseFormat(const char *s)
+{
+    if (!strcmp(s, "16")) return AMWAV_PCM16;
+    if (!strcmp(s, "24")) return AMWAV_PCM24;
+    if (!strcmp(s, "32")) return AMWAV_PCM32;
+    if (!strcmp(s, "double")) return AMWAV_FLOAT64;
+    return AMWAV_FLOAT32;
+}
+
+int main(int argc, const char * argv[])
+{
+    double period = 100.0;
+    double gain = 0.99;
+    double brightness = 0.9;
+    double inputGain = 1.0;
+    double tail = 0.0;
+    long interp = AMSTRING_INTERP_EXACT;
+    long controlBlock = 0;
+    long order = VD_FILTER_ORDER;
+    long numThreads = (long)std::thread::hardware_concurrency();
+    long format = AMWAV_FLOAT32;
+    long rawChannels = 0, rawSamplerate = 0, rawFormat = AMWAV_FLOAT32;
+    const char *controlPath = NULL;
+    const char *inPath = NULL;
+    const char *outPath = NULL;
+    bool usage = false;
+
+    for (int a = 1; a < argc && !usage; a++) {
+        if (!strcmp(argv[a], "--period") && a + 1 < argc) period = atof(argv[++a]);
+        else if (!strcmp(argv[a], "--gain") && a + 1 < argc) gain = atof(argv[++a]);
+        else if (!strcmp(argv[a], "--brightness") && a + 1 < argc) brightness = atof(argv[++a]);
+        else if (!strcmp(argv[a], "--input") && a + 1 < argc) inputGain = atof(argv[++a]);
+        else if (!strcmp(argv[a], "--control") && a + 1 < argc) controlPath = argv[++a];
+        else if (!strcmp(argv[a], "--interp") && a + 1 < argc) interp = atol(argv[++a]);
+        else if (!strcmp(argv[a], "--controlrate") && a + 1 < argc) controlBlock = atol(argv[++a]);
+        else if (!strcmp(argv[a], "--order") && a + 1 < argc) order = atol(argv[++a]);
+        else if (!strcmp(argv[a], "--tail") && a + 1 < argc) tail = atof(argv[++a]);
+        else if (!strcmp(argv[a], "--threads") && a + 1 < argc) numThreads = atol(argv[++a]);
+        else if (!strcmp(argv[a], "--format") && a + 1 < argc) format = resonate_parseFormat(argv[++a]);
+        else if (!strcmp(argv[a], "--raw") && a + 3 < argc) {
+            rawChannels = atol(argv[++a]);
+            rawSamplerate = atol(argv[++a]);
+            rawFormat = resonate_parseFormat(argv[++a]);
+            if (rawChannels < 1 || rawSamplerate < 1) usage = true;
+        }
+        else if (argv[a][0] != '-' && !inPath) inPath = argv[a];
+        else if (argv[a][0] != '-' && !outPath) outPath = argv[a];
+        else usage = true;
+    }
+    if (usage || !inPath || !outPath || tail < 0.0) {
+        fprintf(stderr, "usage: %s [--period <samples>] [--gain <g>] [--brightness <b>] [--input <g>] [--control <file>] [--interp <0|1|2|3|4>] "
+                "[--controlrate <n>] [--order <1|3|5|7|9>] [--tail <seconds>] [--threads <n>] [--format <16|24|32|float|double>] "
+                "[--raw <channels> <samplerate> <16|24|32|float|double>] <input> <output.wav>\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<t_resonate_breakpoint> breakpoints;
+    if (controlPath && !resonate_readControl(controlPath, &breakpoints)) return 1;
+
+    t_amwav in, out;
+    if (!(rawChannels ? amwav_openRaw(&in, inPath, rawChannels, rawSamplerate, rawFormat) : amwav_open(&in, inPath))) {
+        fprintf(stderr, "cannot read %s (a WAV file of 16, 24 or 32-bit PCM or 32 or 64-bit float is needed, or --raw)\n", inPath);
+        return 1;
+    }
+    if (!amwav_create(&out, outPath, in.channels, in.samplerate, format)) {
+        fprintf(stderr, "cannot create %s\n", outPath);
+        amwav_close(&in);
+        return 1;
+    }
+    long channels = in.channels;
+    double samplerate = (double)in.samplerate;
+
+    /*
+     * A string per channel, set up as amstring_new does, long enough for the longest period
+     */
+    t_sample maxDelay = (t_sample)DEFAULTMAXDELAY;
+    if (period > maxDelay) maxDelay = (t_sample)ceil(period);
+    for (size_t i = 0; i < breakpoints.size(); i++) {
+        if (breakpoints[i].period > maxDelay) maxDelay = (t_sample)ceil(breakpoints[i].period);
+    }
+    std::vector<t_amstring*> strings;
+    for (long c = 0; c < channels; c++) {
+        t_amstring *x = (t_amstring *)calloc(1, sizeof(t_amstring));
+        x->maxDelay = maxDelay;
+        amstring_setMemory(x, amstring_newMemory(x->maxDelay));
+        amstring_init(x);
+        if (order != VD_FILTER_ORDER) amstring_setOrder(x, order);
+        amstring_calcDcbCoeffs(x, samplerate);
+        amstring_setDelayTime(x, period);
+        amstring_setFbGain(x, gain);
+        amstring_setBrightness(x, brightness);
+        amstring_setInterp(x, interp);
+        amstring_setControlBlock(x, controlBlock);
+        strings.push_back(x);
+    }
+
+    /*
+     * Buffers for one chunk
+     */
+    double *interleaved = new double[RESONATE_CHUNK * channels];
+    std::vector<double*> inBuffers, outBuffers;
+    for (long c = 0; c < channels; c++) {
+        inBuffers.push_back(new double[RESONATE_CHUNK]);
+        outBuffers.push_back(new double[RESONATE_CHUNK]);
+    }
+    double *controlPeriod = controlPath ? new double[RESONATE_CHUNK] : NULL;
+    double *controlGain = controlPath ? new double[RESONATE_CHUNK] : NULL;
+    size_t nextBreakpoint = 0;
+
+    t_ampool pool;
+    ampool_start(&pool, numThreads < channels ? numThreads : channels);
+    long tailFrames = lrint(tail * samplerate);
+    double peak = 0.0;
+    long ok = 1;
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+    for (;;) {
+        long frames = amwav_read(&in, interleaved, RESONATE_CHUNK);
+        if (frames < 0) {
+            fprintf(stderr, "error reading %s\n", inPath);
+            ok = 0;
+            break;
+        }
+        if (frames == 0) {
+            // [ after the input: the tail, with silent input ]
+            frames = tailFrames < RESONATE_CHUNK ? tailFrames : RESONATE_CHUNK;
+            if (frames == 0) break;
+            tailFrames -= frames;
+            memset(interleaved, 0, frames * channels * sizeof(double));
+        }
+
+        for (long c = 0; c < channels; c++) {
+            for (long j = 0; j < frames; j++) inBuffers[c][j] = inputGain * interleaved[j * channels + c];
+        }
+        if (controlPath) resonate_fillControl(breakpoints, &nextBreakpoint, samplerate, out.frames, frames, controlPeriod, controlGain);
+
+        t_resonate_chunk chunk;
+        chunk.strings = &strings;
+        chunk.in = &inBuffers[0];
+        chunk.out = &outBuffers[0];
+        chunk.period = controlPeriod;
+        chunk.gain = controlGain;
+        chunk.frames = frames;
+        ampool_run(&pool, channels, resonate_channelTask, &chunk);
+
+        for (long c = 0; c < channels; c++) {
+            for (long j = 0; j < frames; j++) {
+                interleaved[j * channels + c] = outBuffers[c][j];
+                peak = fmax(peak, fabs(outBuffers[c][j]));
+            }
+        }
+        if (!amwav_write(&out, interleaved, frames)) {
+            fprintf(stderr, "error writing %s\n", outPath);
+            ok = 0;
+            break;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    ampool_stop(&pool);
+    amwav_close(&in);
+    ok = amwav_close(&out) && ok;
+
+    fprintf(stderr, "%s: %ld channels, %.2f s of audio in %.2f s (%s kernels): %.1fx real time\n",
+            outPath, channels, (double)out.frames / samplerate, seconds, amstring_simdName(), (double)out.frames / samplerate / seconds);
+    fprintf(stderr, "peak level %.2f dB%s\n", peak > 0.0 ? 20.0 * log10(peak) : -9999.0,
+            out.clipped ? " (clipped: lower --input or use --format float)" : "");
+
+    for (long c = 0; c < channels; c++) {
+        amstring_releaseMemory(strings[c]);
+        free(strings[c]);
+        delete [] inBuffers[c];
+        delete [] outBuffers[c];
+    }
+    delete [] interleaved;
+    delete [] controlPeriod;
+    delete [] controlGain;
+    return ok ? 0 : 1;
+}
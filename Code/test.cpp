@@ -0,0 +1,831 @@
+/*
+	This file is part of am.string~.
+
+ am.string~ is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ am.string~ is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with am.string~.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+//  test.cpp
+//  am.string~
+//
+//  Golden-output regression and accuracy tests of the DSP core (built with
+//  AMSTRING_HEADLESS), run by ctest.
+//
+//  Usage: amstring_test [--quick] [--order <1|3|5|7|9>] [--record <file>] [--golden <file>]
+//
+//  Each case renders a string through a perform routine (amstring_dodsp1/2/3_64) and
+//  through a plain reference implementation of the same model, written here from its
+//  equations: one sample at a time, with the exact lagrange and LPF coefficients, and no
+//  guard zone, tables or SIMD. The two renders are compared by
+//    - the largest absolute difference (the outputs peak at about 1),
+//    - the signal-to-error ratio (SNR, in dB),
+//    - the pitch error (in cents) and the T60 decay time error (relative), measured on the
+//      fundamental by demodulation over successive windows (for a constant period only).
+//  There are four groups of cases:
+//    golden:     a matrix of periods, gains, brightness values, excitations (an impulse,
+//                a noise burst and the built-in pluck) and vector sizes, through each
+//                routine as a patch would use it: dodsp1, and dodsp2/3 with their signals
+//                held or with vibrato, on the host's interpolation kernels;
+//    candidate:  every interpolation kernel set the host has (see am.string.simd.h) in
+//                every lagrange coefficient mode, with and without control-rate updates,
+//                at a few periods, with a period signal that keeps them on the per-sample
+//                path (held but for a 1e-9 sample dither) or with vibrato;
+//    response:   the coefficients of each mode, including the LPF table of the table modes,
+//                against the exact ones over a dense sweep of periods, by the response of
+//                the loop at the fundamental: the pitch error from the change in its phase
+//                delay, and the T60 error from the change in its gain;
+//    polystring: one voice of am.polystring~ on each kernel set, against am.string~ at the
+//                build's default order (whose kernels a voice shares) with the same settings,
+//                sample for sample.
+//  Each result is checked against the tolerances of its mode (testTolerances). Results are
+//  written to stdout as JSON, with the time per sample of each render, so the candidates'
+//  precision and speed can be compared. Failures are also listed on stderr, and make the
+//  exit status 1.
+//
+//  --record writes the golden renders to a file, and --golden compares the golden renders
+//  with a file written earlier, to the exact mode's tolerances. Record with the build before
+//  a change to the perform routines, and check with the build after it, to show that the
+//  change leaves the sound alone. (--quick and --order must be the same for both.)
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <chrono>
+#include <complex>
+#include <vector>
+#include "am.string.core.h"
+#include "am.string.lagrange.h"
+#include "am.string.lpf.h"
+#include "am.string.simd.h"
+#include "am.string.exciter.h"
+#include "am.string.dsp.h"
+#include "am.polystring.core.h"
+#include "am.polystring.dsp.h"
+
+typedef void (*t_amstring_perform)(t_amstring *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam);
+
+#define TEST_COUNT(a) (sizeof(a)/sizeof((a)[0]))
+#define TEST_SAMPLERATE 44100.0
+#define TEST_MAXDELAY DEFAULTMAXDELAY
+#define TEST_MINLENGTH 16384        // samples rendered at least
+#define TEST_WINDOWS 10             // windows of four periods for measuring the fundamental
+#define TEST_VIBRATO 0.005          // depth of the vibrato (relative to the period)
+#define TEST_VIBRATO_CYCLE 4096.0   // and its cycle, in samples
+#define TEST_DITHER 1.0e-9          // added to every other sample of a held period signal in the candidate cases
+#define TEST_THIRAN_HISTORY 4096   // samples the reference runs a new Thiran allpass over (see test_reference)
+#define TEST_STEP 1024              // samples between the period messages of a stepped dodsp1 case
+#define TEST_STEP_SIZE 0.01         // by which they raise the period (relative), three times over and back again
+#define TEST_CANDIDATE_GAIN 0.999
+#define TEST_CANDIDATE_BRIGHTNESS 0.5
+#define TEST_RESPONSE_MIN 16.0      // the shortest period of the response sweeps
+#define TEST_SNR_IDENTICAL 400.0    // the SNR reported for identical renders
+#define TEST_MEASURABLE_HZ 40.0     // the lowest fundamental whose pitch and T60 are measured (twice the D.C. blocker's cutoff)
+#define TEST_MEASURABLE_DB -60.0    // and the most it can decay over the windows
+#define TEST_GOLDEN_MAGIC "AMSTRGLD"
+
+static const double testGains[]             = { 0.9, 0.999, MAXFBGAIN };
+static const double testQuickGains[]        = { 0.9, MAXFBGAIN };
+static const double testBrightness[]        = { 0.0, 0.5, 1.0 };
+static const double testQuickBrightness[]   = { 0.0, 1.0 };
+static const long   testVectorSizes[]       = { 64, 1, 1000, 4096 };
+
+// [ periods: the first of the matrix is relative to MINDELAY, a sample above it (below that the integer part of the
+//   delay is 0, and its most recent tap reads the slot about to be written, which a high order filter does not survive) ]
+static const double testPeriods[]           = { 1.37, 37.3, 256.25, 2048.75, 8000.5 };
+static const double testQuickPeriods[]      = { 1.37, 37.3, 256.25, 2048.75 };
+// [ candidate periods: through dodsp1, the first runs the constant-period loop sample by sample, the second in sub-blocks
+//   shorter than the vector, and the others in sub-blocks of the whole vector (see amstring_dodspConstant) ]
+static const double testCandidatePeriods[]  = { 16.37, 37.3, 256.25, 2048.75 };
+
+enum { TEST_IMPULSE = 0, TEST_NOISE, TEST_PLUCK, TEST_NUMEXCITATIONS };
+static const char *testExcitationNames[TEST_NUMEXCITATIONS] = { "impulse", "noise", "pluck" };
+
+// [ how the period (and gain) signals of dodsp2/3 move, or (held or stepped) the period messages of dodsp1 ]
+enum { TEST_HELD = 0, TEST_DITHERED, TEST_VIBRATO_SIGNAL, TEST_STEPPED };
+static const char *testSignalNames[] = { "held", "dithered", "vibrato", "stepped" };
+
+static const char *testRoutineNames[] = { "", "dodsp1", "dodsp2", "dodsp3", "polystring" };
+static const t_amstring_perform testPerforms[] = { NULL, amstring_dodsp1_64, amstring_dodsp2_64, amstring_dodsp3_64 };
+static const char *testInterpNames[AMSTRING_INTERP_NUMMODES] = { "exact", "table", "table_linear", "farrow", "thiran" };
+static const char *testSimdNames[] = { "scalar", "sse2", "avx2", "avx512" };
+
+/*
+ * The agreed tolerances of each lagrange coefficient mode, and of control-rate updates (which
+ * ramp the coefficients between the ends of sub-blocks, and so differ from the reference by
+ * more than any mode under vibrato). A render passes if it is within all four; a response
+ * sweep checks the pitch and T60 errors only. Each is about ten times the worst measured
+ * here at any order (or, for the pitch and T60 of the exact modes, the noise of the
+ * measurement itself). The thiran mode is held to those of the exact mode: the renders are
+ * compared with a Thiran allpass run in double precision, and so is its response (see
+ * test_response). The allpass's own pitch error against an ideal delay is not a tolerance but
+ * a property of the filter: 0.086 cents at a period of 16, falling about thirty times an octave.
+ */
+typedef struct _test_tolerance
+{
+    double maxAbsError;     // largest absolute difference from the reference
+    double minSnrDb;        // smallest signal-to-error ratio
+    double maxCents;        // largest pitch error
+    double maxT60Error;     // largest relative error in the T60 decay time
+} t_test_tolerance;
+
+#ifdef AMSTRING_FLOAT
+static const t_test_tolerance testTolerances[AMSTRING_INTERP_NUMMODES] = {
+    { 2.0e-3,  55.0,  3.0e-3, 3.0e-2 },    // exact
+    { 3.0e-2,  25.0,  0.5,    0.3    },    // table (nearest)
+    { 2.0e-3,  55.0,  3.0e-3, 3.0e-2 },    // table (linear)
+    { 2.0e-3,  55.0,  3.0e-3, 3.0e-2 },    // farrow
+    { 2.0e-3,  55.0,  3.0e-3, 3.0e-2 },    // thiran
+};
+#else
+static const t_test_tolerance testTolerances[AMSTRING_INTERP_NUMMODES] = {
+    { 1.0e-11, 200.0, 1.0e-8, 1.0e-8 },    // exact
+    { 3.0e-2,  25.0,  0.5,    0.3    },    // table (nearest)
+    { 1.0e-5,  90.0,  1.0e-6, 2.0e-3 },    // table (linear)
+    { 1.0e-11, 200.0, 1.0e-8, 1.0e-8 },    // farrow
+    { 1.0e-11, 200.0, 1.0e-8, 1.0e-8 },    // thiran
+};
+#endif
+static const t_test_tolerance testControlRateTolerance = { 1.0e-1, 30.0, 1.0e-3, 3.0e-3 };
+
+/*
+ * One render
+ */
+typedef struct _test_case
+{
+    long routine;           // 1, 2 or 3
+    long signal;            // TEST_HELD, TEST_DITHERED or TEST_VIBRATO_SIGNAL (dodsp2/3), TEST_HELD or TEST_STEPPED (dodsp1)
+    long interp;            // AMSTRING_INTERP_...
+    long controlBlock;      // control-rate sub-block (0: per sample)
+    const char *simd;       // interpolation kernels
+    long vectorSize;
+    double period;
+    double gain;
+    double brightness;
+    long excitation;
+} t_test_case;
+
+/*
+ * Comparison of a render with the reference
+ */
+typedef struct _test_metrics
+{
+    double maxAbsError;
+    double snrDb;
+    bool measured;          // pitch and T60 measured (constant period)
+    double cents;
+    double t60Error;
+} t_test_metrics;
+
+static long testOrder = VD_FILTER_ORDER;
+static const char *testHostSimd;
+static long testFailures = 0;
+static bool testFirst = true;
+
+/*
+ * Allocate and initialise a string in the same way as amstring_new
+ */
+static t_amstring* test_newString(void)
+{
+    t_amstring *x = (t_amstring *)calloc(1, sizeof(t_amstring));
+    x->maxDelay = TEST_MAXDELAY;
+    amstring_setMemory(x, amstring_newMemory(x->maxDelay));
+    amstring_init(x);
+    if (testOrder != VD_FILTER_ORDER) amstring_setOrder(x, testOrder);
+    amstring_calcDcbCoeffs(x, TEST_SAMPLERATE);
+    return x;
+}
+
+static void test_freeString(t_amstring *x)
+{
+    amstring_releaseMemory(x);
+    free(x);
+}
+
+/*
+ * Samples to render for a period: enough for the measurement windows, and at least TEST_MINLENGTH
+ */
+static long test_length(double period)
+{
+    long window = (long)ceil(4.0 * period);
+    long length = (TEST_WINDOWS + 1) * window;
+    return length > TEST_MINLENGTH ? length : TEST_MINLENGTH;
+}
+
+/*
+ * Fill a case's input, period and gain signals (the built-in pluck is added by the string itself)
+ */
+static void test_signals(const t_test_case *c, long length, std::vector<double> &in, std::vector<double> &period, std::vector<double> &gain)
+{
+    unsigned long seed = 12345;
+    in.assign(length, 0.0);
+    period.resize(length);
+    gain.assign(length, c->gain);
+
+    if (c->excitation == TEST_IMPULSE) in[0] = 1.0;
+    if (c->excitation == TEST_NOISE) {
+        for (long j = 0; j < length && j < (long)c->period; j++) {
+            seed = seed * 1664525UL + 1013904223UL;
+            in[j] = 0.5 * ((double)(seed & 0xffffff) / (double)0x800000 - 1.0);
+        }
+    }
+    for (long j = 0; j < length; j++) {
+        if (c->signal == TEST_HELD) period[j] = c->period;
+        else if (c->signal == TEST_STEPPED) period[j] = c->period * (1.0 + TEST_STEP_SIZE * (double)((j / TEST_STEP) % 4));
+        else if (c->signal == TEST_DITHERED) period[j] = c->period + ((j & 1) ? TEST_DITHER : 0.0);
+        else period[j] = c->period * (1.0 + TEST_VIBRATO * sin(TWOPI * (double)j / TEST_VIBRATO_CYCLE));
+    }
+}
+
+/*
+ * The reference: the string model, one sample at a time, from its equations.
+ *
+ * For dodsp1 the period is a message, so it takes effect at the start of a vector. In the
+ * Thiran mode, the allpass is run over the whole history (as far as TEST_THIRAN_HISTORY
+ * samples back) each time its coefficients change, to find its state as if it had always
+ * run with them.
+ *
+ * The delay line is a ring of the same length as the string's (amstring_delayLineLengthFor),
+ * read before the sample is written, as in the perform routines.
+ */
+static void test_reference(const t_test_case *c, const std::vector<double> &in, const std::vector<double> &period, const std::vector<double> &gain, std::vector<double> &out)
+{
+    long length = (long)in.size();
+    long ringLength = amstring_delayLineLengthFor(TEST_MAXDELAY);
+    std::vector<double> ring(ringLength, 0.0);
+    std::vector<double> excitation(length, 0.0);
+    const double deloff = AMSTRING_DELOFFSET(testOrder);
+    const double minDelay = AMSTRING_MINDELAY(testOrder);
+    double h = c->brightness > MAXFBGAIN ? MAXFBGAIN : (c->brightness < 0.0 ? 0.0 : c->brightness);
+    double lpf1 = 0.0, lpf2 = 0.0, hpfIn = 0.0, hpfOut = 0.0;
+    bool thiran = c->routine == 1 && c->interp == AMSTRING_INTERP_THIRAN;
+    long apTap = -1;
+    double ap_a1 = 0.0, ap_a2 = 0.0, ap_y1 = 0.0, ap_y2 = 0.0;
+
+    // [ D.C. blocker ]
+    double w = TWOPI * 20.0 / TEST_SAMPLERATE;
+    double dcb_a0 = 1.0 / (1.0 + w / 2.0);
+    double dcb_a1 = -dcb_a0;
+    double dcb_b1 = dcb_a0 * (1.0 - w / 2.0);
+
+    // [ the pluck: the excitation table stretched to the period at the start ]
+    if (c->excitation == TEST_PLUCK) {
+        const t_amsample *table = amstring_exciteTable(AMSTRING_PLUCK_SOFT);
+        double p = period[0] < minDelay ? minDelay : (period[0] > TEST_MAXDELAY ? TEST_MAXDELAY : period[0]);
+        double step = (double)AMSTRING_EXCITE_LENGTH / p, pos = 0.0;
+        for (long j = 0; j < length && pos < (double)AMSTRING_EXCITE_LENGTH; j++, pos += step) {
+            long i = (long)pos;
+            excitation[j] = table[i] + (pos - (double)i) * (table[i+1] - table[i]);
+        }
+    }
+
+    for (long j = 0; j < length; j++) {
+        // [ the delay (reduced by 1.0 for the LPF) and gain, clamped as the messages or the signal inlets do ]
+        double delayTime, fbgain;
+        if (c->routine == 1) {
+            double p = period[j - j % c->vectorSize];
+            delayTime = (p < minDelay ? minDelay : (p > TEST_MAXDELAY ? TEST_MAXDELAY : p)) - 1.0;
+        }
+        else {
+            delayTime = period[j] - 1.0;
+            delayTime = delayTime < deloff ? deloff : (delayTime > TEST_MAXDELAY ? TEST_MAXDELAY : delayTime);
+        }
+        fbgain = c->routine == 3 ? gain[j] : c->gain;
+        fbgain = fbgain > MAXFBGAIN ? MAXFBGAIN : (fbgain < -MAXFBGAIN ? -MAXFBGAIN : fbgain);
+
+        double y = 0.0;
+        long tap = (long)floor(delayTime - 1.5);
+        if (thiran && tap >= 1) {
+            // [ Thiran allpass of delay d after a tap of the rest: y[n] = a2 x[n] + a1 x[n-1] + x[n-2] - a1 y[n-1] - a2 y[n-2] ]
+            double d = delayTime - (double)tap;
+            double a1 = -2.0 * (d - 2.0) / (d + 1.0);
+            double a2 = (d - 1.0) * (d - 2.0) / ((d + 1.0) * (d + 2.0));
+            if (tap != apTap || a1 != ap_a1 || a2 != ap_a2) {
+                apTap = tap;
+                ap_a1 = a1;
+                ap_a2 = a2;
+                ap_y1 = ap_y2 = 0.0;
+                for (long t = j > TEST_THIRAN_HISTORY ? j - TEST_THIRAN_HISTORY : 0; t < j; t++) {
+                    double x0 = t - tap >= 0 ? out[t - tap] : 0.0, x1 = t - tap - 1 >= 0 ? out[t - tap - 1] : 0.0, x2 = t - tap - 2 >= 0 ? out[t - tap - 2] : 0.0;
+                    double y0 = a2 * x0 + a1 * x1 + x2 - a1 * ap_y1 - a2 * ap_y2;
+                    ap_y2 = ap_y1;
+                    ap_y1 = y0;
+                }
+            }
+            double x0 = j - tap >= 0 ? out[j - tap] : 0.0, x1 = j - tap - 1 >= 0 ? out[j - tap - 1] : 0.0, x2 = j - tap - 2 >= 0 ? out[j - tap - 2] : 0.0;
+            y = a2 * x0 + a1 * x1 + x2 - a1 * ap_y1 - a2 * ap_y2;
+            ap_y2 = ap_y1;
+            ap_y1 = y;
+        }
+        else {
+            // [ lagrange interpolation: tap i is the sample dt + i before this one ]
+            long dt = (long)floor(delayTime - deloff);
+            double D = delayTime - (double)dt;
+            for (long i = 0; i <= testOrder; i++) {
+                double coeff = 1.0;
+                for (long k = 0; k <= testOrder; k++) {
+                    if (k != i) coeff *= (D - (double)k) / (double)(i - k);
+                }
+                y += coeff * ring[((j - dt - i) % ringLength + ringLength) % ringLength];
+            }
+        }
+
+        // [ loop filter ]
+        double omega0 = TWOPI / (delayTime + 1.0);
+        double a1 = (fbgain + h * fbgain * cos(omega0)) / (1.0 + cos(omega0));
+        double a0 = (a1 - h * fbgain) * 0.5;
+        if (a0 < 0.0) {
+            a0 = 0.0;
+            a1 = fbgain;
+        }
+        double lpf = a0 * y + a1 * lpf1 + a0 * lpf2;
+        lpf2 = lpf1;
+        lpf1 = y;
+
+        // [ D.C. blocker, with the input ]
+        double x = lpf + in[j] + excitation[j];
+        hpfOut = dcb_a0 * x + dcb_a1 * hpfIn + dcb_b1 * hpfOut;
+        hpfIn = x;
+        out[j] = ring[j % ringLength] = hpfOut;
+    }
+}
+
+/*
+ * Render a case through its perform routine, returning the time taken per sample (in ns)
+ */
+static double test_render(const t_test_case *c, const std::vector<double> &in, const std::vector<double> &period, const std::vector<double> &gain, std::vector<double> &out)
+{
+    long length = (long)in.size();
+    std::vector<double> ins0(in), ins1(gain), ins2(period);
+
+    amstring_simdSelect(c->simd);
+    t_amstring *x = test_newString();
+    amstring_setDelayTime(x, c->period);
+    amstring_setFbGain(x, c->gain);
+    amstring_setBrightness(x, c->brightness);
+    amstring_setSleep(x, 0.0);
+    amstring_setInterp(x, c->interp);
+    amstring_setControlBlock(x, c->controlBlock);
+    if (c->excitation == TEST_PLUCK) amstring_pluck(x, 1.0, AMSTRING_PLUCK_SOFT);
+
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    for (long j0 = 0; j0 < length; j0 += c->vectorSize) {
+        long n = length - j0 < c->vectorSize ? length - j0 : c->vectorSize;
+        if (c->routine == 1 && j0 > 0 && period[j0] != period[j0 - c->vectorSize]) amstring_setDelayTime(x, period[j0]);
+        double *ins[3] = { &ins0[j0], &ins1[j0], &ins2[j0] };
+        double *outs[1] = { &out[j0] };
+        testPerforms[c->routine](x, NULL, ins, 3, outs, 1, n, 0, NULL);
+    }
+    std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+    test_freeString(x);
+    amstring_simdSelect(testHostSimd);
+    return 1.0e9 * std::chrono::duration<double>(t2 - t1).count() / (double)length;
+}
+
+/*
+ * Follow the fundamental of a render with a constant period: demodulate it at 1/period over
+ * successive Hann windows of four periods. The phase advance from window to window gives
+ * its frequency, and the change in magnitude its decay in dB per period. (The first window,
+ * while the excitation settles, is skipped.)
+ */
+static void test_fundamental(const std::vector<double> &out, double period, double *frequency, double *decayDb)
+{
+    long window = (long)ceil(4.0 * period);
+    double f0 = 1.0 / period;
+    double re[TEST_WINDOWS], im[TEST_WINDOWS];
+
+    for (long m = 0; m < TEST_WINDOWS; m++) {
+        re[m] = im[m] = 0.0;
+        for (long j = 0; j < window; j++) {
+            long n = m * window + j;
+            double w = 0.5 - 0.5 * cos(TWOPI * ((double)j + 0.5) / (double)window);
+            double phase = TWOPI * fmod(f0 * (double)n, 1.0);
+            re[m] += w * out[n] * cos(phase);
+            im[m] -= w * out[n] * sin(phase);
+        }
+    }
+    double advance = 0.0;
+    for (long m = 2; m < TEST_WINDOWS; m++) {
+        advance += atan2(im[m] * re[m-1] - re[m] * im[m-1], re[m] * re[m-1] + im[m] * im[m-1]);
+    }
+    advance /= (double)(TEST_WINDOWS - 2);
+    *frequency = f0 + advance / (TWOPI * (double)window);
+    *decayDb = 20.0 * log10(hypot(re[TEST_WINDOWS-1], im[TEST_WINDOWS-1]) / hypot(re[1], im[1])) * period / ((double)(TEST_WINDOWS - 2) * (double)window);
+}
+
+/*
+ * Compare a render with another (the reference, or a golden render)
+ */
+static void test_compare(const std::vector<double> &reference, const std::vector<double> &out, double period, bool measure, t_test_metrics *m)
+{
+    double signal = 0.0, error = 0.0;
+    m->maxAbsError = 0.0;
+    for (size_t j = 0; j < out.size(); j++) {
+        double e = out[j] - reference[j];
+        if (!(fabs(e) <= m->maxAbsError)) m->maxAbsError = fabs(e); // ( so that a NaN is kept )
+        signal += reference[j] * reference[j];
+        error += e * e;
+    }
+    m->snrDb = error != 0.0 ? 10.0 * log10(signal / error) : TEST_SNR_IDENTICAL;
+    if (!(m->snrDb <= TEST_SNR_IDENTICAL)) m->snrDb = m->snrDb > TEST_SNR_IDENTICAL ? TEST_SNR_IDENTICAL : -TEST_SNR_IDENTICAL;
+
+    m->measured = false;
+    m->cents = m->t60Error = 0.0;
+    if (measure) {
+        double fr, dr, f, d;
+        test_fundamental(reference, period, &fr, &dr);
+        test_fundamental(out, period, &f, &d);
+        // [ not if the fundamental is held back by the D.C. blocker, or dies away over the windows ]
+        if (TEST_SAMPLERATE / period >= TEST_MEASURABLE_HZ && dr * (double)(TEST_WINDOWS - 2) * ceil(4.0 * period) / period > TEST_MEASURABLE_DB) {
+            m->measured = true;
+            m->cents = 1200.0 * log2(f / fr);
+            m->t60Error = dr / d - 1.0; // ( T60 is inversely proportional to the decay per period )
+        }
+    }
+}
+
+static bool test_within(const t_test_metrics *m, const t_test_tolerance *t)
+{
+    if (!(m->maxAbsError <= t->maxAbsError) || !(m->snrDb >= t->minSnrDb)) return false;
+    if (m->measured && (!(fabs(m->cents) <= t->maxCents) || !(fabs(m->t60Error) <= t->maxT60Error))) return false;
+    return true;
+}
+
+/*
+ * Write a result as JSON (and any failure to stderr)
+ */
+static void test_report(const char *group, const t_test_case *c, long samples, const t_test_metrics *m, double nsPerSample, bool pass, const char *extra)
+{
+    printf("%s\n    { \"group\": \"%s\", \"routine\": \"%s\", \"signal\": \"%s\", \"interp\": \"%s\", \"simd\": \"%s\", \"control_block\": %ld, "
+           "\"vector_size\": %ld, \"period\": %.4f, \"gain\": %.5f, \"brightness\": %.2f, \"excitation\": \"%s\", \"samples\": %ld, "
+           "\"max_abs_error\": %.3e, \"snr_db\": %.1f, ",
+           testFirst ? "" : ",", group, testRoutineNames[c->routine], testSignalNames[c->signal],
+           testInterpNames[c->interp], c->simd, c->controlBlock, c->vectorSize, c->period, c->gain, c->brightness,
+           testExcitationNames[c->excitation], samples, m->maxAbsError, m->snrDb);
+    if (m->measured) printf("\"cents\": %.3e, \"t60_error\": %.3e, ", m->cents, m->t60Error);
+    else printf("\"cents\": null, \"t60_error\": null, ");
+    printf("\"ns_per_sample\": %.3f, %s\"pass\": %s }", nsPerSample, extra ? extra : "", pass ? "true" : "false");
+    testFirst = false;
+    fflush(stdout);
+
+    if (!pass) {
+        testFailures++;
+        fprintf(stderr, "FAIL %s: %s %s, interp %s, simd %s, control block %ld, vector %ld, period %.4f, gain %.5f, brightness %.2f, %s: "
+                "max abs error %.3e, SNR %.1f dB, cents %.3e, T60 error %.3e\n",
+                group, testRoutineNames[c->routine], testSignalNames[c->signal], testInterpNames[c->interp], c->simd,
+                c->controlBlock, c->vectorSize, c->period, c->gain, c->brightness, testExcitationNames[c->excitation],
+                m->maxAbsError, m->snrDb, m->cents, m->t60Error);
+    }
+}
+
+/*
+ * Run a case: render it and the reference, compare and report. A golden render is written
+ * to (or compared with) the golden file if one is given.
+ */
+static void test_case(const char *group, const t_test_case *c, FILE *record, FILE *golden)
+{
+    long length = test_length(c->period);
+    std::vector<double> in, period, gain, reference(length), out(length);
+    t_test_metrics m;
+    char extra[128] = "";
+
+    test_signals(c, length, in, period, gain);
+    test_reference(c, in, period, gain, reference);
+    double nsPerSample = test_render(c, in, period, gain, out);
+    test_compare(reference, out, c->period, c->signal == TEST_HELD || c->signal == TEST_DITHERED, &m);
+
+    const t_test_tolerance *t = c->controlBlock ? &testControlRateTolerance : &testTolerances[c->interp];
+    bool pass = test_within(&m, t);
+
+    if (record) {
+        int64_t n = length;
+        fwrite(&n, sizeof(n), 1, record);
+        fwrite(&out[0], sizeof(double), length, record);
+    }
+    if (golden) {
+        int64_t n = 0;
+        std::vector<double> previous(length);
+        t_test_metrics g;
+        if (fread(&n, sizeof(n), 1, golden) != 1 || n != length || fread(&previous[0], sizeof(double), length, golden) != (size_t)length) {
+            fprintf(stderr, "FAIL golden file does not match the cases (different --quick or --order?)\n");
+            testFailures++;
+            golden = NULL;
+        }
+        else {
+            test_compare(previous, out, c->period, false, &g);
+            pass = pass && test_within(&g, &testTolerances[AMSTRING_INTERP_EXACT]);
+            snprintf(extra, sizeof(extra), "\"golden_max_abs_error\": %.3e, \"golden_snr_db\": %.1f, ", g.maxAbsError, g.snrDb);
+        }
+    }
+    test_report(group, c, length, &m, nsPerSample, pass, extra);
+}
+
+/*
+ * Render an impulse through one voice of am.polystring~ and through am.string~ (dodsp1) at
+ * the voice's order, with the same period, gain and brightness, and compare them. They run
+ * the same loop, so they should agree to rounding; a tap offset or a missing sample shows
+ * up as a large error.
+ */
+static void test_polystring(const char *simd, double period)
+{
+    const long length = TEST_MINLENGTH, vectorSize = 64;
+    t_test_case c = { 4, TEST_HELD, AMSTRING_INTERP_EXACT, 0, simd, vectorSize, period, TEST_CANDIDATE_GAIN, TEST_CANDIDATE_BRIGHTNESS, TEST_IMPULSE };
+    std::vector<double> in(length, 0.0), gain(length, c.gain), periods(length, period), reference(length), out(length);
+    t_test_metrics m;
+    in[0] = 1.0;
+
+    amstring_simdSelect(simd);
+    t_amstring *x = test_newString();
+    amstring_setOrder(x, VD_FILTER_ORDER);
+    amstring_setDelayTime(x, period);
+    amstring_setFbGain(x, c.gain);
+    amstring_setBrightness(x, c.brightness);
+    amstring_setSleep(x, 0.0);
+
+    t_ampolystring *poly = (t_ampolystring *)calloc(1, sizeof(t_ampolystring));
+    ampolystring_setVoices(poly, 1, (t_sample)TEST_MAXDELAY);
+    ampolystring_setMemory(poly, calloc(1, ampolystring_memorySize(poly)));
+    ampolystring_init(poly);
+    ampolystring_setSampleRate(poly, TEST_SAMPLERATE);
+    ampolystring_setDelayTime(poly, 1, period);
+    ampolystring_setFbGain(poly, 1, c.gain);
+    ampolystring_setBrightness(poly, 1, c.brightness);
+
+    for (long j0 = 0; j0 < length; j0 += vectorSize) {
+        double *ins[3] = { &in[j0], &gain[j0], &periods[j0] };
+        double *outs[1] = { &reference[j0] };
+        amstring_dodsp1_64(x, NULL, ins, 3, outs, 1, vectorSize, 0, NULL);
+    }
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    for (long j0 = 0; j0 < length; j0 += vectorSize) {
+        double *ins[1] = { &in[j0] };
+        double *outs[1] = { &out[j0] };
+        ampolystring_dodsp_64(poly, NULL, ins, 1, outs, 1, vectorSize, 0, NULL);
+    }
+    std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+    test_freeString(x);
+    free(poly->memory);
+    free(poly);
+    amstring_simdSelect(testHostSimd);
+
+    test_compare(reference, out, period, false, &m);
+    bool pass = test_within(&m, &testTolerances[AMSTRING_INTERP_EXACT]);
+    test_report("polystring", &c, length, &m, 1.0e9 * std::chrono::duration<double>(t2 - t1).count() / (double)length, pass, NULL);
+}
+
+/*
+ * The response of the loop (less its nominal delay, delayTime + 1) at the fundamental,
+ * for given lagrange and LPF coefficients
+ */
+static std::complex<double> test_loopResponse(double delayTime, long dt, const double *lc, double lpf_a0, double lpf_a1)
+{
+    double omega = TWOPI / (delayTime + 1.0);
+    std::complex<double> lagrange = 0.0;
+    for (long i = 0; i <= testOrder; i++) lagrange += lc[i] * std::polar(1.0, -omega * ((double)(dt + i) - delayTime));
+    // ( the LPF is symmetric, so it is a delay of one sample times a real gain )
+    return lagrange * (lpf_a1 + 2.0 * lpf_a0 * cos(omega));
+}
+
+/*
+ * The same for the Thiran allpass (after its tap) in place of the lagrange filter
+ */
+static std::complex<double> test_thiranResponse(double delayTime, long tap, double ap_a1, double ap_a2, double lpf_a0, double lpf_a1)
+{
+    double omega = TWOPI / (delayTime + 1.0);
+    std::complex<double> z1 = std::polar(1.0, -omega), z2 = std::polar(1.0, -2.0 * omega);
+    std::complex<double> allpass = (ap_a2 + ap_a1 * z1 + z2) / (1.0 + ap_a1 * z1 + ap_a2 * z2);
+    return std::polar(1.0, -omega * ((double)tap - delayTime)) * allpass * (lpf_a1 + 2.0 * lpf_a0 * cos(omega));
+}
+
+/*
+ * Sweep the periods from TEST_RESPONSE_MIN to the maximum delay, comparing the loop response of
+ * each mode's coefficients with that of the exact coefficients (for the Thiran mode, with that
+ * of the allpass's coefficients calculated here in double precision, as the reference render
+ * does). (The loop is unstable at shorter periods with the candidates' gain and brightness;
+ * see the golden cases.)
+ */
+static void test_response(long interp)
+{
+    const long steps = 20000;
+    const double deloff = AMSTRING_DELOFFSET(testOrder);
+    const double shortest = TEST_RESPONSE_MIN;
+    const int padded = AMSTRING_PADDED(testOrder);
+    const double fbgain = TEST_CANDIDATE_GAIN, h = TEST_CANDIDATE_BRIGHTNESS;
+    t_test_metrics m = { 0.0, 0.0, true, 0.0, 0.0 };
+    t_test_case c = { interp == AMSTRING_INTERP_THIRAN ? 1 : 2, interp == AMSTRING_INTERP_THIRAN ? TEST_HELD : TEST_DITHERED, interp, 0, testHostSimd, 1, shortest, fbgain, h, TEST_IMPULSE };
+
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    for (long s = 0; s < steps; s++) {
+        // [ log-spaced, with fractional parts spread over the whole range ]
+        double period = shortest * pow((double)TEST_MAXDELAY / shortest, ((double)s + 0.5) / (double)steps) + fmod((double)s * 0.618034, 1.0);
+        if (period > TEST_MAXDELAY) continue;
+        double delayTime = period - 1.0;
+        long dt = (long)floor(delayTime - deloff);
+        double D = delayTime - (double)dt;
+
+        // [ exact coefficients ]
+        double exact[AMSTRING_MAXPADDED], omega0 = TWOPI / period;
+        for (long i = 0; i <= testOrder; i++) {
+            exact[i] = 1.0;
+            for (long k = 0; k <= testOrder; k++) if (k != i) exact[i] *= (D - (double)k) / (double)(i - k);
+        }
+        double a1 = (fbgain + h * fbgain * cos(omega0)) / (1.0 + cos(omega0));
+        double a0 = (a1 - h * fbgain) * 0.5;
+
+        // [ the mode's coefficients ]
+        t_amsample lc[AMSTRING_MAXPADDED], lpf_a0, lpf_a1;
+        double modeLc[AMSTRING_MAXPADDED];
+        if (interp == AMSTRING_INTERP_TABLE) amstring_lagTableNearest(amstring_lagTable(testOrder), padded, D - deloff, lc);
+        else if (interp == AMSTRING_INTERP_TABLE_LINEAR) amstring_lagTableLinear(amstring_lagTable(testOrder), padded, D - deloff, lc);
+        else if (interp == AMSTRING_INTERP_FARROW) amstring_farrowCoeffs(amstring_farrowTable(testOrder), (int)testOrder, D - deloff, lc);
+        else amstring_calcLagrangeCoeffsFor(testOrder, delayTime, lc);
+        if (interp == AMSTRING_INTERP_TABLE || interp == AMSTRING_INTERP_TABLE_LINEAR) amstring_lpfTableCoeffs(amstring_lpfTable(), delayTime, fbgain, h, &lpf_a0, &lpf_a1);
+        else amstring_calcLpfCoeffsFor(delayTime, fbgain, h, &lpf_a0, &lpf_a1);
+        for (long i = 0; i <= testOrder; i++) modeLc[i] = lc[i];
+
+        std::complex<double> reference = test_loopResponse(delayTime, dt, exact, a0, a1);
+        std::complex<double> response = test_loopResponse(delayTime, dt, modeLc, lpf_a0, lpf_a1);
+        if (interp == AMSTRING_INTERP_THIRAN) {
+            t_amsample ap_a1, ap_a2;
+            long tap = (long)amstring_calcThiranCoeffsFor(delayTime, &ap_a1, &ap_a2);
+            response = test_thiranResponse(delayTime, tap, ap_a1, ap_a2, lpf_a0, lpf_a1);
+            long refTap = (long)floor(delayTime - 1.5);
+            double d = delayTime - (double)refTap;
+            reference = test_thiranResponse(delayTime, refTap, -2.0 * (d - 2.0) / (d + 1.0), (d - 1.0) * (d - 2.0) / ((d + 1.0) * (d + 2.0)), a0, a1);
+        }
+
+        // [ a phase lag of phi at the fundamental lengthens the loop by phi/omega0 samples; the decay per period is the loop gain in dB ]
+        double lengthening = -(std::arg(response) - std::arg(reference)) / omega0;
+        double cents = -1200.0 * log2(1.0 + lengthening / period);
+        double t60Error = log(std::abs(reference)) / log(std::abs(response)) - 1.0;
+        if (!(fabs(cents) <= fabs(m.cents))) m.cents = cents;
+        if (!(fabs(t60Error) <= fabs(m.t60Error))) m.t60Error = t60Error;
+    }
+    std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+    m.snrDb = TEST_SNR_IDENTICAL;
+    const t_test_tolerance *t = &testTolerances[interp];
+    bool pass = fabs(m.cents) <= t->maxCents && fabs(m.t60Error) <= t->maxT60Error;
+    test_report("response", &c, steps, &m, 1.0e9 * std::chrono::duration<double>(t2 - t1).count() / (double)steps, pass, NULL);
+}
+
+int main(int argc, const char * argv[])
+{
+    bool quick = false;
+    const char *recordName = NULL, *goldenName = NULL;
+
+    for (int a = 1; a < argc; a++) {
+        if (!strcmp(argv[a], "--quick")) {
+            quick = true;
+        }
+        else if (!strcmp(argv[a], "--order") && a + 1 < argc) {
+            testOrder = atol(argv[++a]);
+            if (testOrder < 1 || testOrder > AMSTRING_MAXORDER || !(testOrder & 1)) testOrder = VD_FILTER_ORDER;
+        }
+        else if (!strcmp(argv[a], "--record") && a + 1 < argc) {
+            recordName = argv[++a];
+        }
+        else if (!strcmp(argv[a], "--golden") && a + 1 < argc) {
+            goldenName = argv[++a];
+        }
+        else {
+            fprintf(stderr, "usage: %s [--quick] [--order <1|3|5|7|9>] [--record <file>] [--golden <file>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    const double *periods     = quick ? testQuickPeriods : testPeriods;
+    size_t numPeriods         = quick ? TEST_COUNT(testQuickPeriods) : TEST_COUNT(testPeriods);
+    const double *gains       = quick ? testQuickGains : testGains;
+    size_t numGains           = quick ? TEST_COUNT(testQuickGains) : TEST_COUNT(testGains);
+    const double *brightness  = quick ? testQuickBrightness : testBrightness;
+    size_t numBrightness      = quick ? TEST_COUNT(testQuickBrightness) : TEST_COUNT(testBrightness);
+    const double minDelay     = AMSTRING_MINDELAY(testOrder);
+
+    amstring_simdInit();
+    testHostSimd = amstring_simdName();
+
+    // [ the golden file starts with its magic, whether the cases were the quick set, and the order ]
+    FILE *record = NULL, *golden = NULL;
+    int64_t header[2] = { quick ? 1 : 0, testOrder };
+    if (recordName) {
+        record = fopen(recordName, "wb");
+        if (!record) { fprintf(stderr, "%s: cannot write %s\n", argv[0], recordName); return 1; }
+        fwrite(TEST_GOLDEN_MAGIC, 1, 8, record);
+        fwrite(header, sizeof(header), 1, record);
+    }
+    if (goldenName) {
+        char magic[8];
+        int64_t previous[2];
+        golden = fopen(goldenName, "rb");
+        if (!golden || fread(magic, 1, 8, golden) != 8 || memcmp(magic, TEST_GOLDEN_MAGIC, 8) || fread(previous, sizeof(previous), 1, golden) != 1
+            || previous[0] != header[0] || previous[1] != header[1]) {
+            fprintf(stderr, "%s: %s is not a golden file for these cases\n", argv[0], goldenName);
+            return 1;
+        }
+    }
+
+    printf("{\n");
+    printf("  \"engine\": \"am.string~\",\n");
+    printf("  \"filter_order\": %ld,\n", testOrder);
+    printf("  \"precision\": \"%s\",\n", sizeof(t_amsample) == sizeof(float) ? "float" : "double");
+    printf("  \"simd\": \"%s\",\n", testHostSimd);
+    printf("  \"samplerate\": %.1f,\n", TEST_SAMPLERATE);
+    printf("  \"tolerances\": {");
+    for (int i = 0; i < AMSTRING_INTERP_NUMMODES; i++) {
+        printf(" \"%s\": { \"max_abs_error\": %.1e, \"min_snr_db\": %.1f, \"max_cents\": %.1e, \"max_t60_error\": %.1e },", testInterpNames[i],
+               testTolerances[i].maxAbsError, testTolerances[i].minSnrDb, testTolerances[i].maxCents, testTolerances[i].maxT60Error);
+    }
+    printf(" \"control_rate\": { \"max_abs_error\": %.1e, \"min_snr_db\": %.1f, \"max_cents\": %.1e, \"max_t60_error\": %.1e } },\n",
+           testControlRateTolerance.maxAbsError, testControlRateTolerance.minSnrDb, testControlRateTolerance.maxCents, testControlRateTolerance.maxT60Error);
+    printf("  \"results\": [");
+
+    /*
+     * Golden renders: the matrix, through each routine as a patch would use it
+     */
+    static const long routines[][2] = { { 1, TEST_HELD }, { 1, TEST_STEPPED }, { 2, TEST_HELD }, { 2, TEST_VIBRATO_SIGNAL }, { 3, TEST_HELD }, { 3, TEST_VIBRATO_SIGNAL } };
+    long caseIndex = 0;
+    for (size_t p = 0; p < numPeriods; p++) {
+        for (size_t g = 0; g < numGains; g++) {
+            for (size_t b = 0; b < numBrightness; b++) {
+                // [ the LPF has a gain of fbgain at the fundamental, and more below it, so the loop is unstable at the
+                //   shortest periods unless it is fully bright (shorter than about 20 samples, at the highest gains) ]
+                if (p == 0 && brightness[b] < 1.0) continue;
+                for (long e = 0; e < TEST_NUMEXCITATIONS; e++) {
+                    for (size_t r = 0; r < TEST_COUNT(routines); r++, caseIndex++) {
+                        t_test_case c = { routines[r][0], routines[r][1], AMSTRING_INTERP_EXACT, 0, testHostSimd,
+                                          testVectorSizes[caseIndex % TEST_COUNT(testVectorSizes)],
+                                          p == 0 ? minDelay + periods[p] : periods[p], gains[g], brightness[b], e };
+                        test_case("golden", &c, record, golden);
+                    }
+                }
+            }
+        }
+    }
+
+    /*
+     * Candidates: every kernel set, mode and update rate (dodsp1, whose period is a message, with its period held and stepped)
+     */
+    static const long dodsp1Signals[] = { TEST_HELD, TEST_STEPPED };
+    for (size_t k = 0; k < TEST_COUNT(testSimdNames); k++) {
+        if (!amstring_simdSelect(testSimdNames[k])) continue;
+        amstring_simdSelect(testHostSimd);
+        for (long interp = 0; interp < AMSTRING_INTERP_NUMMODES; interp++) {
+            for (size_t s = 0; s < TEST_COUNT(dodsp1Signals); s++) {
+                for (size_t p = 0; p < TEST_COUNT(testCandidatePeriods); p++) {
+                    t_test_case c = { 1, dodsp1Signals[s], interp, 0, testSimdNames[k], 64, testCandidatePeriods[p],
+                                      TEST_CANDIDATE_GAIN, TEST_CANDIDATE_BRIGHTNESS, TEST_NOISE };
+                    test_case("candidate", &c, NULL, NULL);
+                }
+            }
+            for (long controlBlock = 0; controlBlock <= 16; controlBlock += 16) {
+                for (long routine = 2; routine <= 3; routine++) {
+                    for (long signal = TEST_DITHERED; signal <= TEST_VIBRATO_SIGNAL; signal++) {
+                        for (size_t p = 0; p < TEST_COUNT(testCandidatePeriods); p++) {
+                            t_test_case c = { routine, signal, interp, controlBlock, testSimdNames[k], 64, testCandidatePeriods[p],
+                                              TEST_CANDIDATE_GAIN, TEST_CANDIDATE_BRIGHTNESS, TEST_NOISE };
+                            test_case("candidate", &c, NULL, NULL);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    /*
+     * Responses: each mode's coefficients over the whole range of periods
+     */
+    for (long interp = 0; interp < AMSTRING_INTERP_NUMMODES; interp++) test_response(interp);
+
+    /*
+     * Polystring: a voice of am.polystring~ against am.string~, on every kernel set
+     */
+    for (size_t k = 0; k < TEST_COUNT(testSimdNames); k++) {
+        if (!amstring_simdSelect(testSimdNames[k])) continue;
+        amstring_simdSelect(testHostSimd);
+        for (size_t p = 0; p < TEST_COUNT(testCandidatePeriods); p++) test_polystring(testSimdNames[k], testCandidatePeriods[p]);
+    }
+
+    printf("\n  ],\n");
+    printf("  \"failures\": %ld\n}\n", testFailures);
+
+    if (record) fclose(record);
+    if (golden) fclose(golden);
+    if (testFailures) fprintf(stderr, "%ld failed\n", testFailures);
+    return testFailures ? 1 : 0;
+}